@@ -0,0 +1,58 @@
+/**
+ * @file dump_decision_file.cxx
+ *
+ * Print the trigger decisions in a decision file, as written by the
+ * TriggerDecisionEmulator's recorder, one per line
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/TriggerTraceReader.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " <decision file> [max decisions]" << std::endl;
+    return 1;
+  }
+  unsigned long max_decisions = argc == 3 ? std::stoul(argv[2]) : 0; // NOLINT(runtime/int)
+
+  try {
+    dunedaq::trigemu::TriggerTraceReader reader(argv[1]);
+    dunedaq::dfmessages::TriggerDecision decision;
+    uint32_t flags = 0;      // NOLINT(build/unsigned)
+    unsigned long count = 0; // NOLINT(runtime/int)
+    while ((max_decisions == 0 || count < max_decisions) && reader.next(decision, flags)) {
+      std::cout << "trigger_number " << decision.trigger_number << " run " << decision.run_number << " timestamp "
+                << decision.trigger_timestamp << " type " << decision.trigger_type << " components "
+                << decision.components.size();
+      if (flags & dunedaq::trigemu::decisionfile::s_flag_repeat) {
+        std::cout << " repeat";
+      }
+      if (flags & dunedaq::trigemu::decisionfile::s_flag_resent) {
+        std::cout << " resent";
+      }
+      for (auto const& request : decision.components) {
+        std::cout << " [" << static_cast<int>(request.component.system_type) << ":" << request.component.region_id
+                  << ":" << request.component.element_id << " " << request.window_begin << "-" << request.window_end
+                  << "]";
+      }
+      std::cout << "\n";
+      ++count;
+    }
+    std::cerr << count << " decisions" << std::endl;
+  } catch (dunedaq::trigemu::TraceFileError& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
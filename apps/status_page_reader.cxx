@@ -0,0 +1,103 @@
+/**
+ * @file status_page_reader.cxx
+ *
+ * Sample the live status that a TriggerDecisionEmulator publishes in
+ * shared memory (see its status_page_name parameter), and print one
+ * line per sample. Reading doesn't involve the DAQ process at all, so
+ * this can run at kHz rates during stress tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/StatusPage.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+const char*
+state_name(dunedaq::trigemu::statuspage::State state)
+{
+  switch (state) {
+    case dunedaq::trigemu::statuspage::State::kRunning:
+      return "running";
+    case dunedaq::trigemu::statuspage::State::kPaused:
+      return "paused";
+    case dunedaq::trigemu::statuspage::State::kStopped:
+    default:
+      return "stopped";
+  }
+}
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 2 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " <status page name> [samples per second] [number of samples]" << std::endl;
+    return 1;
+  }
+  double rate_hz = argc >= 3 ? std::stod(argv[2]) : 1.;
+  unsigned long max_samples = argc == 4 ? std::stoul(argv[3]) : 0; // NOLINT(runtime/int)
+  if (rate_hz <= 0) {
+    std::cerr << "The sampling rate must be positive" << std::endl;
+    return 1;
+  }
+
+  using namespace dunedaq::trigemu;
+  try {
+    StatusPageReader reader(argv[1]);
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1. / rate_hz));
+    auto next_sample = std::chrono::steady_clock::now();
+
+    std::cout << "time_us run state triggers trigger_rate_hz inhibited not_sent tokens_received tokens_available "
+                 "open last_trigger_number estimate time_sync_age_us lateness_p50_us lateness_p90_us "
+                 "lateness_p99_us lateness_max_us\n";
+    statuspage::Status status{};
+    statuspage::Status previous{};
+    bool have_previous = false;
+    double trigger_rate_hz = 0;
+    for (unsigned long count = 0; max_samples == 0 || count < max_samples; ++count) { // NOLINT(runtime/int)
+      std::this_thread::sleep_until(next_sample);
+      next_sample += period;
+      if (!reader.read(status)) {
+        std::cerr << "The status page was too busy to read" << std::endl;
+        continue;
+      }
+
+      // Between updates, keep showing the rate from the last two
+      if (!have_previous || status.update_time_us != previous.update_time_us) {
+        trigger_rate_hz = 0;
+        if (have_previous && status.run_number == previous.run_number &&
+            status.update_time_us > previous.update_time_us && status.triggers >= previous.triggers) {
+          trigger_rate_hz =
+            (status.triggers - previous.triggers) * 1e6 / (status.update_time_us - previous.update_time_us);
+        }
+        previous = status;
+        have_previous = true;
+      }
+
+      std::cout << status.update_time_us << " " << status.run_number << " " << state_name(status.state) << " "
+                << status.triggers << " " << trigger_rate_hz << " " << status.inhibited << " "
+                << status.decisions_not_sent << " " << status.tokens_received << " " << status.tokens_available << " "
+                << status.open_decisions << " " << status.last_trigger_number << " " << status.timestamp_estimate
+                << " " << status.time_sync_age_us << " " << statuspage::lateness_percentile_us(status, 0.5) << " "
+                << statuspage::lateness_percentile_us(status, 0.9) << " "
+                << statuspage::lateness_percentile_us(status, 0.99) << " " << status.lateness_max_us << "\n";
+      if (rate_hz <= 100) {
+        std::cout << std::flush;
+      }
+    }
+  } catch (StatusPageError& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
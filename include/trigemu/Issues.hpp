@@ -11,6 +11,8 @@
 
 #include "ers/Issue.hpp"
 
+#include <string>
+
 namespace dunedaq {
 ERS_DECLARE_ISSUE(trigemu, InvalidTimeSync, "An invalid TimeSync message was received", ERS_EMPTY)
 
@@ -20,6 +22,83 @@ ERS_DECLARE_ISSUE(trigemu,
                   InvalidTriggerInterval,
                   "An invalid trigger interval of " << interval << " was requested",
                   ((uint64_t)interval)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(trigemu,
+                  TraceFileError,
+                  "Problem with trigger trace file " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  TimeSyncFileError,
+                  "Problem with TimeSync file " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  RecordingError,
+                  "Problem recording trigger decisions to " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  DistributionFileError,
+                  "Problem with distribution file " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidArrivalModel,
+                  "Invalid trigger arrival model \"" << model << "\": " << reason,
+                  ((std::string)model)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidUpdate,
+                  "Can't apply the update: " << reason,
+                  ((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidRateSchedule,
+                  "Invalid trigger rate schedule \"" << model << "\": " << reason,
+                  ((std::string)model)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidDispatchPolicy,
+                  "Unknown trigger decision dispatch policy \"" << policy << "\"",
+                  ((std::string)policy))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidRegionInhibitPolicy,
+                  "Unknown region inhibit policy \"" << policy << "\"",
+                  ((std::string)policy))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  InvalidInhibitRegion,
+                  "Inhibit region " << region << " can't be used: " << reason,
+                  ((std::string)region)((std::string)reason))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  TriggerDecisionNotSent,
+                  "Trigger decision " << trigger_number << " could not be sent to any of the decision sinks",
+                  ((uint64_t)trigger_number)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(trigemu,
+                  StaleTriggerDecision,
+                  "No token for trigger decision " << trigger_number << " after " << age_ms << " ms: " << action,
+                  ((uint64_t)trigger_number)((int64_t)age_ms)((std::string)action)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(trigemu,
+                  StopDrainIncomplete,
+                  open_decisions << " trigger decisions were still open " << deadline_ms
+                                 << " ms after stop. Stopping without their tokens",
+                  ((uint64_t)open_decisions)((int64_t)deadline_ms)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(trigemu,
+                  StaleTimestampEstimate,
+                  "The last TimeSync arrived " << age_ms << " ms ago, more than the limit of " << max_age_ms
+                                               << " ms. Not sending triggers until TimeSyncs resume",
+                  ((int64_t)age_ms)((int64_t)max_age_ms))
+
+ERS_DECLARE_ISSUE(trigemu,
+                  StatusPageError,
+                  "Problem with status page " << name << ": " << reason,
+                  ((std::string)name)((std::string)reason))
 } // namespace dunedaq
 
 #endif // TRIGEMU_INCLUDE_TRIGEMU_ISSUES_HPP_
\ No newline at end of file
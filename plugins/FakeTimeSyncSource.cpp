@@ -17,6 +17,8 @@
 #include "trigemu/faketimesyncsource/Nljs.hpp"
 #include "trigemu/faketimesyncsource/Structs.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 
 namespace dunedaq::trigemu {
@@ -26,6 +28,8 @@ FakeTimeSyncSource::FakeTimeSyncSource(const std::string& name)
   , m_running_flag{ false }
   , m_sync_interval_ticks{ 0 }
   , m_clock_frequency_hz{ 50 * 1000 * 1000 }
+  , m_clock(make_clock(false))
+  , m_sleeper(m_clock)
 {
   register_command("conf", &FakeTimeSyncSource::do_configure);
   register_command("start", &FakeTimeSyncSource::do_start);
@@ -49,55 +53,131 @@ FakeTimeSyncSource::do_configure(const nlohmann::json& confobj)
   auto params = confobj.get<faketimesyncsource::ConfParams>();
   m_sync_interval_ticks = params.sync_interval_ticks;
   m_clock_frequency_hz = params.clock_frequency_hz;
+  m_clock_participant.reset();
+  m_clock = make_clock(params.use_virtual_clock);
+  m_sleeper.set_clock(m_clock);
+  m_clock_participant = std::make_unique<Clock::Participant>(m_clock, 1);
+  m_replay_file = params.replay_file;
+  m_replay_time_scale = params.replay_time_scale;
+  m_timeline_file_prefix = params.timeline_file_prefix;
+  m_timeline_events_per_thread = params.timeline_events_per_thread;
 }
 
 void
-FakeTimeSyncSource::do_start(const nlohmann::json& /*startobj*/)
+FakeTimeSyncSource::do_start(const nlohmann::json& startobj)
 {
+  m_run_number = startobj.value<dunedaq::daqdataformats::run_number_t>("run", 0);
+  m_sleeper.reset();
+  // Read the file here, so that a bad one fails the start command
+  m_replay_trace.reset();
+  if (!m_replay_file.empty()) {
+    m_replay_trace = std::make_unique<TimeSyncTrace>(read_time_sync_file(m_replay_file));
+  }
+  m_sender_timeline = nullptr;
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.reset(m_timeline_events_per_thread, m_clock);
+    m_sender_timeline = m_timeline.add_thread("timesync-sender");
+  }
   m_running_flag.store(true);
-  m_threads.push_back(std::thread(&FakeTimeSyncSource::send_timesyncs, this, m_sync_interval_ticks));
+  m_clock_participant->rejoin();
+  if (m_replay_trace) {
+    m_threads.push_back(std::thread(&FakeTimeSyncSource::replay_timesyncs, this));
+  } else {
+    m_threads.push_back(std::thread(&FakeTimeSyncSource::send_timesyncs, this, m_sync_interval_ticks));
+  }
 }
 
 void
 FakeTimeSyncSource::do_stop(const nlohmann::json& /* stopobj */)
 {
   m_running_flag.store(false);
+  m_sleeper.interrupt();
   for (auto& thread : m_threads)
     thread.join();
   m_threads.clear();
+
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.write_for_run(m_timeline_file_prefix, m_run_number);
+    m_sender_timeline = nullptr;
+    m_timeline.reset(0);
+  }
 }
 
 void
 FakeTimeSyncSource::send_timesyncs(const dfmessages::timestamp_t timesync_interval_ticks)
 {
-
-  using namespace std::chrono;
-
-  // std::chrono is the worst
-  auto time_now = system_clock::now().time_since_epoch();
-  auto now_system_us = duration_cast<microseconds>(time_now).count();
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/timesync-sender");
+  auto now_system_us = m_clock->now_us();
   uint64_t now_timestamp = now_system_us / 1000000 * m_clock_frequency_hz; // NOLINT(build/unsigned)
 
   dfmessages::timestamp_t next_timestamp = (now_timestamp / timesync_interval_ticks + 1) * timesync_interval_ticks;
 
   while (true) {
     while (m_running_flag.load() && now_timestamp < next_timestamp) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      m_sleeper.sleep_for(std::chrono::milliseconds(1));
 
-      time_now = system_clock::now().time_since_epoch();
-      now_system_us = duration_cast<microseconds>(time_now).count();
+      now_system_us = m_clock->now_us();
       now_timestamp = now_system_us / 1000000 * m_clock_frequency_hz;
     }
     if (!m_running_flag.load())
       break;
     TLOG_DEBUG(1) << "Sending TimeSync timestamp =" << now_timestamp << ", system time = " << now_system_us;
     dfmessages::TimeSync now(now_timestamp, now_system_us);
+    now.run_number = m_run_number;
     m_time_sync_sink->send(std::move(now), std::chrono::milliseconds(1));
+    record_timeline_event(m_sender_timeline, TimelineEvent::kTimeSyncSent, 0, now_timestamp);
 
     next_timestamp += timesync_interval_ticks;
   }
 }
 
+void
+FakeTimeSyncSource::replay_timesyncs()
+{
+  // Each TimeSync is sent at the same time after the first as it
+  // arrived in the recording, times the scale. Its system_time is moved
+  // to match, keeping its offset from the arrival time, and its
+  // daq_time is scaled about the first one, so the DAQ clock still
+  // appears to run at the recorded rate. Everything else, including
+  // the order, the gaps and any TimeSyncs that went backwards, is
+  // reproduced as recorded
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/timesync-sender");
+  const auto& header = m_replay_trace->header;
+  const auto& records = m_replay_trace->records;
+  const auto& first = records.front();
+  const uint64_t start_us = m_clock->now_us(); // NOLINT(build/unsigned)
+  auto scaled = [this](uint64_t value, uint64_t origin) -> int64_t { // NOLINT(build/unsigned)
+    return std::llround((static_cast<double>(value) - static_cast<double>(origin)) * m_replay_time_scale);
+  };
+
+  TLOG_DEBUG(1) << "Replaying " << records.size() << " TimeSyncs from " << m_replay_file << ", recorded in run "
+                << header.run_number;
+  for (const auto& record : records) {
+    // NOLINTNEXTLINE(build/unsigned)
+    const uint64_t due_us = start_us + std::max<int64_t>(scaled(record.arrival_us, first.arrival_us), 0);
+    uint64_t now_us = m_clock->now_us(); // NOLINT(build/unsigned)
+    while (m_running_flag.load() && now_us < due_us) {
+      m_sleeper.sleep_for(std::chrono::microseconds(due_us - now_us));
+      now_us = m_clock->now_us();
+    }
+    if (!m_running_flag.load())
+      return;
+
+    dfmessages::TimeSync time_sync(first.daq_time + scaled(record.daq_time, first.daq_time),
+                                   record.system_time == 0 ? 0 : start_us + scaled(record.system_time, first.arrival_us));
+    time_sync.sequence_number = record.sequence_number;
+    time_sync.source_pid = record.source_pid;
+    // TimeSyncs of the recorded run belong to this one; those of other runs stay foreign
+    time_sync.run_number = record.run_number == header.run_number ? m_run_number : record.run_number;
+    TLOG_DEBUG(1) << "Sending replayed TimeSync timestamp =" << time_sync.daq_time
+                  << ", system time = " << time_sync.system_time;
+    const dfmessages::timestamp_t daq_time = time_sync.daq_time;
+    m_time_sync_sink->send(std::move(time_sync), std::chrono::milliseconds(1));
+    record_timeline_event(m_sender_timeline, TimelineEvent::kTimeSyncSent, 0, daq_time);
+  }
+  TLOG_DEBUG(1) << "Finished replaying TimeSyncs from " << m_replay_file;
+}
+
 } // namespace dunedaq::trigemu
 
 DEFINE_DUNE_DAQ_MODULE(dunedaq::trigemu::FakeTimeSyncSource)
@@ -8,6 +8,11 @@
 #ifndef TRIGEMU_PLUGINS_FAKETIMESYNCSOURCE_HPP_
 #define TRIGEMU_PLUGINS_FAKETIMESYNCSOURCE_HPP_
 
+#include "trigemu/Clock.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/TimeSyncFile.hpp"
+#include "trigemu/Timeline.hpp"
+
 #include "appfwk/DAQModule.hpp"
 #include "iomanager/Sender.hpp"
 #include "dfmessages/TimeSync.hpp"
@@ -37,14 +42,31 @@ private:
   void do_stop(const nlohmann::json& obj);
 
   void send_timesyncs(const dfmessages::timestamp_t timesync_interval_ticks);
+  void replay_timesyncs();
 
   std::atomic<bool> m_running_flag;
+  dfmessages::run_number_t m_run_number{ 0 };
   std::vector<std::thread> m_threads;
 
   std::shared_ptr<iomanager::SenderConcept<dfmessages::TimeSync>> m_time_sync_sink;
 
   dfmessages::timestamp_t m_sync_interval_ticks;
   uint64_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+
+  std::shared_ptr<Clock> m_clock;
+  InterruptibleSleeper m_sleeper;
+  std::unique_ptr<Clock::Participant> m_clock_participant;
+
+  // Optional recorded TimeSync stream to send instead, read at start
+  std::string m_replay_file;
+  double m_replay_time_scale{ 1.0 };
+  std::unique_ptr<TimeSyncTrace> m_replay_trace;
+
+  // Optional timeline of the TimeSyncs sent, written out at stop
+  std::string m_timeline_file_prefix;
+  size_t m_timeline_events_per_thread{ 0 };
+  Timeline m_timeline;
+  TimelineBuffer* m_sender_timeline{ nullptr };
 };
 
 } // namespace dunedaq::trigemu
@@ -20,6 +20,8 @@
 #include "logging/Logging.hpp"
 
 #include "trigemu/Issues.hpp"
+#include "trigemu/ShardedTimeline.hpp"
+#include "trigemu/SharedTimestampEstimator.hpp"
 #include "trigemu/TimestampEstimator.hpp"
 #include "trigemu/triggerdecisionemulator/Nljs.hpp"
 #include "trigemu/triggerdecisionemulatorinfo/InfoNljs.hpp"
@@ -29,30 +31,150 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
 #include <pthread.h>
 #include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace dunedaq {
 namespace trigemu {
 
+namespace {
+// The increase in a counter since it was last reported, which updates
+// `reported`. Counters are zeroed at start, so a smaller value is all new
+uint64_t // NOLINT(build/unsigned)
+since_last_report(uint64_t total, uint64_t& reported) // NOLINT(build/unsigned)
+{
+  uint64_t increase = total >= reported ? total - reported : total; // NOLINT(build/unsigned)
+  reported = total;
+  return increase;
+}
+
+// The streams described by the configuration
+std::vector<TriggerStreamConf>
+make_stream_confs(const triggerdecisionemulator::ConfParams& params)
+{
+  // Without any configured streams, the top-level parameters describe a single stream
+  auto stream_params = params.streams;
+  if (stream_params.empty()) {
+    triggerdecisionemulator::StreamConf single;
+    single.name = "default";
+    single.trigger_type = params.trigger_type;
+    single.links = params.links;
+    single.min_links_in_request = params.min_links_in_request;
+    single.max_links_in_request = params.max_links_in_request;
+    single.min_readout_window_ticks = params.min_readout_window_ticks;
+    single.max_readout_window_ticks = params.max_readout_window_ticks;
+    single.trigger_window_offset = params.trigger_window_offset;
+    single.trigger_interval_ticks = params.trigger_interval_ticks;
+    single.arrival_model = params.arrival_model;
+    single.arrival_jitter_ticks = params.arrival_jitter_ticks;
+    single.arrival_burst_interval_ticks = params.arrival_burst_interval_ticks;
+    single.arrival_burst_on_ticks = params.arrival_burst_on_ticks;
+    single.arrival_burst_off_ticks = params.arrival_burst_off_ticks;
+    single.arrival_burst_count = params.arrival_burst_count;
+    single.arrival_burst_window_ticks = params.arrival_burst_window_ticks;
+    single.arrival_seed = params.arrival_seed;
+    stream_params.push_back(single);
+  }
+
+  std::vector<TriggerStreamConf> streams;
+  std::set<std::string> stream_names;
+  for (auto const& sp : stream_params) {
+    TriggerStreamConf stream_conf;
+    stream_conf.name = sp.name.empty() ? "stream" + std::to_string(streams.size()) : sp.name;
+    stream_conf.trigger_type = sp.trigger_type;
+    for (auto const& link : sp.links) {
+      // For the future: Set APA properly
+      stream_conf.links.push_back(
+        dfmessages::GeoID{ dfmessages::GeoID::SystemType::kTPC, 0, static_cast<uint32_t>(link) }); // NOLINT
+    }
+    stream_conf.min_links_in_request = sp.min_links_in_request;
+    stream_conf.max_links_in_request = sp.max_links_in_request;
+    stream_conf.trigger_window_offset = sp.trigger_window_offset;
+    stream_conf.min_readout_window_ticks = sp.min_readout_window_ticks;
+    stream_conf.max_readout_window_ticks = sp.max_readout_window_ticks;
+
+    stream_conf.arrival.model = sp.arrival_model;
+    stream_conf.arrival.interval_ticks = sp.trigger_interval_ticks;
+    stream_conf.arrival.jitter_ticks = sp.arrival_jitter_ticks;
+    stream_conf.arrival.burst_interval_ticks = sp.arrival_burst_interval_ticks;
+    stream_conf.arrival.burst_on_ticks = sp.arrival_burst_on_ticks;
+    stream_conf.arrival.burst_off_ticks = sp.arrival_burst_off_ticks;
+    stream_conf.arrival.burst_count = sp.arrival_burst_count;
+    stream_conf.arrival.burst_window_ticks = sp.arrival_burst_window_ticks;
+    stream_conf.arrival.seed = sp.arrival_seed;
+
+    // Sanity-check the values
+    if (sp.min_readout_window_ticks > sp.max_readout_window_ticks ||
+        sp.min_links_in_request > sp.max_links_in_request || !stream_names.insert(stream_conf.name).second) {
+      throw InvalidConfiguration(ERS_HERE);
+    }
+    // Throws InvalidArrivalModel now, rather than at start, if the model is unusable
+    make_arrival_model(stream_conf.arrival);
+
+    streams.push_back(stream_conf);
+  }
+  return streams;
+}
+} // namespace
+
+TriggerDecisionEmulator::TriggerStream::TriggerStream(const TriggerStreamConf& stream_conf)
+  : conf(stream_conf)
+{}
+
+TriggerDecisionEmulator::DecisionConf::DecisionConf(const TriggerStreamConf& stream_conf,
+                                                    const TriggerTypeDistributions& distributions)
+  : conf(stream_conf)
+  , n_links_dist(conf.min_links_in_request, std::min((size_t)conf.max_links_in_request, conf.links.size()))
+  , window_ticks_dist(conf.min_readout_window_ticks, conf.max_readout_window_ticks)
+  , link_count_histogram(distributions.link_count)
+  , window_ticks_histogram(distributions.window_ticks)
+{}
+
+std::unique_ptr<TriggerDecisionEmulator::DecisionConfs>
+TriggerDecisionEmulator::make_decision_confs(const std::vector<TriggerStreamConf>& stream_confs,
+                                             const std::string& distribution_file)
+{
+  std::map<dfmessages::trigger_type_t, TriggerTypeDistributions> distributions;
+  if (!distribution_file.empty()) {
+    distributions = load_distribution_file(distribution_file);
+  }
+  auto decision_confs = std::make_unique<DecisionConfs>();
+  for (auto const& stream_conf : stream_confs) {
+    auto it = distributions.find(stream_conf.trigger_type);
+    decision_confs->emplace_back(stream_conf, it != distributions.end() ? it->second : TriggerTypeDistributions{});
+  }
+  return decision_confs;
+}
+
 TriggerDecisionEmulator::TriggerDecisionEmulator(const std::string& name)
   : DAQModule(name)
   , m_time_sync_source(nullptr)
   , m_trigger_inhibit_source(nullptr)
   , m_token_source(nullptr)
-  , m_trigger_decision_sink(nullptr)
   , m_inhibited(false)
   , m_last_trigger_number(0)
   , m_run_number(0)
+  , m_clock(make_clock(false))
+  , m_sleeper(m_clock)
 {
+  m_tokens.set_clock(m_clock);
   register_command("conf", &TriggerDecisionEmulator::do_configure);
   register_command("start", &TriggerDecisionEmulator::do_start);
   register_command("stop", &TriggerDecisionEmulator::do_stop);
   register_command("pause", &TriggerDecisionEmulator::do_pause);
   register_command("resume", &TriggerDecisionEmulator::do_resume);
   register_command("scrap", &TriggerDecisionEmulator::do_scrap);
+  register_command("update", &TriggerDecisionEmulator::do_update);
 }
 
 void
@@ -62,22 +184,178 @@ TriggerDecisionEmulator::init(const nlohmann::json& iniobj)
   auto qi = appfwk::connection_index(
     iniobj, { "time_sync_source", "trigger_inhibit_source", "trigger_decision_sink", "token_source" });
   m_time_sync_source = get_iom_receiver<dfmessages::TimeSync>(qi["time_sync_source"]);
+  m_time_sync_connection = qi["time_sync_source"].uid;
   m_trigger_inhibit_source = get_iom_receiver<dfmessages::TriggerInhibit>(qi["trigger_inhibit_source"]);
-  m_trigger_decision_sink = get_iom_sender<dfmessages::TriggerDecision>(qi["trigger_decision_sink"]);
   m_token_source = get_iom_receiver<dfmessages::TriggerDecisionToken>(qi["token_source"]);
+
+  // Decisions can go to several sinks: trigger_decision_sink itself,
+  // and any connections named trigger_decision_sink_<something>
+  std::vector<appfwk::app::ConnectionReference> sink_refs;
+  for (auto const& ref : ini.conn_refs) {
+    if (ref.name == "trigger_decision_sink" || ref.name.rfind("trigger_decision_sink_", 0) == 0) {
+      sink_refs.push_back(ref);
+    }
+  }
+  std::sort(sink_refs.begin(), sink_refs.end(), [](auto const& a, auto const& b) { return a.name < b.name; });
+  for (auto const& ref : sink_refs) {
+    m_dispatcher.add_sink(ref.name, get_iom_sender<dfmessages::TriggerDecision>(ref));
+  }
+
+  // Each inhibit region has its own connection, trigger_inhibit_source_<region>
+  const std::string region_prefix = "trigger_inhibit_source_";
+  for (auto const& ref : ini.conn_refs) {
+    if (ref.name.rfind(region_prefix, 0) == 0) {
+      m_region_inhibit_sources[ref.name.substr(region_prefix.size())] =
+        get_iom_receiver<dfmessages::TriggerInhibit>(ref);
+    }
+  }
 }
 
 void
-TriggerDecisionEmulator::get_info(opmonlib::InfoCollector& ci, int /*level*/)
+TriggerDecisionEmulator::get_info(opmonlib::InfoCollector& ci, int level)
 {
   triggerdecisionemulatorinfo::Info tde;
+  std::shared_ptr<Clock> clock;
+  {
+    std::lock_guard<std::mutex> lk(m_clock_mutex);
+    clock = m_clock;
+  }
+
+  tde.triggers = m_sender_counters.get(SenderCounter::kTriggers);
+  tde.new_triggers = since_last_report(tde.triggers, m_reported_triggers);
+  tde.inhibited = m_sender_counters.get(SenderCounter::kInhibited);
+  tde.new_inhibited = since_last_report(tde.inhibited, m_reported_inhibited);
+  tde.start_to_first_decision_us = m_start_to_first_decision_us.load();
+  tde.stop_to_joined_us = m_stop_to_joined_us.load();
+  tde.stop_to_drained_us = m_stop_to_drained_us.load();
+  tde.undrained_at_stop = m_undrained_at_stop.load();
+  tde.other_run_inhibits = m_inhibit_counters.get(InhibitCounter::kOtherRunInhibits);
+  tde.other_run_tokens = m_token_counters.get(TokenCounter::kOtherRunTokens);
+  tde.tokens_received = m_token_counters.get(TokenCounter::kTokens);
+  tde.tokens_available = m_tokens.available();
+  tde.token_starved_us = m_tokens.get_starved_us();
+  tde.token_starved_count = m_tokens.get_starved_count();
+  tde.partial_token_grants = m_sender_counters.get(SenderCounter::kPartialTokenGrants);
+  tde.decisions_not_sent = m_sender_counters.get(SenderCounter::kDecisionsNotSent);
+  tde.stale_estimate_skipped = m_sender_counters.get(SenderCounter::kStaleEstimate);
+  tde.expired = m_sender_counters.get(SenderCounter::kExpired) + m_token_counters.get(TokenCounter::kStaleExpired);
+  tde.busy_regions = __builtin_popcountll(m_region_inhibits.busy_regions());
+  tde.masked_components = m_sender_counters.get(SenderCounter::kMaskedComponents);
+  tde.region_inhibited = m_sender_counters.get(SenderCounter::kRegionInhibited);
+  tde.rate_step = m_rate_step.load();
+  tde.saturated_step = m_saturated_step.load();
+  for (auto const& sink : m_dispatcher.get_sinks()) {
+    tde.send_failures += sink->send_failures.load();
+  }
+  tde.open_decisions = m_open_trigger_decisions.size();
+  tde.stale_reclaimed = m_token_counters.get(TokenCounter::kStaleReclaimed);
+  tde.stale_resent = m_token_counters.get(TokenCounter::kStaleResent);
+  tde.stale_warned = m_token_counters.get(TokenCounter::kStaleWarned);
+  tde.late_tokens = m_token_counters.get(TokenCounter::kLateTokens);
+  tde.unknown_tokens = m_token_counters.get(TokenCounter::kUnknownTokens);
+
+  // Fractions of the time since the last report spent inhibited and paused
+  const uint64_t now_us = clock->now_us(); // NOLINT(build/unsigned)
+  const uint64_t inhibited_us = since_last_report(m_inhibited_time.total_us(now_us), m_reported_inhibited_us); // NOLINT
+  const uint64_t paused_us = since_last_report(m_paused_time.total_us(now_us), m_reported_paused_us);          // NOLINT
+  const double elapsed_us = m_reported_time_us != 0 && now_us > m_reported_time_us ? now_us - m_reported_time_us : 0;
+  if (elapsed_us > 0) {
+    tde.inhibited_fraction = std::min(1., inhibited_us / elapsed_us);
+    tde.paused_fraction = std::min(1., paused_us / elapsed_us);
+  }
+  m_reported_time_us = now_us;
+
+  {
+    std::lock_guard<std::mutex> lk(m_recorder_mutex);
+    tde.recorded = m_recorder ? m_recorder->get_recorded_count() : m_recorded_count.load();
+    tde.record_dropped = m_recorder ? m_recorder->get_dropped_count() : m_record_dropped_count.load();
+  }
+  uint64_t estimator_cpu_time_us = 0; // NOLINT(build/unsigned)
+  {
+    std::lock_guard<std::mutex> lk(m_timestamp_estimator_mutex);
+    if (m_timestamp_estimator) {
+      tde.other_run_time_syncs = m_timestamp_estimator->get_other_run_time_sync_count();
+      auto snapshot = m_timestamp_estimator->get_snapshot();
+      if (snapshot.valid) {
+        tde.estimate_age_ms = snapshot.age_us / 1000;
+        tde.estimate_error_ticks = snapshot.error_ticks;
+        tde.time_sync_rate_hz = snapshot.rate_hz;
+      }
+      estimator_cpu_time_us = m_timestamp_estimator->get_cpu_time_us();
+    }
+  }
 
-  tde.triggers = m_trigger_count_tot.load();
-  tde.new_triggers = m_trigger_count.exchange(0);
-  tde.inhibited = m_inhibited_trigger_count_tot.load();
-  tde.new_inhibited = m_inhibited_trigger_count.exchange(0);
+  {
+    std::lock_guard<std::mutex> lk(m_run_report_mutex);
+    if (m_unpublished_run_report) {
+      opmonlib::InfoCollector report_ci;
+      report_ci.add(*m_unpublished_run_report);
+      ci.add("run_report", report_ci);
+      m_unpublished_run_report.reset();
+    }
+  }
+
+  if (level < s_detailed_info_level) {
+    ci.add(tde);
+    return;
+  }
 
+  // The details: these take locks that the sending and token threads also take, or scan containers
+  tde.oldest_open_age_ms = m_open_trigger_decisions.oldest_age(clock->now()).count();
   ci.add(tde);
+
+  for (auto const& [thread_name, cpu_time_us] : { std::make_pair("tde-trig-dec", m_sender_counters.get_cpu_time_us()),
+                                                  std::make_pair("tde-inhibit-q", m_inhibit_counters.get_cpu_time_us()),
+                                                  std::make_pair("tde-token-q", m_token_counters.get_cpu_time_us()),
+                                                  std::make_pair("tde-ts-est", estimator_cpu_time_us) }) {
+    triggerdecisionemulatorinfo::ThreadInfo ti;
+    ti.cpu_time_us = cpu_time_us;
+    opmonlib::InfoCollector thread_ci;
+    thread_ci.add(ti);
+    ci.add(thread_name, thread_ci);
+  }
+
+  std::lock_guard<std::mutex> lk(m_streams_mutex);
+  for (auto& stream : m_streams) {
+    triggerdecisionemulatorinfo::StreamInfo si;
+    si.triggers = stream->trigger_count.load();
+    si.new_triggers = since_last_report(si.triggers, stream->reported_triggers);
+    si.inhibited = stream->inhibited_trigger_count.load();
+    si.new_inhibited = since_last_report(si.inhibited, stream->reported_inhibited);
+
+    opmonlib::InfoCollector stream_ci;
+    stream_ci.add(si);
+    ci.add(stream->conf.name, stream_ci);
+  }
+
+  m_region_inhibits.for_each_region([&](RegionInhibits::Region& region) {
+    triggerdecisionemulatorinfo::RegionInfo ri;
+    ri.busy = region.busy.load() ? 1 : 0;
+    const uint64_t busy_us = since_last_report(region.busy_time.total_us(now_us), region.reported_busy_us); // NOLINT
+    if (elapsed_us > 0) {
+      ri.busy_fraction = std::min(1., busy_us / elapsed_us);
+    }
+    ri.masked_components = region.masked_components.load();
+    ri.new_masked_components = since_last_report(ri.masked_components, region.reported_masked_components);
+    ri.suppressed = region.suppressed.load();
+    ri.new_suppressed = since_last_report(ri.suppressed, region.reported_suppressed);
+
+    opmonlib::InfoCollector region_ci;
+    region_ci.add(ri);
+    ci.add("region_" + region.name, region_ci);
+  });
+
+  for (auto& sink : m_dispatcher.get_sinks()) {
+    triggerdecisionemulatorinfo::SinkInfo si;
+    si.sent = sink->sent.load();
+    si.new_sent = since_last_report(si.sent, sink->reported_sent);
+    si.outstanding = std::max<int64_t>(0, sink->outstanding.load());
+    si.send_failures = sink->send_failures.load();
+
+    opmonlib::InfoCollector sink_ci;
+    sink_ci.add(si);
+    ci.add(sink->name, sink_ci);
+  }
 }
 
 void
@@ -85,14 +363,8 @@ TriggerDecisionEmulator::do_configure(const nlohmann::json& confobj)
 {
   auto params = confobj.get<triggerdecisionemulator::ConfParams>();
 
-  m_min_readout_window_ticks = params.min_readout_window_ticks;
-  m_max_readout_window_ticks = params.max_readout_window_ticks;
-  m_trigger_window_offset = params.trigger_window_offset;
-
-  m_min_links_in_request = params.min_links_in_request;
-  m_max_links_in_request = params.max_links_in_request;
-
   m_trigger_interval_ticks.store(params.trigger_interval_ticks);
+  m_configured_interval_ticks = params.trigger_interval_ticks;
 
   m_trigger_offset = params.trigger_offset;
   trigger_delay_ticks_ = params.trigger_delay_ticks;
@@ -100,20 +372,143 @@ TriggerDecisionEmulator::do_configure(const nlohmann::json& confobj)
   m_repeat_trigger_count = params.repeat_trigger_count;
 
   m_stop_burst_count = params.stop_burst_count;
+  m_stop_burst_interval = std::chrono::microseconds(params.stop_burst_interval_us);
+  m_stop_drain_deadline = std::chrono::milliseconds(params.stop_drain_deadline_ms);
   m_initial_tokens = params.initial_token_count;
 
-  m_links.clear();
-  for (auto const& link : params.links) {
-    // For the future: Set APA properly
-    m_links.push_back(
-      dfmessages::GeoID{ dfmessages::GeoID::SystemType::kTPC, 0, static_cast<uint32_t>(link) }); // NOLINT
+  m_trace_file = params.trace_file;
+  m_trace_time_scale = params.trace_time_scale;
+  m_trace_start_offset_ticks = params.trace_start_offset_ticks;
+  m_trace_loop = params.trace_loop;
+
+  m_record_file_prefix = params.record_file_prefix;
+  m_record_max_file_bytes = params.record_max_file_bytes;
+  m_record_index_interval = params.record_index_interval;
+  m_record_fsync = params.record_fsync;
+  m_time_sync_record_file_prefix = params.time_sync_record_file_prefix;
+  m_timeline_file_prefix = params.timeline_file_prefix;
+  m_run_report_file_prefix = params.run_report_file_prefix;
+  m_timeline_events_per_thread = params.timeline_events_per_thread;
+  if (params.status_page_name != m_status_page_name || !m_status_page) {
+    m_status_page.reset();
+    m_status_page_name = params.status_page_name;
+    if (!m_status_page_name.empty()) {
+      m_status_page = std::make_unique<StatusPageWriter>(m_status_page_name);
+      m_status = statuspage::Status{};
+      publish_status(statuspage::State::kStopped);
+    }
+  }
+
+  // Our clock-paced threads: the trigger decision sender and the queue
+  // readers that have a queue to read. The timestamp estimator counts
+  // its own thread, since it may be shared with other modules
+  m_clock_participant.reset();
+  {
+    std::lock_guard<std::mutex> lk(m_clock_mutex);
+    m_clock = make_clock(params.use_virtual_clock);
+  }
+  m_sleeper.set_clock(m_clock);
+  m_tokens.set_clock(m_clock);
+  const bool reads_inhibits = m_trigger_inhibit_source != nullptr || !m_region_inhibit_sources.empty();
+  m_clock_participant = std::make_unique<Clock::Participant>(
+    m_clock, 1 + (reads_inhibits ? 1 : 0) + (m_token_source != nullptr ? 1 : 0));
+
+  auto stream_confs = make_stream_confs(params);
+  std::vector<std::unique_ptr<TriggerStream>> streams;
+  for (auto const& stream_conf : stream_confs) {
+    streams.push_back(std::make_unique<TriggerStream>(stream_conf));
+  }
+  auto decision_confs = make_decision_confs(stream_confs, params.distribution_file);
+
+  if (m_trace_time_scale <= 0 || m_record_index_interval == 0) {
+    throw InvalidConfiguration(ERS_HERE);
+  }
+
+  RateScheduleParams rate_params;
+  rate_params.model = params.rate_schedule;
+  for (auto const& step : params.rate_steps) {
+    rate_params.steps.push_back(RateStep{ step.rate_hz, std::chrono::milliseconds(step.duration_ms) });
+  }
+  rate_params.start_rate_hz = params.rate_ramp_start_hz;
+  rate_params.end_rate_hz = params.rate_ramp_end_hz;
+  rate_params.step_count = params.rate_ramp_step_count;
+  rate_params.step_duration = std::chrono::milliseconds(params.rate_ramp_step_duration_ms);
+  auto rate_steps = make_rate_steps(rate_params); // Throws InvalidRateSchedule
+  m_rate_schedule.reset();
+  if (!rate_steps.empty()) {
+    // The steps' rates are shared between the streams in proportion to their configured rates
+    double configured_rate_hz = 0;
+    for (auto const& stream_conf : stream_confs) {
+      configured_rate_hz += mean_rate_hz(stream_conf.arrival, m_clock_frequency_hz);
+    }
+    if (!(configured_rate_hz > 0)) {
+      throw InvalidRateSchedule(ERS_HERE, rate_params.model, "the trigger streams have no rate to scale");
+    }
+    m_rate_schedule = std::make_unique<RateSchedule>(std::move(rate_steps),
+                                                     m_clock_frequency_hz,
+                                                     m_configured_interval_ticks,
+                                                     configured_rate_hz,
+                                                     params.saturation_tolerance);
   }
 
-  // Sanity-check the values
-  if (m_min_readout_window_ticks > m_max_readout_window_ticks || m_min_links_in_request > m_max_links_in_request) {
+  m_shard_count = params.shard_count;
+  m_shard_index = params.shard_index;
+  m_shard_epoch_ticks = params.shard_epoch_ticks;
+  if (m_shard_count == 0 || m_shard_index >= m_shard_count || m_shard_epoch_ticks <= 0) {
     throw InvalidConfiguration(ERS_HERE);
   }
 
+  if (params.stale_policy == "reclaim") {
+    m_stale_policy = StalePolicy::kReclaim;
+  } else if (params.stale_policy == "resend") {
+    m_stale_policy = StalePolicy::kResend;
+  } else if (params.stale_policy == "warn") {
+    m_stale_policy = StalePolicy::kWarn;
+  } else {
+    throw InvalidConfiguration(ERS_HERE);
+  }
+  m_max_resends = params.max_resends;
+  m_token_wait = std::chrono::milliseconds(params.token_wait_ms);
+  m_max_time_sync_age = std::chrono::milliseconds(params.max_time_sync_age_ms);
+  m_readout_buffer_depth_ticks = params.readout_buffer_depth_ticks;
+  m_emit_when_window_complete = params.emit_when_window_complete;
+  m_window_margin_ticks = params.window_margin_ticks;
+  m_share_timestamp_estimator = params.share_timestamp_estimator;
+  m_allow_partial_token_grant = params.allow_partial_token_grant;
+  m_open_trigger_decisions.configure(std::chrono::milliseconds(params.open_decision_timeout_ms),
+                                     m_stale_policy == StalePolicy::kResend ? params.resend_journal_size : 0);
+
+  // Every region needs its connection, and every region connection needs its links
+  std::vector<std::unique_ptr<RegionInhibits::Region>> regions;
+  std::vector<inhibit_source_t> region_receivers;
+  for (auto const& region_conf : params.inhibit_regions) {
+    auto it = m_region_inhibit_sources.find(region_conf.name);
+    if (it == m_region_inhibit_sources.end()) {
+      throw InvalidInhibitRegion(ERS_HERE, region_conf.name, "there's no trigger_inhibit_source_" + region_conf.name);
+    }
+    std::vector<uint32_t> links(region_conf.links.begin(), region_conf.links.end()); // NOLINT(build/unsigned)
+    regions.push_back(std::make_unique<RegionInhibits::Region>(region_conf.name, links));
+    region_receivers.push_back(it->second);
+  }
+  for (auto const& [name, source] : m_region_inhibit_sources) {
+    if (std::none_of(regions.begin(), regions.end(), [&](auto const& region) { return region->name == name; })) {
+      throw InvalidInhibitRegion(ERS_HERE, name, "trigger_inhibit_source_" + name + " has no links configured");
+    }
+  }
+  m_region_inhibits.configure(parse_region_inhibit_policy(params.region_inhibit_policy), std::move(regions));
+  m_region_inhibit_receivers.swap(region_receivers);
+
+  m_dispatcher.configure(parse_dispatch_policy(params.dispatch_policy),
+                         std::chrono::milliseconds(params.sink_send_timeout_ms),
+                         std::chrono::milliseconds(params.sink_backoff_ms),
+                         m_token_source != nullptr);
+
+  {
+    std::lock_guard<std::mutex> lk(m_streams_mutex);
+    m_streams.swap(streams);
+  }
+  m_decision_conf_mailbox.publish(std::move(decision_confs));
+
   m_configured_flag.store(true);
 }
 
@@ -127,14 +522,94 @@ TriggerDecisionEmulator::do_start(const nlohmann::json& startobj)
     throw InvalidTriggerInterval(ERS_HERE, start_pars.trigger_interval_ticks);
   }
 
+  m_start_time = std::chrono::steady_clock::now();
+  m_first_decision_sent.store(false);
+  m_estimate_stale = false;
+  m_start_to_first_decision_us.store(0);
+  m_sender_counters.reset();
+  m_inhibit_counters.reset();
+  m_token_counters.reset();
+  for (auto& stream : m_streams) {
+    stream->trigger_count.store(0);
+    stream->inhibited_trigger_count.store(0);
+  }
+
   m_paused.store(true);
   m_inhibited.store(false);
+  m_paused_time.reset();
+  m_run_start_us = m_clock->now_us();
+  m_paused_time.set(true, m_run_start_us);
+  m_inhibited_time.reset();
+  m_region_inhibits.reset();
+  m_round_trip_us_bins.fill(0);
+  m_round_trip_count = 0;
+  m_round_trip_max_us = 0;
+  m_sleeper.reset();
   m_running_flag.store(true);
 
-  m_tokens.store(m_initial_tokens);
+  m_tokens.reset(m_initial_tokens);
   m_open_trigger_decisions.clear();
+  m_dispatcher.reset();
+
+  // Open the trace here rather than in the sending thread, so that a bad file fails the start command
+  m_trace_replay.reset();
+  if (!m_trace_file.empty()) {
+    m_trace_replay =
+      std::make_unique<TriggerTraceReplay>(m_trace_file, m_trace_time_scale, m_trace_start_offset_ticks, m_trace_loop);
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(m_recorder_mutex);
+    m_recorder.reset();
+    m_recorded_count.store(0);
+    m_record_dropped_count.store(0);
+    if (!m_record_file_prefix.empty()) {
+      m_recorder = std::make_unique<DecisionRecorder>(
+        m_record_file_prefix, m_run_number, m_record_max_file_bytes, m_record_index_interval, m_record_fsync);
+    }
+  }
+
+  m_status = statuspage::Status{};
+  publish_status(statuspage::State::kRunning);
+
+  m_rate_step.store(-1);
+  m_saturated_step.store(-1);
+  {
+    std::lock_guard<std::mutex> lk(m_rate_step_reports_mutex);
+    m_rate_step_reports.clear();
+  }
 
-  m_timestamp_estimator.reset(new TimestampEstimator(m_time_sync_source, m_clock_frequency_hz));
+  m_sender_timeline = m_inhibit_timeline = m_token_timeline = m_estimator_timeline = nullptr;
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.reset(m_timeline_events_per_thread, m_clock);
+    m_sender_timeline = m_timeline.add_thread("tde-trig-dec");
+    m_inhibit_timeline = m_timeline.add_thread("tde-inhibit-q");
+    m_token_timeline = m_timeline.add_thread("tde-token-q");
+    m_estimator_timeline = m_timeline.add_thread("tde-ts-est");
+  }
+
+  // Our threads left the clock when they finished last run
+  m_clock_participant->rejoin();
+
+  {
+    std::lock_guard<std::mutex> lk(m_timestamp_estimator_mutex);
+    if (m_share_timestamp_estimator) {
+      m_timestamp_estimator = acquire_shared_timestamp_estimator(
+        m_time_sync_connection, m_time_sync_source, m_clock_frequency_hz, m_run_number, m_clock);
+    } else {
+      if (!m_time_sync_record_file_prefix.empty()) {
+        m_time_sync_recorder =
+          std::make_unique<TimeSyncRecorder>(m_time_sync_record_file_prefix, m_run_number, m_clock_frequency_hz);
+      }
+      m_timestamp_estimator = std::make_shared<TimestampEstimator>(m_time_sync_source,
+                                                                   m_clock_frequency_hz,
+                                                                   m_run_number,
+                                                                   m_clock,
+                                                                   m_estimator_timeline,
+                                                                   m_time_sync_recorder.get(),
+                                                                   get_name() + "/ts-est");
+    }
+  }
 
   m_read_inhibit_queue_thread = std::thread(&TriggerDecisionEmulator::read_inhibit_queue, this);
   pthread_setname_np(m_read_inhibit_queue_thread.native_handle(), "tde-inhibit-q");
@@ -142,26 +617,140 @@ TriggerDecisionEmulator::do_start(const nlohmann::json& startobj)
   m_read_token_queue_thread = std::thread(&TriggerDecisionEmulator::read_token_queue, this);
   pthread_setname_np(m_read_token_queue_thread.native_handle(), "tde-token-q");
 
-  m_send_trigger_decisions_thread = std::thread(&TriggerDecisionEmulator::send_trigger_decisions, this);
+  // The sending loop is compiled for each combination of policies, so it doesn't test them for every trigger
+  if (m_token_source != nullptr) {
+    start_sending(TokenAdmission(m_tokens, m_clock, m_token_wait, m_allow_partial_token_grant, m_running_flag));
+  } else {
+    start_sending(FreeAdmission());
+  }
   pthread_setname_np(m_send_trigger_decisions_thread.native_handle(), "tde-trig-dec");
 }
 
+template<typename Admission>
+void
+TriggerDecisionEmulator::start_sending(Admission admission)
+{
+  if (m_trigger_inhibit_source != nullptr || !m_region_inhibit_receivers.empty()) {
+    start_sending(admission, InhibitQueues(m_inhibited, m_region_inhibits));
+  } else {
+    start_sending(admission, NoInhibitSource());
+  }
+}
+
+template<typename Admission, typename InhibitSource>
+void
+TriggerDecisionEmulator::start_sending(Admission admission, InhibitSource inhibits)
+{
+  if (m_trace_replay) {
+    start_sending<Admission, InhibitSource, ReplayedTriggers>(admission, inhibits);
+  } else {
+    start_sending<Admission, InhibitSource, GeneratedTriggers>(admission, inhibits);
+  }
+}
+
+template<typename Admission, typename InhibitSource, typename Triggers>
+void
+TriggerDecisionEmulator::start_sending(Admission admission, InhibitSource inhibits)
+{
+  if (m_dispatcher.get_sinks().size() == 1) {
+    auto fn = &TriggerDecisionEmulator::send_trigger_decisions<Admission, InhibitSource, Triggers, OnlySinkDispatch>;
+    m_send_trigger_decisions_thread = std::thread(fn, this, admission, inhibits, OnlySinkDispatch(m_dispatcher));
+  } else {
+    auto fn = &TriggerDecisionEmulator::send_trigger_decisions<Admission, InhibitSource, Triggers, PolicyDispatch>;
+    m_send_trigger_decisions_thread = std::thread(fn, this, admission, inhibits, PolicyDispatch(m_dispatcher));
+  }
+}
+
 void
 TriggerDecisionEmulator::do_stop(const nlohmann::json& /*stopobj*/)
 {
+  // The stop burst's tokens and the drain have the same deadline, on the emulator's clock
+  const auto stop_time = m_clock->now();
+  m_drain_deadline = stop_time + m_stop_drain_deadline;
+  // The token thread carries on until the open decisions have drained
+  const bool drain = m_token_source != nullptr && m_stop_drain_deadline.count() > 0;
+  m_draining.store(drain);
+  m_last_drain_close_ns.store(0);
   m_running_flag.store(false);
+  m_sleeper.interrupt();
 
   m_read_inhibit_queue_thread.join();
-  m_read_token_queue_thread.join();
   m_send_trigger_decisions_thread.join();
+  const auto sent_time = m_clock->now();
+
+  m_stop_to_drained_us.store(0);
+  m_undrained_at_stop.store(0);
+  if (drain) {
+    // The token thread wakes us when it closes the last open decision
+    m_clock->wait_until(m_drain_deadline, [this]() { return m_open_trigger_decisions.size() == 0; });
+    if (m_open_trigger_decisions.size() == 0) {
+      // Drained when the last token came back, or when the last decision was sent if that was later
+      auto drained_time = std::max(
+        sent_time,
+        Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::nanoseconds(m_last_drain_close_ns.load()))));
+      m_stop_to_drained_us.store(
+        std::chrono::duration_cast<std::chrono::microseconds>(drained_time - stop_time).count());
+      TLOG() << "Open trigger decisions drained " << m_stop_to_drained_us.load() << " us after stop";
+    } else {
+      m_undrained_at_stop.store(m_open_trigger_decisions.size());
+      ers::warning(StopDrainIncomplete(ERS_HERE, m_undrained_at_stop.load(), m_stop_drain_deadline.count()));
+    }
+    m_draining.store(false);
+    m_clock->notify();
+  }
+  m_read_token_queue_thread.join();
 
-  m_timestamp_estimator.reset(nullptr); // Calls TimestampEstimator dtor
+  publish_status(statuspage::State::kStopped);
+
+  // The time fractions are for the run
+  const uint64_t stop_us = m_clock->now_us(); // NOLINT(build/unsigned)
+  m_inhibited_time.set(false, stop_us);
+  m_region_inhibits.end_run(stop_us);
+  m_paused_time.set(false, stop_us);
+
+  auto report = make_run_report(stop_us);
+  if (!m_run_report_file_prefix.empty()) {
+    write_run_report(report);
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_run_report_mutex);
+    m_unpublished_run_report = std::make_unique<triggerdecisionemulatorinfo::RunReport>(report);
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(m_timestamp_estimator_mutex);
+    m_timestamp_estimator.reset(); // Calls TimestampEstimator dtor, unless it's shared and still in use
+  }
+  // The estimator thread that wrote to it has gone
+  m_time_sync_recorder.reset();
+
+  {
+    std::lock_guard<std::mutex> lk(m_recorder_mutex);
+    if (m_recorder) {
+      m_recorder->close(); // Writes out everything that's left
+      m_recorded_count.store(m_recorder->get_recorded_count());
+      m_record_dropped_count.store(m_recorder->get_dropped_count());
+      m_recorder.reset(nullptr);
+    }
+  }
+
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.write_for_run(m_timeline_file_prefix, m_run_number);
+    m_sender_timeline = m_inhibit_timeline = m_token_timeline = m_estimator_timeline = nullptr;
+    m_timeline.reset(0);
+  }
+
+  m_stop_to_joined_us.store(
+    std::chrono::duration_cast<std::chrono::microseconds>(m_clock->now() - stop_time).count());
+  TLOG_DEBUG(0) << "Stop took " << m_stop_to_joined_us.load() << " us to join all threads";
 }
 
 void
 TriggerDecisionEmulator::do_pause(const nlohmann::json& /*pauseobj*/)
 {
   m_paused.store(true);
+  m_paused_time.set(true, m_clock->now_us());
   TLOG() << "******* Triggers PAUSED! *********";
 }
 
@@ -176,39 +765,77 @@ TriggerDecisionEmulator::do_resume(const nlohmann::json& resumeobj)
 
   TLOG() << "******* Triggers RESUMED! *********";
   m_paused.store(false);
+  m_paused_time.set(false, m_clock->now_us());
 }
 
 void
 TriggerDecisionEmulator::do_scrap(const nlohmann::json& /*stopobj*/)
 {
+  m_clock_participant.reset();
+  m_status_page.reset();
+  m_status_page_name.clear();
   m_configured_flag.store(false);
 }
 
-dfmessages::TriggerDecision
-TriggerDecisionEmulator::create_decision(dfmessages::timestamp_t timestamp)
+void
+TriggerDecisionEmulator::do_update(const nlohmann::json& updateobj)
+{
+  if (!m_configured_flag.load()) {
+    throw InvalidUpdate(ERS_HERE, "the module hasn't been configured");
+  }
+  auto params = updateobj.get<triggerdecisionemulator::ConfParams>();
+  auto stream_confs = make_stream_confs(params);
+  {
+    std::lock_guard<std::mutex> lk(m_streams_mutex);
+    if (stream_confs.size() != m_streams.size()) {
+      throw InvalidUpdate(ERS_HERE, "the number of streams can't change");
+    }
+    for (size_t i = 0; i < stream_confs.size(); ++i) {
+      if (stream_confs[i].name != m_streams[i]->conf.name) {
+        throw InvalidUpdate(ERS_HERE, "stream " + m_streams[i]->conf.name + " is now " + stream_confs[i].name);
+      }
+    }
+  }
+
+  // The distribution file is read again, so it can be changed too
+  m_decision_conf_mailbox.publish(make_decision_confs(stream_confs, params.distribution_file));
+  TLOG() << "Updated the trigger types, links and readout windows of " << stream_confs.size() << " streams";
+}
+
+void
+TriggerDecisionEmulator::take_decision_confs()
 {
-  static std::default_random_engine random_engine(m_run_number);
-  static std::uniform_int_distribution<int> n_links_dist(m_min_links_in_request,
-                                                         std::min((size_t)m_max_links_in_request, m_links.size()));
-  static std::uniform_int_distribution<dfmessages::timestamp_t> window_ticks_dist(m_min_readout_window_ticks,
-                                                                                  m_max_readout_window_ticks);
+  if (auto confs = m_decision_conf_mailbox.take()) {
+    m_decision_confs = std::move(confs);
+  }
+}
 
+dfmessages::TriggerDecision
+TriggerDecisionEmulator::create_decision(size_t stream_index, dfmessages::timestamp_t timestamp)
+{
+  auto& stream = (*m_decision_confs)[stream_index];
   dfmessages::TriggerDecision decision;
   decision.trigger_number = m_last_trigger_number + 1;
   decision.run_number = m_run_number;
   decision.trigger_timestamp = timestamp;
-  decision.trigger_type = m_trigger_type;
+  decision.trigger_type = stream.conf.trigger_type;
 
-  int n_links = n_links_dist(random_engine);
+  int n_links = stream.link_count_histogram
+                  ? static_cast<int>(std::min<int64_t>((*stream.link_count_histogram)(m_random_engine),
+                                                       static_cast<int64_t>(stream.conf.links.size())))
+                  : stream.n_links_dist(m_random_engine);
 
   std::vector<dfmessages::GeoID> this_links;
-  std::sample(m_links.begin(), m_links.end(), std::back_inserter(this_links), n_links, random_engine);
+  std::sample(
+    stream.conf.links.begin(), stream.conf.links.end(), std::back_inserter(this_links), n_links, m_random_engine);
 
   for (auto link : this_links) {
     dfmessages::ComponentRequest request;
     request.component = link;
-    request.window_begin = timestamp - m_trigger_window_offset;
-    request.window_end = request.window_begin + window_ticks_dist(random_engine);
+    request.window_begin = timestamp - stream.conf.trigger_window_offset;
+    request.window_end = request.window_begin + (stream.window_ticks_histogram
+                                                   ? (*stream.window_ticks_histogram)(m_random_engine)
+                                                   : stream.window_ticks_dist(m_random_engine));
 
     decision.components.push_back(request);
   }
@@ -216,21 +843,38 @@ TriggerDecisionEmulator::create_decision(dfmessages::timestamp_t timestamp)
   return decision;
 }
 
+dfmessages::TriggerDecision
+TriggerDecisionEmulator::create_replayed_decision(const dfmessages::TriggerDecision& replayed)
+{
+  dfmessages::TriggerDecision decision(replayed);
+  decision.trigger_number = m_last_trigger_number + 1;
+  decision.run_number = m_run_number;
+  return decision;
+}
+
+dfmessages::timestamp_t
+TriggerDecisionEmulator::scaled_interval(dfmessages::timestamp_t stream_interval_ticks) const
+{
+  double scale = static_cast<double>(m_trigger_interval_ticks.load()) / m_configured_interval_ticks;
+  return std::max<dfmessages::timestamp_t>(1, std::llround(stream_interval_ticks * scale));
+}
+
+template<typename Admission, typename InhibitSource, typename Triggers, typename Dispatch>
 void
-TriggerDecisionEmulator::send_trigger_decisions()
+TriggerDecisionEmulator::send_trigger_decisions(Admission admission, InhibitSource inhibits, Dispatch dispatch)
 {
+  constexpr bool use_tokens = Admission::s_takes_tokens;
+  constexpr bool replay_trace = Triggers::s_replays;
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/trig-dec");
 
   // We get here at start of run, so reset the trigger number
   m_last_trigger_number = 0;
-  m_trigger_count.store(0);
-  m_trigger_count_tot.store(0);
-  m_inhibited_trigger_count.store(0);
-  m_inhibited_trigger_count_tot.store(0);
+  m_random_engine.seed(m_run_number);
 
   // Wait for there to be a valid timestamp estimate before we start
   while (m_running_flag.load() &&
          m_timestamp_estimator->get_timestamp_estimate() == dfmessages::TypeDefaults::s_invalid_timestamp) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    m_sleeper.sleep_for(std::chrono::milliseconds(10));
   }
 
   if (!m_running_flag.load()) {
@@ -240,117 +884,458 @@ TriggerDecisionEmulator::send_trigger_decisions()
 
   dfmessages::timestamp_t ts = m_timestamp_estimator->get_timestamp_estimate();
 
+  // A rate schedule starts with the rate of its first step
+  RateSchedule* rate_schedule = replay_trace ? nullptr : m_rate_schedule.get();
+  if (rate_schedule != nullptr) {
+    m_trigger_interval_ticks.store(rate_schedule->get_interval_ticks(0));
+  }
+
   // This case should have been caught in do_resume()
   assert(m_trigger_interval_ticks.load() != 0);
 
+  // When the timeline is sharded between several instances, they all
+  // have to generate the same timeline, whatever their own estimate of
+  // the current time. So it's started from the beginning of the current
+  // shard epoch rather than from the current time, and the slots that
+  // had already passed are skipped
+  ShardedTimeline timeline(m_shard_count, m_shard_index, m_shard_epoch_ticks, m_repeat_trigger_count);
+  const bool sharded = timeline.is_sharded();
+  dfmessages::timestamp_t origin = timeline.origin(ts);
+
   TLOG_DEBUG(1) << "Delaying trigger decision sending by " << trigger_delay_ticks_ << " ticks";
   // Round up to the next multiple of trigger_interval_ticks_
   dfmessages::timestamp_t next_trigger_timestamp =
-    (ts / m_trigger_interval_ticks.load() + 1) * m_trigger_interval_ticks.load() + m_trigger_offset;
+    (origin / m_trigger_interval_ticks.load() + 1) * m_trigger_interval_ticks.load() + m_trigger_offset;
   TLOG_DEBUG(1) << "Initial timestamp estimate is " << ts << ", next_trigger_timestamp is " << next_trigger_timestamp;
 
-  assert(next_trigger_timestamp > ts);
+  assert(sharded || next_trigger_timestamp > ts);
+
+  // Unless a trace is being replayed, the trigger times come from the
+  // streams' arrival models. Each stream starts at the next multiple
+  // of its own interval
+  dfmessages::timestamp_t schedule_interval = m_trigger_interval_ticks.load();
+  for (size_t i = 0; i < m_streams.size(); ++i) {
+    ArrivalModelParams arrival_params(m_streams[i]->conf.arrival);
+    arrival_params.interval_ticks = scaled_interval(arrival_params.interval_ticks);
+    // Different seeds for each stream, so their triggers aren't correlated
+    arrival_params.seed = (arrival_params.seed == 0 ? m_run_number : arrival_params.seed) + i;
+    timeline.add_stream(make_arrival_model(arrival_params),
+                      (origin / arrival_params.interval_ticks + 1) * arrival_params.interval_ticks + m_trigger_offset);
+  }
+  if constexpr (!replay_trace) {
+    next_trigger_timestamp = timeline.front_timestamp();
+  }
+
+  // When replaying a trace, the next trigger is the next one in the trace
+  dfmessages::TriggerDecision replayed;
+  bool trace_finished = false;
+  if constexpr (replay_trace) {
+    m_trace_replay->set_start_timestamp(next_trigger_timestamp);
+    trace_finished = !m_trace_replay->next(replayed);
+    if (!trace_finished) {
+      next_trigger_timestamp = replayed.trigger_timestamp;
+    }
+  }
 
-  while (true) {
-    while (m_running_flag.load() &&
-           (m_timestamp_estimator->get_timestamp_estimate() < (next_trigger_timestamp + trigger_delay_ticks_) ||
-            m_timestamp_estimator->get_timestamp_estimate() == dfmessages::TypeDefaults::s_invalid_timestamp)) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // With sharding, this instance takes the slots of the timeline with
+  // slot % m_shard_count == m_shard_index, and the trigger numbers are
+  // made from the slot, so that the instances' numbers interleave.
+  // A rate step begins at the same slot on every instance, so its
+  // interval is taken at once. One from resume waits for the next
+  // shard epoch
+  bool rate_step_changed = false;
+  auto advance_timeline = [&]() {
+    if constexpr (replay_trace) {
+      trace_finished = !m_trace_replay->next(replayed);
+      if (!trace_finished) {
+        next_trigger_timestamp = replayed.trigger_timestamp;
+      }
+      timeline.advance_slot();
+    } else {
+      // Pick up a new interval from resume or the rate schedule
+      if (m_trigger_interval_ticks.load() != schedule_interval) {
+        schedule_interval = m_trigger_interval_ticks.load();
+        std::vector<dfmessages::timestamp_t> intervals;
+        for (auto const& stream : m_streams) {
+          intervals.push_back(scaled_interval(stream->conf.arrival.interval_ticks));
+        }
+        timeline.set_intervals(intervals, rate_step_changed);
+      }
+      rate_step_changed = false;
+      timeline.advance();
+      next_trigger_timestamp = timeline.front_timestamp();
+    }
+  };
+
+  // The rate schedule is laid out from the first trigger while not
+  // paused, so that the steps aren't used up by a pause at start.
+  // Sharded instances may be resumed at different slots, so they all
+  // start it at the next epoch. Until it starts, rate_step is past the
+  // end of the schedule
+  constexpr size_t rate_schedule_not_started = std::numeric_limits<size_t>::max();
+  size_t rate_step = rate_schedule_not_started;
+  dfmessages::timestamp_t rate_schedule_start = dfmessages::TypeDefaults::s_invalid_timestamp;
+
+  // When decisions are sent once their windows are complete, each
+  // trigger's decision is made when its timestamp comes up on the
+  // schedule, and waits in the emission queue until then. Otherwise
+  // each one is made and sent trigger_delay_ticks_ after its timestamp,
+  // and the queue stays empty
+  const bool emit_when_window_complete = m_emit_when_window_complete;
+  EmissionQueue emission_queue;
+
+  uint64_t iterations = 0; // NOLINT(build/unsigned)
+  while (!trace_finished || !emission_queue.empty()) {
+    // Pick up an update. It costs a load when there isn't one
+    take_decision_confs();
+    if (!trace_finished) {
+      if (rate_schedule != nullptr && rate_schedule_start == dfmessages::TypeDefaults::s_invalid_timestamp &&
+          !m_paused.load()) {
+        rate_schedule_start = timeline.next_epoch(next_trigger_timestamp);
+        rate_schedule->start(rate_schedule_start);
+      }
+      // Every instance of a sharded timeline changes step at the same trigger
+      if (rate_schedule != nullptr && next_trigger_timestamp >= rate_schedule_start &&
+          (rate_step < rate_schedule->get_step_count() || rate_step == rate_schedule_not_started) &&
+          rate_schedule->step_at(next_trigger_timestamp) != rate_step) {
+        rate_step = rate_schedule->step_at(next_trigger_timestamp);
+        begin_rate_step(rate_step, next_trigger_timestamp);
+        rate_step_changed = true;
+      }
+      // The slots that had passed before we started
+      if (sharded && next_trigger_timestamp <= ts) {
+        advance_timeline();
+        continue;
+      }
+    }
+
+    // The next thing to do is to deal with the next trigger on the
+    // schedule, or to send the first decision in the queue, whichever
+    // is due first. The next trigger is queued if decisions wait for
+    // their windows, and passed over if it's another instance's.
+    // Other instances' triggers are passed when our own would be due,
+    // so that every instance is at the same slot at the same time
+    const bool next_first =
+      !trace_finished && (emission_queue.empty() || next_trigger_timestamp <= emission_queue.front().emit_at);
+    const bool pass_next = next_first && !timeline.owns_slot();
+    const bool queue_next = emit_when_window_complete && next_first;
+    dfmessages::timestamp_t due = next_trigger_timestamp + trigger_delay_ticks_;
+    if (emit_when_window_complete) {
+      due = next_first ? next_trigger_timestamp : emission_queue.front().emit_at;
+    }
+
+    while (m_running_flag.load() && (m_timestamp_estimator->get_timestamp_estimate() < due ||
+                                     m_timestamp_estimator->get_timestamp_estimate() ==
+                                       dfmessages::TypeDefaults::s_invalid_timestamp)) {
+      m_sender_counters.sample_cpu_time();
+      publish_status(m_paused.load() ? statuspage::State::kPaused : statuspage::State::kRunning);
+      m_sleeper.sleep_for(std::chrono::milliseconds(10));
     }
     if (!m_running_flag.load())
       break;
 
-    auto tokens_available = m_token_source != nullptr ? m_tokens.load() : 1;
-    if (!triggers_are_inhibited() && !m_paused.load() && tokens_available > 0) {
+    if (pass_next) {
+      advance_timeline();
+      continue;
+    }
 
-      dfmessages::TriggerDecision decision = create_decision(next_trigger_timestamp);
+    if (queue_next) {
+      record_timeline_event(m_sender_timeline, TimelineEvent::kScheduled, 0, next_trigger_timestamp);
+      PendingDecision pending;
+      pending.trigger_timestamp = next_trigger_timestamp;
+      pending.slot = timeline.slot();
+      if constexpr (!replay_trace) {
+        pending.stream = timeline.front_stream();
+      }
+      // Numbered when it's sent, so that the numbers follow the order decisions are sent in (or the slots, if sharded)
+      pending.decision = replay_trace ? create_replayed_decision(replayed)
+                                      : create_decision(pending.stream, next_trigger_timestamp);
+      pending.emit_at = window_complete_timestamp(pending.decision);
+      emission_queue.push(std::move(pending));
+      advance_timeline();
+      continue;
+    }
+
+    // The trigger to deal with now: the first queued one, or else the next on the schedule
+    PendingDecision pending;
+    if (emit_when_window_complete) {
+      pending = emission_queue.pop();
+    } else {
+      record_timeline_event(m_sender_timeline, TimelineEvent::kScheduled, 0, next_trigger_timestamp);
+      pending.emit_at = due;
+      pending.trigger_timestamp = next_trigger_timestamp;
+      pending.slot = timeline.slot();
+      if constexpr (!replay_trace) {
+        pending.stream = timeline.front_stream();
+      }
+    }
+
+    // Each decision sent, including repeats, takes one token
+    const bool estimate_stale = timestamp_estimate_is_stale();
+    const bool inhibited = inhibits.inhibited() || m_paused.load() || estimate_stale;
+    int granted = 0;
+    if (!inhibited) {
+      granted = admission.admit(m_repeat_trigger_count);
+      if (granted > 0 && granted < m_repeat_trigger_count) {
+        m_sender_counters.add(SenderCounter::kPartialTokenGrants);
+      }
+    }
+    const bool in_rate_step = rate_schedule != nullptr && rate_step < rate_schedule->get_step_count();
+    if (granted > 0) {
+      if (!emit_when_window_complete) {
+        pending.decision = replay_trace ? create_replayed_decision(replayed)
+                                        : create_decision(pending.stream, next_trigger_timestamp);
+      }
+      dfmessages::TriggerDecision& decision = pending.decision;
+      decision.trigger_number = timeline.trigger_number(pending.slot, m_last_trigger_number);
+
+      // A busy region only holds up the triggers that read it out
+      const uint64_t busy_regions = inhibits.busy_regions(); // NOLINT(build/unsigned)
+      if (busy_regions != 0 && !apply_region_inhibits(decision, pending.stream, replay_trace, busy_regions)) {
+        TLOG_DEBUG(1) << "Regions that the trigger at timestamp " << pending.trigger_timestamp
+                      << " reads out are busy. Not sending a TriggerDecision for it";
+        record_timeline_event(m_sender_timeline, TimelineEvent::kSkipped, 0, 3);
+        admission.give_back(granted);
+        m_sender_counters.add(SenderCounter::kRegionInhibited);
+        if (in_rate_step) {
+          rate_schedule->count_skipped();
+        }
+        if constexpr (!replay_trace) {
+          m_streams[pending.stream]->inhibited_trigger_count++;
+        }
+        granted = 0;
+      } else if (m_readout_buffer_depth_ticks > 0 && readout_has_dropped_data_for(decision)) {
+        // Sending it would only keep dataflow busy with a request that comes back empty
+        TLOG_DEBUG(1) << "The readout no longer has the data for the trigger at timestamp "
+                      << pending.trigger_timestamp << ". Not sending a TriggerDecision for it";
+        record_timeline_event(m_sender_timeline, TimelineEvent::kSkipped, 0, 2);
+        admission.give_back(granted);
+        m_sender_counters.add(SenderCounter::kExpired);
+        if (in_rate_step) {
+          rate_schedule->count_skipped();
+        }
+        granted = 0;
+      } else {
+        // How long after it was due we're sending it
+        auto estimate = m_timestamp_estimator->get_timestamp_estimate();
+        uint64_t lateness_us = // NOLINT(build/unsigned)
+          estimate > pending.emit_at ? (estimate - pending.emit_at) * 1000000 / m_clock_frequency_hz : 0;
+        ++m_status.lateness_us_bins[statuspage::lateness_bin(lateness_us)];
+        ++m_status.lateness_count;
+        m_status.lateness_max_us = std::max(m_status.lateness_max_us, lateness_us);
+        m_status.last_trigger_timestamp = pending.trigger_timestamp;
+        if (in_rate_step) {
+          rate_schedule->count_sent(lateness_us);
+        }
+      }
 
-      for (int i = 0; i < m_repeat_trigger_count; ++i) {
-        TLOG_DEBUG(1) << "At timestamp " << m_timestamp_estimator->get_timestamp_estimate()
-                      << ", pushing a decision with triggernumber " << decision.trigger_number << " timestamp "
-                      << decision.trigger_timestamp << " number of links " << decision.components.size();
-        dfmessages::TriggerDecision decision_copy(decision);
-        m_trigger_decision_sink->send(std::move(decision_copy), std::chrono::milliseconds(10));
-        std::lock_guard<std::mutex> lk(m_open_trigger_decisions_mutex);
-        m_open_trigger_decisions.insert(decision.trigger_number);
+      // Nothing is logged for each decision: the timeline and the recording have them
+      for (int i = 0; i < granted; ++i) {
+        record_timeline_event(
+          m_sender_timeline, TimelineEvent::kCreated, decision.trigger_number, decision.trigger_timestamp);
+        // Open it before sending, in case its token comes straight back
+        if constexpr (use_tokens) {
+          m_open_trigger_decisions.open(decision, m_clock->now());
+        }
+        if (!dispatch.dispatch(decision)) {
+          record_timeline_event(m_sender_timeline, TimelineEvent::kNotSent, decision.trigger_number);
+          // The trigger is lost, and its number is used for the next one
+          m_open_trigger_decisions.close(decision.trigger_number);
+          admission.give_back(granted - i);
+          m_sender_counters.add(SenderCounter::kDecisionsNotSent);
+          ers::warning(TriggerDecisionNotSent(ERS_HERE, decision.trigger_number));
+          break;
+        }
+        record_timeline_event(m_sender_timeline, TimelineEvent::kSent, decision.trigger_number);
+        if (m_recorder) {
+          m_recorder->record(decision, i > 0);
+        }
+        m_last_trigger_number = decision.trigger_number;
         decision.trigger_number++;
-        m_last_trigger_number++;
-        m_tokens--;
-        m_trigger_count++;
-        m_trigger_count_tot++;
+        m_sender_counters.add(SenderCounter::kTriggers);
+        if constexpr (!replay_trace) {
+          m_streams[pending.stream]->trigger_count++;
+        }
       }
-    } else if (tokens_available == 0) {
+      if (granted > 0 && !m_first_decision_sent.exchange(true)) {
+        m_start_to_first_decision_us.store(
+          std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start_time)
+            .count());
+        TLOG_DEBUG(0) << "First trigger decision sent " << m_start_to_first_decision_us.load()
+                      << " us after start";
+      }
+    } else if (!inhibited) {
       TLOG_DEBUG(1) << "There are no Tokens available. Not sending a TriggerDecision for timestamp "
-                    << next_trigger_timestamp;
-      m_inhibited_trigger_count++;
-      m_inhibited_trigger_count_tot++;
+                    << pending.trigger_timestamp;
+      record_timeline_event(m_sender_timeline, TimelineEvent::kSkipped, 0, 1);
+      m_sender_counters.add(SenderCounter::kInhibited);
+      if (in_rate_step) {
+        rate_schedule->count_skipped();
+      }
+      if constexpr (!replay_trace) {
+        m_streams[pending.stream]->inhibited_trigger_count++;
+      }
     } else {
-      TLOG_DEBUG(1) << "Triggers are inhibited/paused. Not sending a TriggerDecision for timestamp "
-                    << next_trigger_timestamp;
+      record_timeline_event(m_sender_timeline, TimelineEvent::kSkipped, 0, 0);
+      if (estimate_stale) {
+        m_sender_counters.add(SenderCounter::kStaleEstimate);
+      } else if (!m_paused.load()) {
+        m_sender_counters.add(SenderCounter::kDataflowInhibited);
+      }
+      // Pausing isn't the dataflow's doing
+      if (in_rate_step && !m_paused.load()) {
+        rate_schedule->count_skipped();
+      }
+      TLOG_DEBUG(1) << "Triggers are inhibited/paused or the timestamp estimate is stale. "
+                    << "Not sending a TriggerDecision for timestamp " << pending.trigger_timestamp;
     }
 
-    next_trigger_timestamp += m_trigger_interval_ticks.load();
+    publish_status(m_paused.load() ? statuspage::State::kPaused : statuspage::State::kRunning);
+    if (!emit_when_window_complete) {
+      advance_timeline();
+    }
+    // Often enough to follow, without a system call for every trigger at high rates
+    if (++iterations % 256 == 0) {
+      m_sender_counters.sample_cpu_time();
+    }
+  }
+
+  if (!emission_queue.empty()) {
+    TLOG_DEBUG(0) << emission_queue.size() << " queued trigger decisions weren't sent before the stop";
+  }
+
+  // Report on the step that the stop cut short
+  if (rate_schedule != nullptr && rate_step < rate_schedule->get_step_count()) {
+    begin_rate_step(rate_schedule->get_step_count(), m_timestamp_estimator->get_timestamp_estimate());
+  }
+
+  if (trace_finished) {
+    TLOG() << "Reached the end of trigger trace " << m_trace_file << ". No more triggers will be sent in this run";
+    while (m_running_flag.load()) {
+      m_sleeper.sleep_for(std::chrono::milliseconds(10));
+    }
   }
 
   // We get here after the stop command is received. We send out
-  // m_stop_burst_count triggers in one go, so that there are triggers
-  // in-flight in the system during the stopping transition. This is
-  // intended to allow tests that all of the queues are correctly
-  // drained elsewhere in the system during the stop transition
+  // m_stop_burst_count triggers, m_stop_burst_interval apart, so that
+  // there are triggers in-flight in the system during the stopping
+  // transition. This is intended to allow tests that all of the queues
+  // are correctly drained elsewhere in the system during the stop
+  // transition. With tokens, each trigger takes one, waiting for it
+  // until do_stop()'s drain deadline, and is opened like any other, so
+  // that do_stop() can tell when the burst has drained
   if (m_stop_burst_count) {
     TLOG_DEBUG(0) << "Sending " << m_stop_burst_count << " triggers at stop";
-    dfmessages::TriggerDecision decision = create_decision(next_trigger_timestamp);
+    TriggerStream& stream = *m_streams[timeline.front_stream()];
+    take_decision_confs();
+    dfmessages::TriggerDecision decision = create_decision(timeline.front_stream(), next_trigger_timestamp);
 
     for (int i = 0; i < m_stop_burst_count; ++i) {
-        dfmessages::TriggerDecision decision_copy(decision);
-      m_trigger_decision_sink->send(std::move(decision_copy), std::chrono::milliseconds(10));
-      decision.trigger_number++;
-      m_last_trigger_number++;
-      m_trigger_count++;
-      m_trigger_count_tot++;
+      decision.trigger_number = timeline.trigger_number(timeline.stop_burst_slot(i), m_last_trigger_number);
+      if constexpr (use_tokens) {
+        if (!m_tokens.try_acquire(1) && !m_tokens.acquire_until(1, m_drain_deadline, []() { return false; })) {
+          TLOG_DEBUG(0) << "No tokens for the last " << m_stop_burst_count - i << " triggers of the stop burst";
+          m_sender_counters.add(SenderCounter::kInhibited, m_stop_burst_count - i);
+          break;
+        }
+        m_open_trigger_decisions.open(decision, m_clock->now());
+      }
+      record_timeline_event(
+        m_sender_timeline, TimelineEvent::kCreated, decision.trigger_number, decision.trigger_timestamp);
+      if (!dispatch.dispatch(decision)) {
+        record_timeline_event(m_sender_timeline, TimelineEvent::kNotSent, decision.trigger_number);
+        if constexpr (use_tokens) {
+          m_open_trigger_decisions.close(decision.trigger_number);
+        }
+        admission.give_back(1);
+        m_sender_counters.add(SenderCounter::kDecisionsNotSent);
+        ers::warning(TriggerDecisionNotSent(ERS_HERE, decision.trigger_number));
+        break;
+      }
+      record_timeline_event(m_sender_timeline, TimelineEvent::kSent, decision.trigger_number);
+      if (m_recorder) {
+        m_recorder->record(decision);
+      }
+      m_last_trigger_number = decision.trigger_number;
+      m_sender_counters.add(SenderCounter::kTriggers);
+      stream.trigger_count++;
+      if (m_stop_burst_interval.count() > 0 && i + 1 < m_stop_burst_count) {
+        m_clock->sleep_for(m_stop_burst_interval, []() { return false; });
+      }
     }
   }
+  m_sender_counters.sample_cpu_time();
 }
 
 void
 TriggerDecisionEmulator::read_inhibit_queue()
 {
-  if (m_trigger_inhibit_source == nullptr)
+  if (m_trigger_inhibit_source == nullptr && m_region_inhibit_receivers.empty())
     return;
-
-  // This loop is a hack to deal with the fact that there might be
-  // leftover TriggerInhibit messages from the previous run, because
-  // TriggerDecisionEmulator is stopped before the DF modules that
-  // send the TriggerInhibits. So we pop everything we can at
-  // startup. This will definitely get all of the TriggerInhibits from
-  // the previous run. It *may* also get TriggerInhibits from the
-  // current run, which we drop on the floor. This is not really
-  // ideal, since we don't know whether a given message on the queue
-  // came from the previous (and should be ignored) or from this run
-  // (and should be handled). The problem would be when an inhibit is
-  // sent in this run before this loop gets started. That seems
-  // unlikely, and the whole way we do inhibits is changing for
-  // MiniDAQApp v2 anyway, so I'm leaving it like this
-  try {
-    while (true) {
-      dfmessages::TriggerInhibit ti;
-      ti = m_trigger_inhibit_source->receive(std::chrono::milliseconds(1));
-    }
-  } catch (iomanager::TimeoutExpired&) {
-  }
-  while (m_running_flag.load()) {
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/inhibit-q");
+
+  // There might be leftover TriggerInhibit messages from the previous
+  // run, because TriggerDecisionEmulator is stopped before the DF
+  // modules that send the TriggerInhibits. Rather than throwing away
+  // everything on the queue at start (which could also drop inhibits
+  // from the current run), we drop inhibits stamped with another run
+  // number as they arrive. Inhibits that aren't stamped with a run
+  // number can't be told apart that way, so we drain the queues at
+  // stop
+
+  // Read what's waiting on one source: trigger_inhibit_source, which
+  // inhibits everything, if `region` is -1, or else that region's
+  const auto read_source = [&](inhibit_source_t& source, int region) {
     try {
       while (true) {
         dfmessages::TriggerInhibit ti;
-        ti = m_trigger_inhibit_source->receive(std::chrono::milliseconds(1));
-        m_inhibited.store(ti.busy);
+        ti = source->receive(iomanager::Receiver::s_no_block);
+        if (ti.run_number != 0 && ti.run_number != m_run_number) {
+          TLOG_DEBUG(1) << "Dropping TriggerInhibit with run number " << ti.run_number << ", current run number "
+                        << m_run_number;
+          m_inhibit_counters.add(InhibitCounter::kOtherRunInhibits);
+          continue;
+        }
+        if (region < 0) {
+          m_inhibited.store(ti.busy);
+          m_inhibited_time.set(ti.busy, m_clock->now_us());
+        } else {
+          m_region_inhibits.set_busy(region, ti.busy, m_clock->now_us());
+        }
+        record_timeline_event(m_inhibit_timeline, TimelineEvent::kInhibit, region + 1, ti.busy ? 1 : 0);
         if (ti.busy) {
-          TLOG() << "Dataflow is BUSY.";
+          TLOG() << (region < 0 ? "Dataflow" : "Region " + m_region_inhibits.get_name(region)) << " is BUSY.";
         }
       }
     } catch (iomanager::TimeoutExpired&) {
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  };
+
+  while (m_running_flag.load()) {
+    if (m_trigger_inhibit_source != nullptr) {
+      read_source(m_trigger_inhibit_source, -1);
+    }
+    for (size_t i = 0; i < m_region_inhibit_receivers.size(); ++i) {
+      read_source(m_region_inhibit_receivers[i], static_cast<int>(i));
+    }
+    m_inhibit_counters.sample_cpu_time();
+    m_sleeper.sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Drain the input queues as best we can, so unstamped inhibits from
+  // this run aren't seen by the next one
+  auto drain = [](inhibit_source_t& source) {
+    try {
+      while (true)
+        source->receive(iomanager::Receiver::s_no_block);
+    } catch (iomanager::TimeoutExpired&) {
+    }
+  };
+  if (m_trigger_inhibit_source != nullptr) {
+    drain(m_trigger_inhibit_source);
+  }
+  for (auto& source : m_region_inhibit_receivers) {
+    drain(source);
   }
 }
 
@@ -359,56 +1344,377 @@ TriggerDecisionEmulator::read_token_queue()
 {
   if (m_token_source == nullptr)
     return;
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/token-q");
 
   auto open_trigger_report_time = std::chrono::steady_clock::now();
-  while (m_running_flag.load()) {
+  while (m_running_flag.load() || m_draining.load()) {
     try {
 
       while (true) {
-        dfmessages::TriggerDecisionToken tdt = m_token_source->receive(std::chrono::milliseconds(1));
+        dfmessages::TriggerDecisionToken tdt = m_token_source->receive(iomanager::Receiver::s_no_block);
         TLOG_DEBUG(1) << "Received token with run number " << tdt.run_number << ", current run number " << m_run_number;
-        if (tdt.run_number == m_run_number) {
-          m_tokens++;
-          TLOG_DEBUG(1) << "There are now " << m_tokens.load() << " tokens available";
-
-          if (tdt.trigger_number != dfmessages::TypeDefaults::s_invalid_trigger_number) {
-            if (m_open_trigger_decisions.count(tdt.trigger_number)) {
-              std::lock_guard<std::mutex> lk(m_open_trigger_decisions_mutex);
-              m_open_trigger_decisions.erase(tdt.trigger_number);
-              TLOG_DEBUG(1) << "Token indicates that trigger decision " << tdt.trigger_number
-                            << " has been completed. There are now " << m_open_trigger_decisions.size()
-                            << " triggers in flight";
-            } else {
-              // ERS warning: received token for trigger number I don't recognize
-            }
+        Clock::duration open_for;
+        if (tdt.run_number != m_run_number) {
+          m_token_counters.add(TokenCounter::kOtherRunTokens);
+        } else if (tdt.trigger_number == dfmessages::TypeDefaults::s_invalid_trigger_number) {
+          // Not for any decision in particular, such as the initial tokens
+          m_tokens.release();
+          m_token_counters.add(TokenCounter::kTokens);
+          TLOG_DEBUG(1) << "There are now " << m_tokens.available() << " tokens available";
+        } else if (m_open_trigger_decisions.close(tdt.trigger_number, m_clock->now(), open_for)) {
+          m_tokens.release();
+          m_token_counters.add(TokenCounter::kTokens);
+          record_timeline_event(m_token_timeline, TimelineEvent::kRetired, tdt.trigger_number);
+          m_dispatcher.complete(tdt.trigger_number);
+          uint64_t round_trip_us = // NOLINT(build/unsigned)
+            std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(open_for).count());
+          ++m_round_trip_us_bins[statuspage::lateness_bin(round_trip_us)];
+          ++m_round_trip_count;
+          m_round_trip_max_us = std::max(m_round_trip_max_us, round_trip_us);
+          if (m_draining.load()) {
+            m_last_drain_close_ns.store(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(m_clock->now().time_since_epoch()).count());
           }
+          TLOG_DEBUG(1) << "Token indicates that trigger decision " << tdt.trigger_number
+                        << " has been completed. There are now " << m_open_trigger_decisions.size()
+                        << " triggers in flight and " << m_tokens.available() << " tokens available";
+        } else if (m_open_trigger_decisions.take_late_token(tdt.trigger_number)) {
+          // The decision was reclaimed, or this is the token of a copy sent again after the first came back
+          TLOG_DEBUG(1) << "Late token for trigger decision " << tdt.trigger_number;
+          m_token_counters.add(TokenCounter::kLateTokens);
+        } else {
+          // Only the tokens of open decisions add to the budget
+          TLOG_DEBUG(1) << "Token for trigger decision " << tdt.trigger_number << ", which isn't open";
+          m_token_counters.add(TokenCounter::kUnknownTokens);
         }
       }
     } catch (iomanager::TimeoutExpired&) {
     }
-    if (!m_paused && !m_open_trigger_decisions.empty()) {
+    handle_stale_decisions();
+    if (m_draining.load() && m_open_trigger_decisions.size() == 0) {
+      m_clock->notify(); // do_stop() is waiting for the last open decision to close
+    }
+    if (!m_paused && m_open_trigger_decisions.size() > 0) {
 
       auto now = std::chrono::steady_clock::now();
       if (std::chrono::duration_cast<std::chrono::milliseconds>(now - open_trigger_report_time) >
           std::chrono::milliseconds(3000)) {
         std::ostringstream o;
         o << "Open Trigger Decisions: [";
-        { // Scope for lock_guard
-          bool first = true;
-          std::lock_guard<std::mutex> lk(m_open_trigger_decisions_mutex);
-          for (auto& td : m_open_trigger_decisions) {
-            if (!first)
-              o << ", ";
-            o << td;
-            first = false;
-          }
-          o << "]";
+        bool first = true;
+        for (auto td : m_open_trigger_decisions.open_trigger_numbers()) {
+          if (!first)
+            o << ", ";
+          o << td;
+          first = false;
         }
+        o << "]";
         TLOG_DEBUG(0) << o.str();
         open_trigger_report_time = now;
       }
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    m_token_counters.sample_cpu_time();
+    if (m_running_flag.load()) {
+      m_sleeper.sleep_for(std::chrono::milliseconds(10));
+    } else {
+      // The stop interrupted the sleeper, so it would no longer wait. do_stop() wakes us when the drain ends
+      m_clock->sleep_for(std::chrono::milliseconds(10), [this]() { return !m_draining.load(); });
+    }
+  }
+}
+
+void
+TriggerDecisionEmulator::publish_status(statuspage::State state)
+{
+  if (!m_status_page) {
+    return;
+  }
+  m_status.update_time_us =
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  m_status.run_number = m_run_number;
+  m_status.state = state;
+  m_status.triggers = m_sender_counters.get(SenderCounter::kTriggers);
+  m_status.inhibited = m_sender_counters.get(SenderCounter::kInhibited);
+  m_status.decisions_not_sent = m_sender_counters.get(SenderCounter::kDecisionsNotSent);
+  m_status.tokens_received = m_token_counters.get(TokenCounter::kTokens);
+  m_status.tokens_available = m_tokens.available();
+  m_status.open_decisions = m_open_trigger_decisions.size();
+  m_status.last_trigger_number = m_last_trigger_number;
+  m_status.time_sync_age_us = -1;
+  // The estimator only exists while running, when this is called from the sending thread
+  if (state != statuspage::State::kStopped && m_timestamp_estimator) {
+    m_status.timestamp_estimate = m_timestamp_estimator->get_timestamp_estimate();
+    auto last_time_sync_us = m_timestamp_estimator->get_last_time_sync_us();
+    auto now_us = m_clock->now_us();
+    if (last_time_sync_us != 0) {
+      m_status.time_sync_age_us = now_us > last_time_sync_us ? now_us - last_time_sync_us : 0;
+    }
+  }
+  m_status_page->publish(m_status);
+}
+
+void
+TriggerDecisionEmulator::begin_rate_step(size_t step, dfmessages::timestamp_t timestamp)
+{
+  const uint64_t now_us = m_clock->now_us();                         // NOLINT(build/unsigned)
+  const uint64_t inhibited_us = m_inhibited_time.total_us(now_us);   // NOLINT(build/unsigned)
+  const uint64_t starved_us = m_tokens.get_starved_us();             // NOLINT(build/unsigned)
+
+  if (m_rate_step.load() >= 0) {
+    double inhibited_fraction = 0;
+    if (now_us > m_rate_step_start_us) {
+      inhibited_fraction =
+        std::min(1., static_cast<double>(inhibited_us - m_rate_step_inhibited_us) / (now_us - m_rate_step_start_us));
+    }
+    auto report = m_rate_schedule->end_step(timestamp, inhibited_fraction, starved_us - m_rate_step_starved_us);
+    TLOG() << "Rate step " << report.step + 1 << "/" << m_rate_schedule->get_step_count() << ": requested "
+           << report.requested_rate_hz << " Hz, achieved " << report.achieved_rate_hz << " Hz, " << report.skipped
+           << " triggers skipped, inhibited " << report.inhibited_fraction * 100 << "% of the time, token-starved "
+           << report.token_starved_us / 1000 << " ms, lateness p50/p90/p99/max " << report.lateness_p50_us << "/"
+           << report.lateness_p90_us << "/" << report.lateness_p99_us << "/" << report.lateness_max_us << " us"
+           << (report.saturated ? ", SATURATED" : "");
+    if (report.saturated && m_saturated_step.load() < 0) {
+      m_saturated_step.store(report.step);
+      TLOG() << "Dataflow first saturated at rate step " << report.step + 1 << ", " << report.requested_rate_hz
+             << " Hz";
+    }
+    std::lock_guard<std::mutex> lk(m_rate_step_reports_mutex);
+    m_rate_step_reports.push_back(report);
+  }
+
+  m_rate_step_start_us = now_us;
+  m_rate_step_inhibited_us = inhibited_us;
+  m_rate_step_starved_us = starved_us;
+  if (step < m_rate_schedule->get_step_count()) {
+    m_rate_schedule->begin_step(step);
+    // Picked up by the arrival models at the next trigger
+    m_trigger_interval_ticks.store(m_rate_schedule->get_interval_ticks(step));
+    m_rate_step.store(step);
+  } else {
+    // The last rate carries on to the end of the run
+    m_rate_step.store(-1);
+    if (m_saturated_step.load() < 0) {
+      TLOG() << "Rate schedule finished without saturating dataflow";
+    }
+  }
+}
+
+triggerdecisionemulatorinfo::RunReport
+TriggerDecisionEmulator::make_run_report(uint64_t stop_us) const // NOLINT(build/unsigned)
+{
+  triggerdecisionemulatorinfo::RunReport report;
+  report.run_number = m_run_number;
+  report.run_time_us = stop_us > m_run_start_us ? stop_us - m_run_start_us : 0;
+  report.paused_us = m_paused_time.total_us(stop_us);
+  report.inhibited_us = m_inhibited_time.total_us(stop_us);
+  report.token_starved_us = m_tokens.get_starved_us();
+
+  // Each trigger is sent m_repeat_trigger_count times, and this shard sends 1/m_shard_count of them
+  if (!m_trace_replay) {
+    double rate_hz = 0;
+    for (auto const& stream : m_streams) {
+      ArrivalModelParams arrival_params(stream->conf.arrival);
+      arrival_params.interval_ticks = scaled_interval(arrival_params.interval_ticks);
+      rate_hz += mean_rate_hz(arrival_params, m_clock_frequency_hz);
+    }
+    report.configured_rate_hz = rate_hz * m_repeat_trigger_count / m_shard_count;
+  }
+  report.triggers = m_sender_counters.get(SenderCounter::kTriggers);
+  if (report.run_time_us > report.paused_us) {
+    report.achieved_rate_hz = report.triggers * 1e6 / (report.run_time_us - report.paused_us);
+  }
+  report.token_starved_skipped = m_sender_counters.get(SenderCounter::kInhibited);
+  report.inhibited_skipped = m_sender_counters.get(SenderCounter::kDataflowInhibited);
+  report.stale_estimate_skipped = m_sender_counters.get(SenderCounter::kStaleEstimate);
+  report.expired = m_sender_counters.get(SenderCounter::kExpired) + m_token_counters.get(TokenCounter::kStaleExpired);
+  report.masked_components = m_sender_counters.get(SenderCounter::kMaskedComponents);
+  report.region_inhibited = m_sender_counters.get(SenderCounter::kRegionInhibited);
+  report.partial_token_grants = m_sender_counters.get(SenderCounter::kPartialTokenGrants);
+  report.decisions_not_sent = m_sender_counters.get(SenderCounter::kDecisionsNotSent);
+
+  if (m_timestamp_estimator) {
+    report.time_syncs = m_timestamp_estimator->get_time_sync_count();
+    report.max_time_sync_gap_us = m_timestamp_estimator->get_max_time_sync_gap_us();
+    auto snapshot = m_timestamp_estimator->get_snapshot();
+    if (snapshot.valid) {
+      report.time_sync_rate_hz = snapshot.rate_hz;
+      report.clock_drift_ppm = (snapshot.rate_hz - m_clock_frequency_hz) * 1e6 / m_clock_frequency_hz;
+      report.estimate_error_ticks = snapshot.error_ticks;
+    }
+  }
+
+  auto lateness = [&](double q) {
+    return statuspage::lateness_percentile_us(
+      m_status.lateness_us_bins, m_status.lateness_count, m_status.lateness_max_us, q);
+  };
+  report.lateness_p50_us = lateness(0.5);
+  report.lateness_p90_us = lateness(0.9);
+  report.lateness_p99_us = lateness(0.99);
+  report.lateness_max_us = m_status.lateness_max_us;
+
+  auto round_trip = [&](double q) {
+    return statuspage::lateness_percentile_us(
+      m_round_trip_us_bins.data(), m_round_trip_count, m_round_trip_max_us, q);
+  };
+  report.round_trips = m_round_trip_count;
+  report.round_trip_p50_us = round_trip(0.5);
+  report.round_trip_p90_us = round_trip(0.9);
+  report.round_trip_p99_us = round_trip(0.99);
+  report.round_trip_max_us = m_round_trip_max_us;
+
+  report.peak_open_decisions = m_open_trigger_decisions.peak_size();
+  report.stop_to_drained_us = m_stop_to_drained_us.load();
+  report.undrained_at_stop = m_undrained_at_stop.load();
+  report.saturated_step = m_saturated_step.load();
+  return report;
+}
+
+void
+TriggerDecisionEmulator::write_run_report(const triggerdecisionemulatorinfo::RunReport& report)
+{
+  nlohmann::json json = report;
+  json["rate_steps"] = nlohmann::json::array();
+  {
+    std::lock_guard<std::mutex> lk(m_rate_step_reports_mutex);
+    for (auto const& step : m_rate_step_reports) {
+      json["rate_steps"].push_back({ { "step", step.step },
+                                     { "requested_rate_hz", step.requested_rate_hz },
+                                     { "achieved_rate_hz", step.achieved_rate_hz },
+                                     { "triggers", step.triggers },
+                                     { "skipped", step.skipped },
+                                     { "inhibited_fraction", step.inhibited_fraction },
+                                     { "token_starved_us", step.token_starved_us },
+                                     { "lateness_p50_us", step.lateness_p50_us },
+                                     { "lateness_p90_us", step.lateness_p90_us },
+                                     { "lateness_p99_us", step.lateness_p99_us },
+                                     { "lateness_max_us", step.lateness_max_us },
+                                     { "saturated", step.saturated } });
+    }
+  }
+
+  std::ostringstream path;
+  path << m_run_report_file_prefix << "_run" << std::setw(6) << std::setfill('0') << m_run_number << "_report.json";
+  std::ofstream file(path.str());
+  file << json.dump(2) << std::endl;
+  if (!file) {
+    ers::warning(RecordingError(ERS_HERE, path.str(), "could not write the run report"));
+    return;
+  }
+  TLOG() << "Wrote the report on run " << m_run_number << " to " << path.str();
+}
+
+dfmessages::timestamp_t
+TriggerDecisionEmulator::window_complete_timestamp(const dfmessages::TriggerDecision& decision) const
+{
+  dfmessages::timestamp_t window_end = decision.trigger_timestamp;
+  for (auto const& component : decision.components) {
+    window_end = std::max(window_end, component.window_end);
+  }
+  return window_end + m_window_margin_ticks;
+}
+
+bool
+TriggerDecisionEmulator::readout_has_dropped_data_for(const dfmessages::TriggerDecision& decision) const
+{
+  const dfmessages::timestamp_t estimate = m_timestamp_estimator->get_timestamp_estimate();
+  if (estimate == dfmessages::TypeDefaults::s_invalid_timestamp || estimate < m_readout_buffer_depth_ticks) {
+    return false;
+  }
+  const dfmessages::timestamp_t oldest_kept = estimate - m_readout_buffer_depth_ticks;
+  for (auto const& component : decision.components) {
+    if (component.window_begin < oldest_kept) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+TriggerDecisionEmulator::apply_region_inhibits(dfmessages::TriggerDecision& decision,
+                                               size_t stream,
+                                               bool replayed,
+                                               uint64_t busy) // NOLINT(build/unsigned)
+{
+  // A replayed decision has no stream, so it goes by its own components
+  const bool whole_stream = m_region_inhibits.get_policy() == RegionInhibitPolicy::kStream && !replayed;
+  const uint64_t regions = // NOLINT(build/unsigned)
+    busy & (whole_stream ? m_region_inhibits.regions_of((*m_decision_confs)[stream].conf.links)
+                         : m_region_inhibits.regions_of(decision));
+  if (regions == 0) {
+    return true;
+  }
+  if (m_region_inhibits.get_policy() == RegionInhibitPolicy::kMask) {
+    m_sender_counters.add(SenderCounter::kMaskedComponents, m_region_inhibits.mask(decision, busy));
+    if (!decision.components.empty()) {
+      return true;
+    }
+  }
+  m_region_inhibits.count_suppressed(regions);
+  return false;
+}
+
+bool
+TriggerDecisionEmulator::timestamp_estimate_is_stale()
+{
+  if (m_max_time_sync_age.count() == 0) {
+    return false;
+  }
+  auto snapshot = m_timestamp_estimator->get_snapshot();
+  const int64_t max_age_us = std::chrono::duration_cast<std::chrono::microseconds>(m_max_time_sync_age).count();
+  const bool stale = snapshot.valid && static_cast<int64_t>(snapshot.age_us) > max_age_us;
+  // Say so once each time it goes stale, and when it recovers
+  if (stale && !m_estimate_stale) {
+    ers::warning(StaleTimestampEstimate(ERS_HERE, snapshot.age_us / 1000, m_max_time_sync_age.count()));
+  } else if (!stale && m_estimate_stale) {
+    TLOG() << "TimeSyncs have resumed. Sending triggers again, from timestamp estimate " << snapshot.estimate;
+  }
+  m_estimate_stale = stale;
+  return stale;
+}
+
+void
+TriggerDecisionEmulator::handle_stale_decisions()
+{
+  std::vector<OpenDecisionTracker::Expired> expired;
+  m_open_trigger_decisions.collect_expired(m_clock->now(), expired);
+
+  for (auto& stale : expired) {
+    record_timeline_event(m_token_timeline, TimelineEvent::kStale, stale.trigger_number);
+    if (m_stale_policy == StalePolicy::kWarn) {
+      ers::warning(StaleTriggerDecision(ERS_HERE, stale.trigger_number, stale.age.count(), "still waiting"));
+      m_token_counters.add(TokenCounter::kStaleWarned);
+      continue;
+    }
+
+    if (m_stale_policy == StalePolicy::kResend && stale.journaled && stale.resends < m_max_resends) {
+      if (m_readout_buffer_depth_ticks > 0 && readout_has_dropped_data_for(stale.decision)) {
+        // Sending it again would only get an empty fragment back
+        TLOG_DEBUG(0) << "No token for trigger decision " << stale.trigger_number
+                      << ", but the readout no longer has its data. Not sending it again";
+        m_token_counters.add(TokenCounter::kStaleExpired);
+      } else {
+        TLOG_DEBUG(0) << "No token for trigger decision " << stale.trigger_number << " after " << stale.age.count()
+                      << " ms, sending it again";
+        m_dispatcher.complete(stale.trigger_number);
+        if (m_dispatcher.dispatch(stale.decision)) {
+          record_timeline_event(m_token_timeline, TimelineEvent::kSent, stale.trigger_number);
+          if (m_recorder) {
+            m_recorder->record_resent(stale.decision);
+          }
+          m_open_trigger_decisions.rearm(stale.trigger_number, m_clock->now());
+          m_token_counters.add(TokenCounter::kStaleResent);
+          continue;
+        }
+      }
+    }
+
+    // Give up on it, and give its token back so the run doesn't throttle down
+    ers::warning(StaleTriggerDecision(ERS_HERE, stale.trigger_number, stale.age.count(), "reclaiming its token"));
+    m_dispatcher.complete(stale.trigger_number);
+    m_open_trigger_decisions.reclaim(stale.trigger_number);
+    record_timeline_event(m_token_timeline, TimelineEvent::kRetired, stale.trigger_number);
+    m_tokens.release();
+    m_token_counters.add(TokenCounter::kStaleReclaimed);
   }
 }
 
@@ -14,7 +14,26 @@
 #ifndef TRIGEMU_PLUGINS_TRIGGERDECISIONEMULATOR_HPP_
 #define TRIGEMU_PLUGINS_TRIGGERDECISIONEMULATOR_HPP_
 
+#include "trigemu/ArrivalModel.hpp"
+#include "trigemu/Clock.hpp"
+#include "trigemu/CreditPool.hpp"
+#include "trigemu/DecisionDispatcher.hpp"
+#include "trigemu/DecisionRecorder.hpp"
+#include "trigemu/EmissionQueue.hpp"
+#include "trigemu/EmitterPolicies.hpp"
+#include "trigemu/EmpiricalDistribution.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/OpenDecisionTracker.hpp"
+#include "trigemu/RateSchedule.hpp"
+#include "trigemu/RegionInhibits.hpp"
+#include "trigemu/SnapshotMailbox.hpp"
+#include "trigemu/StatusPage.hpp"
+#include "trigemu/ThreadCounters.hpp"
+#include "trigemu/Timeline.hpp"
 #include "trigemu/TimestampEstimator.hpp"
+#include "trigemu/TriggerStream.hpp"
+#include "trigemu/TriggerTraceReader.hpp"
+#include "trigemu/triggerdecisionemulatorinfo/InfoStructs.hpp"
 
 #include "daqdataformats/GeoID.hpp"
 #include "dfmessages/TimeSync.hpp"
@@ -27,7 +46,12 @@
 #include "iomanager/Sender.hpp"
 #include "iomanager/Receiver.hpp"
 
+#include <array>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <set>
 #include <string>
 #include <vector>
@@ -68,15 +92,46 @@ private:
   void do_pause(const nlohmann::json& obj);
   void do_resume(const nlohmann::json& obj);
   void do_scrap(const nlohmann::json& obj);
-
-  // Are we inhibited from sending triggers?
-  bool triggers_are_inhibited() { return m_inhibited.load(); }
-
-  // Thread functions
-  void send_trigger_decisions();
+  // Takes the same parameters as conf, but only applies the streams'
+  // trigger types, links and readout windows, which can change while
+  // running. The streams themselves, and everything else, stay as configured
+  void do_update(const nlohmann::json& obj);
+
+  // Thread functions. The sending loop is compiled for each
+  // combination of the policies in EmitterPolicies.hpp, which are fixed
+  // for the run, and start_sending() runs the one that fits
+  template<typename Admission, typename InhibitSource, typename Triggers, typename Dispatch>
+  void send_trigger_decisions(Admission admission, InhibitSource inhibits, Dispatch dispatch);
+  template<typename Admission>
+  void start_sending(Admission admission);
+  template<typename Admission, typename InhibitSource>
+  void start_sending(Admission admission, InhibitSource inhibits);
+  template<typename Admission, typename InhibitSource, typename Triggers>
+  void start_sending(Admission admission, InhibitSource inhibits);
   // void estimate_current_timestamp();
   void read_inhibit_queue();
   void read_token_queue();
+  // When all of the decision's readout windows should be in the readout's buffers, with the margin
+  dfmessages::timestamp_t window_complete_timestamp(const dfmessages::TriggerDecision& decision) const;
+  // Does the decision ask for data older than the readout keeps? From the sending thread
+  bool readout_has_dropped_data_for(const dfmessages::TriggerDecision& decision) const;
+  // Apply the region inhibit policy to a decision of `stream` while the regions in `busy` are busy. Masked
+  // components are taken out of it. Returns false if it shouldn't be sent at all. From the sending thread
+  bool apply_region_inhibits(dfmessages::TriggerDecision& decision,
+                             size_t stream,
+                             bool replayed,
+                             uint64_t busy); // NOLINT(build/unsigned)
+  // Is the timestamp estimate too old to trust? Warns when it becomes so. From the sending thread
+  bool timestamp_estimate_is_stale();
+  // Move the rate schedule on to `step`, which starts at trigger timestamp `timestamp`, and report on the step before
+  void begin_rate_step(size_t step, dfmessages::timestamp_t timestamp);
+  // Update the status page, if there is one. From the sending thread while it runs, otherwise from commands
+  void publish_status(statuspage::State state);
+  // Deal with the open decisions that have gone stale. Called from the token thread
+  void handle_stale_decisions();
+  // Summarise the run. At stop, once the threads have finished and before the estimator goes
+  triggerdecisionemulatorinfo::RunReport make_run_report(uint64_t stop_us) const; // NOLINT(build/unsigned)
+  void write_run_report(const triggerdecisionemulatorinfo::RunReport& report);
 
   // ...and the std::threads that hold them
   std::thread m_send_trigger_decisions_thread;
@@ -84,43 +139,181 @@ private:
   std::thread m_read_inhibit_queue_thread;
   std::thread m_read_token_queue_thread;
 
-  std::unique_ptr<TimestampEstimator> m_timestamp_estimator;
-
-  // Create the next trigger decision
-  dfmessages::TriggerDecision create_decision(dfmessages::timestamp_t timestamp);
+  std::shared_ptr<TimestampEstimator> m_timestamp_estimator;
+  // Protects m_timestamp_estimator against creation/destruction while get_info() reads it
+  std::mutex m_timestamp_estimator_mutex;
+
+  // One generated trigger stream, and its counters for opmon
+  struct TriggerStream
+  {
+    explicit TriggerStream(const TriggerStreamConf& stream_conf);
+
+    // As configured. What create_decision() uses is in DecisionConf
+    TriggerStreamConf conf;
+
+    // Written by the sending thread only
+    std::atomic<uint64_t> trigger_count{ 0 };           // NOLINT(build/unsigned)
+    std::atomic<uint64_t> inhibited_trigger_count{ 0 }; // NOLINT(build/unsigned)
+    // What get_info() last reported
+    uint64_t reported_triggers{ 0 };  // NOLINT(build/unsigned)
+    uint64_t reported_inhibited{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  // What create_decision() needs of a stream: its trigger type, links
+  // and readout windows. Never changed once made; conf and update
+  // publish a new set in m_decision_conf_mailbox, and the sending thread
+  // takes it between decisions, so they can change mid-run without
+  // the sending thread taking any locks
+  struct DecisionConf
+  {
+    DecisionConf(const TriggerStreamConf& stream_conf, const TriggerTypeDistributions& distributions);
+
+    TriggerStreamConf conf;
+    std::uniform_int_distribution<int> n_links_dist;
+    std::uniform_int_distribution<dfmessages::timestamp_t> window_ticks_dist;
+    // Drawn from instead of the uniform distributions, if the distribution file has them for this trigger type
+    std::shared_ptr<const EmpiricalDistribution> link_count_histogram;
+    std::shared_ptr<const EmpiricalDistribution> window_ticks_histogram;
+  };
+  using DecisionConfs = std::vector<DecisionConf>;
+  // Throws DistributionFileError if there's a distribution file and it can't be read
+  static std::unique_ptr<DecisionConfs> make_decision_confs(const std::vector<TriggerStreamConf>& stream_confs,
+                                                            const std::string& distribution_file);
+  SnapshotMailbox<DecisionConfs> m_decision_conf_mailbox;
+  // The set in use. Only the sending thread touches it
+  std::unique_ptr<DecisionConfs> m_decision_confs;
+  // Switch to the latest published set, if there's a new one
+  void take_decision_confs();
+
+  // Create the next trigger decision, for stream number `stream`
+  dfmessages::TriggerDecision create_decision(size_t stream, dfmessages::timestamp_t timestamp);
+  // Create the next trigger decision from one read from the trigger trace
+  dfmessages::TriggerDecision create_replayed_decision(const dfmessages::TriggerDecision& replayed);
+
+  // A stream's interval, scaled by the interval given at resume
+  dfmessages::timestamp_t scaled_interval(dfmessages::timestamp_t stream_interval_ticks) const;
 
   // Queue sources and sinks
   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> m_time_sync_source;
-  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TriggerInhibit>> m_trigger_inhibit_source;
+  std::string m_time_sync_connection;
+  // Use the process's shared estimator for m_time_sync_connection, rather than one of our own
+  bool m_share_timestamp_estimator{ false };
+  using inhibit_source_t = std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TriggerInhibit>>;
+  inhibit_source_t m_trigger_inhibit_source;
+  // The trigger_inhibit_source_<region> connections, by region name, and in the order of the configured regions
+  std::map<std::string, inhibit_source_t> m_region_inhibit_sources;
+  std::vector<inhibit_source_t> m_region_inhibit_receivers;
   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TriggerDecisionToken>> m_token_source;
-  std::shared_ptr<iomanager::SenderConcept<dfmessages::TriggerDecision>> m_trigger_decision_sink;
+  // Sharding of the trigger timeline between m_shard_count instances:
+  // this one sends the triggers in every m_shard_count-th slot of the
+  // timeline, starting at slot m_shard_index
+  uint64_t m_shard_count{ 1 };                  // NOLINT(build/unsigned)
+  uint64_t m_shard_index{ 0 };                  // NOLINT(build/unsigned)
+  dfmessages::timestamp_t m_shard_epoch_ticks{ 1 };
+
+  // Shares the decisions out between the trigger_decision_sink* connections
+  DecisionDispatcher m_dispatcher;
 
   // Variables controlling how we produce triggers
 
-  // Triggers are produced for timestamps:
-  //    m_trigger_offset + n*m_trigger_interval_ticks;
-  // with n integer.
+  // With the periodic arrival model, a stream's triggers are produced
+  // for timestamps:
+  //    m_trigger_offset + n*interval;
+  // with n integer. The other models start from the first of these
+  // and generate the following timestamps as described in
+  // ArrivalModel.cpp. Each stream's interval is the configured one
+  // multiplied by m_trigger_interval_ticks/m_configured_interval_ticks,
+  // so that resume can change the rate of all the streams together
   //
   // A trigger for timestamp t is emitted approximately
   // `m_trigger_delay_ticks` ticks after the timestamp t is
   // estimated to occur, so we can try not to emit trigger requests
-  // for data that's in the future
+  // for data that's in the future. If m_emit_when_window_complete is
+  // set, it's emitted instead when the end of its latest readout
+  // window, plus m_window_margin_ticks, is estimated to have passed,
+  // so that short windows don't wait as long as the longest
   dfmessages::timestamp_t m_trigger_offset{ 0 };
   std::atomic<dfmessages::timestamp_t> m_trigger_interval_ticks{ 0 };
+  dfmessages::timestamp_t m_configured_interval_ticks{ 1 };
   int trigger_delay_ticks_{ 0 };
-
-  // The offset and width of the windows to be requested in the trigger
-  daqdataformats::timestamp_diff_t m_trigger_window_offset{ 0 };
-  dfmessages::timestamp_t m_min_readout_window_ticks{ 0 };
-  dfmessages::timestamp_t m_max_readout_window_ticks{ 0 };
-
-  // The trigger type for the trigger requests
-  dfmessages::trigger_type_t m_trigger_type{ 0xff };
-
-  // The link IDs which should be read out in the trigger decision
-  std::vector<dfmessages::GeoID> m_links;
-  int m_min_links_in_request;
-  int m_max_links_in_request;
+  bool m_emit_when_window_complete{ false };
+  dfmessages::timestamp_t m_window_margin_ticks{ 0 };
+
+  // The trigger streams, each with its own type, arrival model, links
+  // and readout windows. They're merged in timestamp order into a
+  // single sequence of trigger numbers
+  std::vector<std::unique_ptr<TriggerStream>> m_streams;
+  // Protects m_streams against replacement at conf while get_info() reads it
+  std::mutex m_streams_mutex;
+  std::default_random_engine m_random_engine;
+
+  // If a trace file is configured, the trigger timestamps, types and
+  // components are replayed from it instead of being generated
+  std::string m_trace_file;
+  double m_trace_time_scale{ 1. };
+  dfmessages::timestamp_t m_trace_start_offset_ticks{ 0 };
+  bool m_trace_loop{ false };
+  std::unique_ptr<TriggerTraceReplay> m_trace_replay;
+
+  // Optional record of every decision we send
+  std::string m_record_file_prefix;
+  size_t m_record_max_file_bytes{ 0 };
+  size_t m_record_index_interval{ 0 };
+  bool m_record_fsync{ false };
+  std::unique_ptr<DecisionRecorder> m_recorder;
+  // Protects m_recorder against creation/destruction while get_info() reads it
+  std::mutex m_recorder_mutex;
+  std::atomic<uint64_t> m_recorded_count{ 0 };       // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_record_dropped_count{ 0 }; // NOLINT(build/unsigned)
+
+  // Optional record of the TimeSyncs received, written by the estimator thread
+  std::string m_time_sync_record_file_prefix;
+  std::unique_ptr<TimeSyncRecorder> m_time_sync_recorder;
+
+  // Optional timeline of the life of each decision, and of the
+  // inhibits and TimeSyncs around them, written out at stop
+  std::string m_timeline_file_prefix;
+  size_t m_timeline_events_per_thread{ 0 };
+  Timeline m_timeline;
+  // Each thread's buffer in m_timeline, or null if there's no timeline
+  TimelineBuffer* m_sender_timeline{ nullptr };
+  TimelineBuffer* m_inhibit_timeline{ nullptr };
+  TimelineBuffer* m_token_timeline{ nullptr };
+  TimelineBuffer* m_estimator_timeline{ nullptr };
+
+  // Optional live status in shared memory, for external monitors. The
+  // lateness histogram in m_status is filled in as decisions are sent,
+  // whether or not there's a status page, for the run report
+  std::string m_status_page_name;
+  std::unique_ptr<StatusPageWriter> m_status_page;
+  statuspage::Status m_status{};
+
+  // Optional schedule of trigger rates within the run, for capacity
+  // scans. The wall-clock, inhibited and token-starved times at the
+  // start of the current step are kept to report on it
+  std::unique_ptr<RateSchedule> m_rate_schedule;
+  uint64_t m_rate_step_start_us{ 0 };     // NOLINT(build/unsigned)
+  uint64_t m_rate_step_inhibited_us{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_rate_step_starved_us{ 0 };   // NOLINT(build/unsigned)
+  // The current step and the first saturated one, -1 if none
+  std::atomic<int64_t> m_rate_step{ -1 };
+  std::atomic<int64_t> m_saturated_step{ -1 };
+  std::mutex m_rate_step_reports_mutex;
+  std::vector<RateStepReport> m_rate_step_reports;
+
+  // Time from sending each decision to its token coming back, binned
+  // like the lateness. Only the token thread touches these in a run
+  std::array<uint64_t, statuspage::s_lateness_bins> m_round_trip_us_bins{}; // NOLINT(build/unsigned)
+  uint64_t m_round_trip_count{ 0 };                                        // NOLINT(build/unsigned)
+  uint64_t m_round_trip_max_us{ 0 };                                       // NOLINT(build/unsigned)
+
+  // The summary of each run made at stop. It's written to
+  // <prefix>_run<run>_report.json if there's a prefix, and kept until
+  // get_info() has published it once
+  std::string m_run_report_file_prefix;
+  uint64_t m_run_start_us{ 0 }; // NOLINT(build/unsigned)
+  std::unique_ptr<triggerdecisionemulatorinfo::RunReport> m_unpublished_run_report;
+  std::mutex m_run_report_mutex;
 
   int m_repeat_trigger_count{ 1 };
 
@@ -131,13 +324,48 @@ private:
   // sequence is clean, in the sense of all the in-flight triggers
   // getting to disk
   int m_stop_burst_count{ 0 };
+  std::chrono::microseconds m_stop_burst_interval{ 0 };
+  // How long stop waits for open decisions to drain, if it's not 0.
+  // While it waits, m_draining keeps the token thread going, and that
+  // notes when it last closed a decision, on m_clock. The stop burst
+  // waits for tokens until the same deadline, which do_stop() sets
+  // before it stops the sending thread
+  std::chrono::milliseconds m_stop_drain_deadline{ 0 };
+  Clock::time_point m_drain_deadline;
+  std::atomic<bool> m_draining{ false };
+  std::atomic<int64_t> m_last_drain_close_ns{ 0 };
 
   // The most recent inhibit status we've seen (true = inhibited)
   std::atomic<bool> m_inhibited;
-  std::atomic<int> m_tokens;
+  // The busy state of the inhibit regions, each of which only holds up the triggers that read it out
+  RegionInhibits m_region_inhibits;
+  // Tokens, as credits: one is taken for each decision sent, and given back when its token arrives
+  CreditPool m_tokens;
   int m_initial_tokens;
-  std::mutex m_open_trigger_decisions_mutex;
-  std::set<dfmessages::trigger_number_t> m_open_trigger_decisions;
+  // How long to wait for enough tokens before giving up on a trigger
+  std::chrono::milliseconds m_token_wait{ 0 };
+  // Skip triggers while the last TimeSync is older than this, if it's not 0
+  std::chrono::milliseconds m_max_time_sync_age{ 0 };
+  bool m_estimate_stale{ false };
+  // How much data the readout keeps, in ticks back from now. Triggers
+  // whose readout windows begin before that are dropped, if it's not 0
+  dfmessages::timestamp_t m_readout_buffer_depth_ticks{ 0 };
+  // If there aren't tokens for all the repeats of a trigger, send as many as there are tokens for
+  bool m_allow_partial_token_grant{ false };
+  // The decisions whose token hasn't come back yet
+  OpenDecisionTracker m_open_trigger_decisions;
+
+  // What to do about a decision whose token hasn't come back after
+  // m_open_decision_timeout: give its token back, send it again (up
+  // to m_max_resends times, then give its token back), or just warn
+  enum class StalePolicy
+  {
+    kReclaim,
+    kResend,
+    kWarn
+  };
+  StalePolicy m_stale_policy{ StalePolicy::kReclaim };
+  int m_max_resends{ 0 };
   // paused state, equivalent to inhibited
   std::atomic<bool> m_paused;
 
@@ -150,10 +378,75 @@ private:
   // Are we in a configured state, ie after conf and before scrap?
   std::atomic<bool> m_configured_flag{ false };
 
-  std::atomic<uint64_t> m_trigger_count{ 0 };               // NOLINT(build/unsigned)
-  std::atomic<uint64_t> m_trigger_count_tot{ 0 };           // NOLINT(build/unsigned)
-  std::atomic<uint64_t> m_inhibited_trigger_count{ 0 };     // NOLINT(build/unsigned)
-  std::atomic<uint64_t> m_inhibited_trigger_count_tot{ 0 }; // NOLINT(build/unsigned)
+  // The clock that paces our threads: the wall clock, or the shared
+  // virtual clock for accelerated simulations
+  std::shared_ptr<Clock> m_clock;
+  // Protects m_clock against replacement at conf while get_info() reads it
+  std::mutex m_clock_mutex;
+
+  // Cuts the polling sleeps of our threads short at stop
+  InterruptibleSleeper m_sleeper;
+  std::unique_ptr<Clock::Participant> m_clock_participant;
+
+  // Run transition latencies, reported in opmon
+  std::chrono::steady_clock::time_point m_start_time;
+  std::atomic<bool> m_first_decision_sent{ false };
+  std::atomic<uint64_t> m_start_to_first_decision_us{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_stop_to_joined_us{ 0 };          // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_stop_to_drained_us{ 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_undrained_at_stop{ 0 };          // NOLINT(build/unsigned)
+
+  // Counters for opmon, in one block for each thread that writes
+  // them, so that counting is never contended. They're zeroed at
+  // start and added up in get_info()
+  enum class SenderCounter
+  {
+    kTriggers,
+    kInhibited,           // Triggers skipped for lack of tokens
+    kPartialTokenGrants,  // Triggers sent with fewer repeats than configured, for lack of tokens
+    kDecisionsNotSent,    // Decisions that no sink accepted
+    kStaleEstimate,       // Triggers skipped because the timestamp estimate was stale
+    kDataflowInhibited,   // Triggers skipped while dataflow inhibited them
+    kExpired,             // Triggers dropped because the readout would no longer have their data
+    kMaskedComponents,    // Components left out of decisions because their region was busy
+    kRegionInhibited,     // Triggers skipped because regions they read out were busy
+    kCount
+  };
+  enum class InhibitCounter
+  {
+    kOtherRunInhibits, // Dropped because they were stamped with another run number
+    kCount
+  };
+  enum class TokenCounter
+  {
+    kTokens,
+    kOtherRunTokens, // Dropped because they were stamped with another run number
+    kLateTokens,     // Came back for decisions that had been reclaimed, or for copies that were sent again
+    kUnknownTokens,  // Came back for decisions that weren't open
+    kStaleReclaimed,
+    kStaleResent,
+    kStaleExpired, // Stale decisions not sent again because the readout no longer has their data
+    kStaleWarned,
+    kCount
+  };
+  ThreadCounters<SenderCounter> m_sender_counters;
+  ThreadCounters<InhibitCounter> m_inhibit_counters;
+  ThreadCounters<TokenCounter> m_token_counters;
+
+  // Time spent inhibited by dataflow, and paused, in this run
+  StateTimer m_inhibited_time;
+  StateTimer m_paused_time;
+
+  // get_info() adds the per-stream, per-region, per-sink and per-thread details,
+  // and the age of the oldest open decision, from this level up
+  static constexpr int s_detailed_info_level = 1;
+  // What get_info() last reported, for the incremental counters and
+  // the time fractions. Only get_info() uses these
+  uint64_t m_reported_triggers{ 0 };     // NOLINT(build/unsigned)
+  uint64_t m_reported_inhibited{ 0 };    // NOLINT(build/unsigned)
+  uint64_t m_reported_time_us{ 0 };      // NOLINT(build/unsigned)
+  uint64_t m_reported_inhibited_us{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_reported_paused_us{ 0 };    // NOLINT(build/unsigned)
 };
 } // namespace trigemu
 } // namespace dunedaq
@@ -0,0 +1,293 @@
+/**
+ * @file ArrivalModel.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ArrivalModel.hpp"
+#include "trigemu/Issues.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+namespace {
+
+using dfmessages::timestamp_t;
+
+// Draw an exponentially-distributed number of ticks with the given mean
+timestamp_t
+exponential_ticks(std::mt19937_64& engine, timestamp_t mean)
+{
+  std::exponential_distribution<double> dist(1. / static_cast<double>(mean));
+  return static_cast<timestamp_t>(std::llround(dist(engine)));
+}
+
+// A trigger every `interval_ticks`
+class PeriodicArrivals : public ArrivalModel
+{
+public:
+  explicit PeriodicArrivals(const ArrivalModelParams& params)
+    : m_interval(params.interval_ticks)
+  {}
+
+  void start(timestamp_t /*first*/) override {}
+  timestamp_t next(timestamp_t previous) override { return previous + m_interval; }
+  void set_interval(timestamp_t interval_ticks) override { m_interval = interval_ticks; }
+
+private:
+  timestamp_t m_interval;
+};
+
+// A trigger every `interval_ticks`, each one displaced by a gaussian
+// jitter. The jitter doesn't accumulate: triggers stay centred on the
+// periodic grid
+class JitteredArrivals : public ArrivalModel
+{
+public:
+  explicit JitteredArrivals(const ArrivalModelParams& params)
+    : m_interval(params.interval_ticks)
+    , m_jitter(0., static_cast<double>(params.jitter_ticks))
+    , m_engine(params.seed)
+  {}
+
+  void start(timestamp_t first) override { m_nominal = first; }
+
+  timestamp_t next(timestamp_t previous) override
+  {
+    m_nominal += m_interval;
+    double t = static_cast<double>(m_nominal) + m_jitter(m_engine);
+    // Keep the sequence ordered when the jitter is comparable to the interval
+    if (t <= static_cast<double>(previous)) {
+      return previous;
+    }
+    return static_cast<timestamp_t>(std::llround(t));
+  }
+
+  void set_interval(timestamp_t interval_ticks) override { m_interval = interval_ticks; }
+
+private:
+  timestamp_t m_interval;
+  timestamp_t m_nominal{ 0 };
+  std::normal_distribution<double> m_jitter;
+  std::mt19937_64 m_engine;
+};
+
+// Exponentially-distributed intervals with mean `interval_ticks`
+class PoissonArrivals : public ArrivalModel
+{
+public:
+  explicit PoissonArrivals(const ArrivalModelParams& params)
+    : m_interval(params.interval_ticks)
+    , m_engine(params.seed)
+  {}
+
+  void start(timestamp_t /*first*/) override {}
+  timestamp_t next(timestamp_t previous) override { return previous + exponential_ticks(m_engine, m_interval); }
+  void set_interval(timestamp_t interval_ticks) override { m_interval = interval_ticks; }
+
+private:
+  timestamp_t m_interval;
+  std::mt19937_64 m_engine;
+};
+
+// Markov-modulated Poisson process with two states. In the "off" state
+// triggers arrive at the background rate (mean interval
+// `interval_ticks`), in the "on" state at the burst rate (mean interval
+// `burst_interval_ticks`). The time spent in each state is exponentially
+// distributed with mean `burst_off_ticks` or `burst_on_ticks`
+class OnOffArrivals : public ArrivalModel
+{
+public:
+  explicit OnOffArrivals(const ArrivalModelParams& params)
+    : m_interval(params.interval_ticks)
+    , m_burst_interval(params.burst_interval_ticks)
+    , m_on_ticks(params.burst_on_ticks)
+    , m_off_ticks(params.burst_off_ticks)
+    , m_engine(params.seed)
+  {}
+
+  void start(timestamp_t first) override
+  {
+    m_on = false;
+    m_state_end = first + exponential_ticks(m_engine, m_off_ticks);
+  }
+
+  timestamp_t next(timestamp_t previous) override
+  {
+    while (true) {
+      timestamp_t candidate = previous + exponential_ticks(m_engine, m_on ? m_burst_interval : m_interval);
+      if (candidate < m_state_end) {
+        return candidate;
+      }
+      // The state changed before the candidate trigger. Both processes
+      // are memoryless, so we can carry on from the state change
+      previous = m_state_end;
+      m_on = !m_on;
+      m_state_end += exponential_ticks(m_engine, m_on ? m_on_ticks : m_off_ticks);
+    }
+  }
+
+  void set_interval(timestamp_t interval_ticks) override { m_interval = interval_ticks; }
+
+private:
+  timestamp_t m_interval;
+  timestamp_t m_burst_interval;
+  timestamp_t m_on_ticks;
+  timestamp_t m_off_ticks;
+  bool m_on{ false };
+  timestamp_t m_state_end{ 0 };
+  std::mt19937_64 m_engine;
+};
+
+// A burst of `burst_count` triggers every `interval_ticks`. The first
+// trigger of each burst is on the periodic grid, and the others are
+// spread uniformly over the following `burst_window_ticks`
+class BurstArrivals : public ArrivalModel
+{
+public:
+  explicit BurstArrivals(const ArrivalModelParams& params)
+    : m_interval(params.interval_ticks)
+    , m_offsets(params.burst_count)
+    , m_offset_dist(0, params.burst_window_ticks > 0 ? params.burst_window_ticks - 1 : 0)
+    , m_engine(params.seed)
+  {}
+
+  void start(timestamp_t first) override { start_burst(first); }
+
+  timestamp_t next(timestamp_t previous) override
+  {
+    if (++m_index == m_offsets.size()) {
+      start_burst(m_burst_start + m_interval);
+    }
+    return std::max(previous, m_burst_start + m_offsets[m_index]);
+  }
+
+  void set_interval(timestamp_t interval_ticks) override { m_interval = interval_ticks; }
+
+private:
+  void start_burst(timestamp_t burst_start)
+  {
+    m_burst_start = burst_start;
+    m_index = 0;
+    m_offsets[0] = 0;
+    for (size_t i = 1; i < m_offsets.size(); ++i) {
+      m_offsets[i] = m_offset_dist(m_engine);
+    }
+    std::sort(m_offsets.begin(), m_offsets.end());
+  }
+
+  timestamp_t m_interval;
+  timestamp_t m_burst_start{ 0 };
+  std::vector<timestamp_t> m_offsets;
+  size_t m_index{ 0 };
+  std::uniform_int_distribution<timestamp_t> m_offset_dist;
+  std::mt19937_64 m_engine;
+};
+
+} // namespace
+
+std::unique_ptr<ArrivalModel>
+make_arrival_model(const ArrivalModelParams& params)
+{
+  if (params.interval_ticks == 0) {
+    throw InvalidArrivalModel(ERS_HERE, params.model, "the trigger interval must be positive");
+  }
+
+  if (params.model == "periodic") {
+    return std::make_unique<PeriodicArrivals>(params);
+  }
+  if (params.model == "jittered") {
+    return std::make_unique<JitteredArrivals>(params);
+  }
+  if (params.model == "poisson") {
+    return std::make_unique<PoissonArrivals>(params);
+  }
+  if (params.model == "onoff") {
+    if (params.burst_interval_ticks == 0 || params.burst_on_ticks == 0 || params.burst_off_ticks == 0) {
+      throw InvalidArrivalModel(
+        ERS_HERE, params.model, "the burst interval and the on and off durations must be positive");
+    }
+    return std::make_unique<OnOffArrivals>(params);
+  }
+  if (params.model == "burst") {
+    if (params.burst_count == 0) {
+      throw InvalidArrivalModel(ERS_HERE, params.model, "the burst must contain at least one trigger");
+    }
+    return std::make_unique<BurstArrivals>(params);
+  }
+  throw InvalidArrivalModel(ERS_HERE, params.model, "unknown model");
+}
+
+double
+mean_rate_hz(const ArrivalModelParams& params, uint64_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  if (params.interval_ticks == 0) {
+    return 0;
+  }
+  const double base_rate_hz = static_cast<double>(clock_frequency_hz) / params.interval_ticks;
+  if (params.model == "onoff" && params.burst_interval_ticks > 0 && params.burst_on_ticks + params.burst_off_ticks > 0) {
+    // Weighted by the mean time spent in each state
+    const double burst_rate_hz = static_cast<double>(clock_frequency_hz) / params.burst_interval_ticks;
+    return (burst_rate_hz * params.burst_on_ticks + base_rate_hz * params.burst_off_ticks) /
+           (params.burst_on_ticks + params.burst_off_ticks);
+  }
+  if (params.model == "burst") {
+    return base_rate_hz * params.burst_count;
+  }
+  return base_rate_hz;
+}
+
+TriggerSchedule::TriggerSchedule(std::unique_ptr<ArrivalModel> model, size_t depth)
+  : m_model(std::move(model))
+  , m_buffer(std::max(depth, size_t(2)))
+{}
+
+void
+TriggerSchedule::start(dfmessages::timestamp_t first)
+{
+  m_model->start(first);
+  m_head = 0;
+  m_buffer[m_head] = first;
+  m_count = 1;
+  refill();
+}
+
+void
+TriggerSchedule::pop()
+{
+  m_head = (m_head + 1) % m_buffer.size();
+  --m_count;
+  // Top up in batches rather than one at a time
+  if (m_count <= m_buffer.size() / 2) {
+    refill();
+  }
+}
+
+void
+TriggerSchedule::set_interval(dfmessages::timestamp_t interval_ticks)
+{
+  m_model->set_interval(interval_ticks);
+  start(front());
+}
+
+void
+TriggerSchedule::refill()
+{
+  const size_t size = m_buffer.size();
+  while (m_count < size) {
+    size_t last = (m_head + m_count - 1) % size;
+    m_buffer[(last + 1) % size] = m_model->next(m_buffer[last]);
+    ++m_count;
+  }
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,191 @@
+/**
+ * @file Clock.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Clock.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <tuple>
+
+namespace dunedaq::trigemu {
+
+bool
+SystemClock::sleep_until(time_point deadline, const std::function<bool()>& interrupted)
+{
+  std::unique_lock<std::mutex> lk(m_mutex);
+  // Wait on a relative duration, so that the sleep is measured on the
+  // steady clock and isn't affected by wall-clock adjustments
+  return !m_cv.wait_for(lk, deadline - now(), interrupted);
+}
+
+void
+SystemClock::notify()
+{
+  { // Taking the lock ensures a sleeper is either before its check of `interrupted` or already waiting
+    std::lock_guard<std::mutex> lk(m_mutex);
+  }
+  m_cv.notify_all();
+}
+
+namespace {
+// The name the current thread entered a virtual clock with
+thread_local std::string t_thread_name; // NOLINT(runtime/string)
+} // namespace
+
+VirtualClock::VirtualClock(time_point start)
+  : m_now(start)
+{}
+
+Clock::time_point
+VirtualClock::now()
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_now;
+}
+
+bool
+VirtualClock::sleep_until(time_point deadline, const std::function<bool()>& interrupted)
+{
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (interrupted()) {
+    return false;
+  }
+  if (deadline <= m_now) {
+    return true;
+  }
+  return sleep(lk, deadline, &interrupted);
+}
+
+void
+VirtualClock::enter(const std::string& name)
+{
+  t_thread_name = name;
+  std::unique_lock<std::mutex> lk(m_mutex);
+  // Wait for our turn, so that threads that are started together run in a fixed order
+  sleep(lk, m_now, nullptr);
+}
+
+bool
+VirtualClock::sleep(std::unique_lock<std::mutex>& lk, time_point deadline, const std::function<bool()>* interrupted)
+{
+  Sleeper self{ deadline, t_thread_name, m_sequence++, interrupted };
+  m_sleepers.push_back(&self);
+  // We've stopped running: maybe everybody has
+  schedule();
+  m_cv.wait(lk, [&self] { return self.woken; });
+  return self.completed;
+}
+
+bool
+VirtualClock::wait_until(time_point deadline, const std::function<bool()>& interrupted)
+{
+  std::unique_lock<std::mutex> lk(m_mutex);
+  if (interrupted()) {
+    return false;
+  }
+  if (deadline <= m_now) {
+    return true;
+  }
+  // Not numbered from m_sequence, which only counts the participants' sleeps
+  Sleeper self{ deadline, std::string(), 0, &interrupted };
+  m_waiters.push_back(&self);
+  // Without participants, there's nothing else to move time on
+  schedule();
+  while (!self.woken) {
+    if (interrupted()) {
+      m_waiters.erase(std::find(m_waiters.begin(), m_waiters.end(), &self));
+      return false;
+    }
+    m_cv.wait(lk);
+  }
+  return true;
+}
+
+void
+VirtualClock::schedule()
+{
+  const auto earlier = [](const Sleeper* a, const Sleeper* b) {
+    return std::tie(a->deadline, a->name, a->sequence) < std::tie(b->deadline, b->name, b->sequence);
+  };
+
+  // Threads that sleep without being registered are counted as if they were
+  while (static_cast<int>(m_sleepers.size()) >= m_participants) {
+    // An interrupted sleeper goes first, without moving time on
+    Sleeper* next = nullptr;
+    for (auto* sleeper : m_sleepers) {
+      if (sleeper->interrupted != nullptr && (*sleeper->interrupted)() && (next == nullptr || earlier(sleeper, next))) {
+        next = sleeper;
+      }
+    }
+    const bool interrupted = next != nullptr;
+    if (!interrupted && !m_sleepers.empty()) {
+      next = *std::min_element(m_sleepers.begin(), m_sleepers.end(), earlier);
+    }
+
+    // Waiters that are due first are woken on the way
+    auto waiter = std::min_element(m_waiters.begin(), m_waiters.end(), earlier);
+    if (waiter != m_waiters.end() && (next == nullptr || (!interrupted && (*waiter)->deadline <= next->deadline))) {
+      m_now = std::max(m_now, (*waiter)->deadline);
+      (*waiter)->woken = true;
+      m_waiters.erase(waiter);
+      m_cv.notify_all();
+      continue;
+    }
+    if (next == nullptr) {
+      return;
+    }
+
+    if (!interrupted) {
+      m_now = std::max(m_now, next->deadline);
+    }
+    next->woken = true;
+    next->completed = !interrupted;
+    m_sleepers.erase(std::find(m_sleepers.begin(), m_sleepers.end(), next));
+    m_cv.notify_all();
+    return;
+  }
+}
+
+void
+VirtualClock::notify()
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  // Waiters check for themselves. Participants are checked when it's
+  // their turn, which is as soon as the one that's running sleeps
+  m_cv.notify_all();
+}
+
+void
+VirtualClock::add_participant(int count)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_participants += count;
+}
+
+void
+VirtualClock::remove_participant(int count)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_participants -= count;
+  // Fewer threads to wait for: maybe everyone left is asleep
+  schedule();
+}
+
+std::shared_ptr<Clock>
+make_clock(bool use_virtual_clock)
+{
+  if (!use_virtual_clock) {
+    static std::shared_ptr<Clock> s_system_clock = std::make_shared<SystemClock>();
+    return s_system_clock;
+  }
+  static std::shared_ptr<Clock> s_virtual_clock = std::make_shared<VirtualClock>();
+  return s_virtual_clock;
+}
+
+} // namespace dunedaq::trigemu
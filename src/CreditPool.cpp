@@ -0,0 +1,105 @@
+/**
+ * @file CreditPool.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/CreditPool.hpp"
+
+#include <algorithm>
+
+namespace dunedaq::trigemu {
+
+void
+CreditPool::reset(int64_t credits)
+{
+  m_credits.store(credits);
+  m_starved_since_us.store(-1);
+  m_starved_total_us.store(0);
+  m_starved_count.store(0);
+}
+
+bool
+CreditPool::try_acquire(int64_t n)
+{
+  int64_t credits = m_credits.load(std::memory_order_relaxed);
+  bool success = false;
+  while (credits >= n) {
+    if (m_credits.compare_exchange_weak(credits, credits - n, std::memory_order_acquire, std::memory_order_relaxed)) {
+      success = true;
+      break;
+    }
+  }
+  acquired(success);
+  return success;
+}
+
+int64_t
+CreditPool::try_acquire_up_to(int64_t n)
+{
+  int64_t credits = m_credits.load(std::memory_order_relaxed);
+  int64_t taken = 0;
+  while (credits > 0) {
+    taken = std::min(credits, n);
+    if (m_credits.compare_exchange_weak(credits, credits - taken, std::memory_order_acquire, std::memory_order_relaxed)) {
+      break;
+    }
+    taken = 0;
+  }
+  acquired(taken > 0);
+  return taken;
+}
+
+bool
+CreditPool::acquire_until(int64_t n, Clock::time_point deadline, const std::function<bool()>& interrupted)
+{
+  while (!try_acquire(n)) {
+    if (interrupted()) {
+      return false;
+    }
+    // release() notifies the clock, which wakes us to check again
+    bool reached_deadline =
+      m_clock->sleep_until(deadline, [&]() { return interrupted() || m_credits.load() >= n; });
+    if (reached_deadline) {
+      return try_acquire(n);
+    }
+  }
+  return true;
+}
+
+void
+CreditPool::release(int64_t n)
+{
+  m_credits.fetch_add(n, std::memory_order_release);
+  m_clock->notify();
+}
+
+void
+CreditPool::acquired(bool success)
+{
+  int64_t since = m_starved_since_us.load();
+  if (success) {
+    if (since >= 0) {
+      m_starved_total_us += static_cast<int64_t>(m_clock->now_us()) - since;
+      m_starved_since_us.store(-1);
+    }
+  } else if (since < 0) {
+    m_starved_since_us.store(static_cast<int64_t>(m_clock->now_us()));
+    ++m_starved_count;
+  }
+}
+
+uint64_t // NOLINT(build/unsigned)
+CreditPool::get_starved_us() const
+{
+  uint64_t total = m_starved_total_us.load(); // NOLINT(build/unsigned)
+  int64_t since = m_starved_since_us.load();
+  if (since >= 0) {
+    total += std::max<int64_t>(0, static_cast<int64_t>(m_clock->now_us()) - since);
+  }
+  return total;
+}
+
+} // namespace dunedaq::trigemu
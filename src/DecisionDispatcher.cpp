@@ -0,0 +1,243 @@
+/**
+ * @file DecisionDispatcher.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/DecisionDispatcher.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "iomanager/IOManager.hpp"
+#include "logging/Logging.hpp"
+
+#include <limits>
+#include <string>
+
+#define TRACE_NAME "DecisionDispatcher" // NOLINT
+
+namespace dunedaq::trigemu {
+
+namespace {
+// Mix the bits of the trigger number, so that sinks are chosen evenly
+// whatever the pattern of trigger numbers (eg every K-th one)
+uint64_t // NOLINT(build/unsigned)
+mix(uint64_t x) // NOLINT(build/unsigned)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+} // namespace
+
+DispatchPolicy
+parse_dispatch_policy(const std::string& name)
+{
+  if (name == "round_robin") {
+    return DispatchPolicy::kRoundRobin;
+  }
+  if (name == "least_outstanding") {
+    return DispatchPolicy::kLeastOutstanding;
+  }
+  if (name == "hash") {
+    return DispatchPolicy::kHash;
+  }
+  throw InvalidDispatchPolicy(ERS_HERE, name);
+}
+
+void
+DecisionDispatcher::configure(DispatchPolicy policy,
+                              std::chrono::milliseconds send_timeout,
+                              std::chrono::milliseconds backoff,
+                              bool track_outstanding)
+{
+  m_policy = policy;
+  m_send_timeout = send_timeout;
+  m_backoff = backoff;
+  m_track_outstanding = track_outstanding;
+}
+
+void
+DecisionDispatcher::reset()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_outstanding_mutex);
+    m_sink_of_trigger.clear();
+  }
+  std::lock_guard<std::mutex> lk(m_dispatch_mutex);
+  for (auto& sink : m_sinks) {
+    sink->skip_until.store(std::chrono::steady_clock::time_point());
+    sink->waiting_senders.store(0);
+    sink->sent.store(0);
+    sink->send_failures.store(0);
+    sink->outstanding.store(0);
+  }
+  m_next_sink = 0;
+}
+
+size_t
+DecisionDispatcher::first_choice(const dfmessages::TriggerDecision& decision)
+{
+  const size_t n = m_sinks.size();
+  switch (m_policy) {
+    case DispatchPolicy::kHash:
+      return mix(decision.trigger_number) % n;
+    case DispatchPolicy::kLeastOutstanding: {
+      // Start the search from a different sink each time, so that ties are shared out
+      auto now = std::chrono::steady_clock::now();
+      size_t best = m_next_sink % n;
+      int64_t best_outstanding = std::numeric_limits<int64_t>::max();
+      for (size_t i = 0; i < n; ++i) {
+        size_t index = (m_next_sink + i) % n;
+        auto& sink = *m_sinks[index];
+        if (sink.skip_until.load(std::memory_order_relaxed) > now) {
+          continue;
+        }
+        int64_t outstanding = sink.outstanding.load(std::memory_order_relaxed);
+        if (outstanding < best_outstanding) {
+          best = index;
+          best_outstanding = outstanding;
+        }
+      }
+      ++m_next_sink;
+      return best;
+    }
+    case DispatchPolicy::kRoundRobin:
+    default: {
+      // Move the turn past sinks that are being skipped, so the others share their decisions evenly
+      auto now = std::chrono::steady_clock::now();
+      size_t index = m_next_sink % n;
+      for (size_t i = 0; i < n && m_sinks[index]->skip_until.load(std::memory_order_relaxed) > now; ++i) {
+        index = (index + 1) % n;
+      }
+      m_next_sink = index + 1;
+      return index;
+    }
+  }
+}
+
+bool
+DecisionDispatcher::dispatch(const dfmessages::TriggerDecision& decision)
+{
+  const size_t n = m_sinks.size();
+  if (n == 0) {
+    return false;
+  }
+  size_t first = 0;
+  {
+    std::lock_guard<std::mutex> lk(m_dispatch_mutex);
+    first = first_choice(decision);
+  }
+
+  // Go round the sinks from the policy's choice: first without waiting,
+  // the ones that failed recently last, then waiting on the ones that
+  // haven't failed and that nobody else is waiting on
+  const auto now = std::chrono::steady_clock::now();
+  for (bool include_backed_off : { false, true }) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t index = (first + i) % n;
+      bool backed_off = m_sinks[index]->skip_until.load(std::memory_order_relaxed) > now;
+      if (backed_off == include_backed_off && try_send(index, decision, iomanager::Sender::s_no_block)) {
+        return true;
+      }
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    size_t index = (first + i) % n;
+    auto& sink = *m_sinks[index];
+    if (sink.skip_until.load(std::memory_order_relaxed) > std::chrono::steady_clock::now() ||
+        sink.waiting_senders.load(std::memory_order_relaxed) > 0) {
+      continue;
+    }
+    if (try_send(index, decision, m_send_timeout)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+DecisionDispatcher::dispatch_to_only_sink(const dfmessages::TriggerDecision& decision)
+{
+  if (m_sinks.empty()) {
+    return false;
+  }
+  if (try_send(0, decision, iomanager::Sender::s_no_block)) {
+    return true;
+  }
+  // It's never backed off, as there's nowhere else to send to
+  if (m_sinks[0]->waiting_senders.load(std::memory_order_relaxed) > 0) {
+    return false;
+  }
+  return try_send(0, decision, m_send_timeout);
+}
+
+bool
+DecisionDispatcher::try_send(size_t index,
+                             const dfmessages::TriggerDecision& decision,
+                             std::chrono::milliseconds timeout)
+{
+  auto& sink = *m_sinks[index];
+  // Record where the decision went before sending it, in case its token comes back straight away
+  if (m_track_outstanding) {
+    std::lock_guard<std::mutex> lk(m_outstanding_mutex);
+    m_sink_of_trigger[decision.trigger_number] = index;
+    ++sink.outstanding;
+  }
+  const bool waits = timeout > iomanager::Sender::s_no_block;
+  if (waits) {
+    ++sink.waiting_senders;
+  }
+  // However the send fails, the decision isn't at the sink, and we're no longer waiting on it
+  auto not_sent = [&]() {
+    if (waits) {
+      --sink.waiting_senders;
+    }
+    if (m_track_outstanding) {
+      std::lock_guard<std::mutex> lk(m_outstanding_mutex);
+      m_sink_of_trigger.erase(decision.trigger_number);
+      --sink.outstanding;
+    }
+  };
+  try {
+    dfmessages::TriggerDecision decision_copy(decision);
+    sink.sender->send(std::move(decision_copy), timeout);
+  } catch (iomanager::TimeoutExpired&) {
+    not_sent();
+    if (waits) {
+      ++sink.send_failures;
+      // With nowhere else to send decisions, skipping the sink would only lose them
+      if (m_sinks.size() > 1) {
+        TLOG_DEBUG(1) << "Timed out sending trigger decision " << decision.trigger_number << " to " << sink.name
+                      << ", skipping it for " << m_backoff.count() << " ms";
+        sink.skip_until.store(std::chrono::steady_clock::now() + m_backoff);
+      }
+    }
+    return false;
+  } catch (...) {
+    not_sent();
+    throw;
+  }
+  if (waits) {
+    --sink.waiting_senders;
+  }
+  ++sink.sent;
+  return true;
+}
+
+void
+DecisionDispatcher::complete(dfmessages::trigger_number_t trigger_number)
+{
+  std::lock_guard<std::mutex> lk(m_outstanding_mutex);
+  auto it = m_sink_of_trigger.find(trigger_number);
+  if (it != m_sink_of_trigger.end()) {
+    --m_sinks[it->second]->outstanding;
+    m_sink_of_trigger.erase(it);
+  }
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,239 @@
+/**
+ * @file DecisionRecorder.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/DecisionRecorder.hpp"
+#include "trigemu/DecisionFile.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#define TRACE_NAME "DecisionRecorder" // NOLINT
+
+namespace dunedaq::trigemu {
+
+namespace {
+// Write to disk once this much has been buffered, or when we run out of decisions to write
+constexpr size_t s_flush_bytes = 1024 * 1024;
+
+template<class T>
+void
+append_bytes(std::vector<char>& buffer, const T& value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&value); // NOLINT
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+bool
+write_all(int fd, const std::vector<char>& buffer)
+{
+  size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += static_cast<size_t>(n);
+  }
+  return true;
+}
+} // namespace
+
+DecisionRecorder::DecisionRecorder(const std::string& prefix,
+                                   dfmessages::run_number_t run_number,
+                                   size_t max_file_bytes,
+                                   size_t index_interval,
+                                   bool fsync_on_flush,
+                                   size_t ring_capacity)
+  : m_ring(ring_capacity)
+  , m_resent_ring(ring_capacity / 4)
+  , m_prefix(prefix)
+  , m_run_number(run_number)
+  , m_max_file_bytes(max_file_bytes)
+  , m_index_interval(index_interval > 0 ? index_interval : 1)
+  , m_fsync_on_flush(fsync_on_flush)
+{
+  m_buffer.reserve(2 * s_flush_bytes);
+  // Open the first file here, so that a bad path is reported to the caller
+  open_next_file();
+  m_writer_thread = std::thread(&DecisionRecorder::writer_thread_fn, this);
+  pthread_setname_np(m_writer_thread.native_handle(), "tde-recorder");
+}
+
+void
+DecisionRecorder::close()
+{
+  m_running_flag.store(false);
+  if (m_writer_thread.joinable()) {
+    m_writer_thread.join();
+  }
+  close_file();
+}
+
+void
+DecisionRecorder::open_next_file()
+{
+  std::ostringstream name;
+  name << m_prefix << "_run" << std::setw(6) << std::setfill('0') << m_run_number << "_" << std::setw(4)
+       << m_file_sequence++ << ".tdedec";
+  std::string path = name.str();
+
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644); // NOLINT
+  if (m_fd < 0) {
+    throw RecordingError(ERS_HERE, path, std::strerror(errno));
+  }
+  std::string index_path = path + decisionfile::s_index_suffix;
+  m_index_fd = ::open(index_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644); // NOLINT
+  if (m_index_fd < 0) {
+    int err = errno;
+    ::close(m_fd);
+    m_fd = -1;
+    throw RecordingError(ERS_HERE, index_path, std::strerror(err));
+  }
+
+  TLOG_DEBUG(1) << "Recording trigger decisions to " << path;
+  append_bytes(m_buffer, decisionfile::make_file_header());
+  m_file_bytes = sizeof(decisionfile::FileHeader);
+  m_records_in_file = 0;
+  m_unflagged_in_file = 0;
+}
+
+void
+DecisionRecorder::close_file()
+{
+  if (m_fd < 0) {
+    return;
+  }
+  flush();
+  ::close(m_fd);
+  ::close(m_index_fd);
+  m_fd = -1;
+  m_index_fd = -1;
+}
+
+void
+DecisionRecorder::append(const Entry& entry)
+{
+  const dfmessages::TriggerDecision& decision = entry.decision;
+  if (m_file_bytes >= m_max_file_bytes && m_records_in_file > 0) {
+    close_file();
+    try {
+      open_next_file();
+    } catch (RecordingError& e) {
+      ers::error(e);
+      ++m_dropped_count;
+      return;
+    }
+  }
+
+  // Flagged records can be out of timestamp order, so seeking doesn't use them
+  if (entry.flags == 0 && m_unflagged_in_file++ % m_index_interval == 0) {
+    append_bytes(m_index_buffer, decisionfile::IndexEntry{ m_file_bytes, decision.trigger_timestamp });
+  }
+
+  decisionfile::RecordHeader header{ decision.trigger_number,
+                                     decision.trigger_timestamp,
+                                     decision.run_number,
+                                     static_cast<uint16_t>(decision.trigger_type), // NOLINT(build/unsigned)
+                                     static_cast<uint16_t>(decision.components.size()), // NOLINT(build/unsigned)
+                                     entry.flags,
+                                     0 };
+  append_bytes(m_buffer, header);
+  for (auto const& request : decision.components) {
+    decisionfile::ComponentRecord record{ static_cast<uint16_t>(request.component.system_type), // NOLINT
+                                          static_cast<uint16_t>(request.component.region_id),   // NOLINT
+                                          static_cast<uint32_t>(request.component.element_id),  // NOLINT
+                                          request.window_begin,
+                                          request.window_end };
+    append_bytes(m_buffer, record);
+  }
+
+  m_file_bytes += sizeof(header) + decision.components.size() * sizeof(decisionfile::ComponentRecord);
+  ++m_records_in_file;
+  ++m_recorded_count;
+}
+
+void
+DecisionRecorder::flush()
+{
+  if (m_fd < 0) {
+    m_buffer.clear();
+    m_index_buffer.clear();
+    return;
+  }
+  // The data goes out before the index entries that point into it
+  bool ok = write_all(m_fd, m_buffer) && write_all(m_index_fd, m_index_buffer);
+  if (ok && m_fsync_on_flush) {
+    ok = ::fsync(m_fd) == 0;
+  }
+  m_buffer.clear();
+  m_index_buffer.clear();
+  if (!ok) {
+    ers::error(RecordingError(ERS_HERE, m_prefix, std::strerror(errno)));
+    // Give up on this file rather than writing a corrupt one
+    ::close(m_fd);
+    ::close(m_index_fd);
+    m_fd = -1;
+    m_index_fd = -1;
+  }
+}
+
+bool
+DecisionRecorder::drain(SPSCRing<Entry>& ring, Entry& entry)
+{
+  bool popped_any = false;
+  while (ring.try_pop(entry)) {
+    popped_any = true;
+    if (m_fd >= 0) {
+      append(entry);
+    } else {
+      ++m_dropped_count;
+    }
+    if (m_buffer.size() >= s_flush_bytes) {
+      flush();
+    }
+  }
+  return popped_any;
+}
+
+void
+DecisionRecorder::writer_thread_fn()
+{
+  Entry entry;
+  while (true) {
+    // Read the flag before draining, so nothing recorded before the destructor was called is missed
+    bool running = m_running_flag.load();
+    // Not short-circuited: both rings are drained every time
+    bool popped_any = drain(m_ring, entry);
+    popped_any = drain(m_resent_ring, entry) || popped_any;
+    if (!m_buffer.empty()) {
+      flush();
+    }
+    if (!running) {
+      break;
+    }
+    if (!popped_any) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,121 @@
+/**
+ * @file EmpiricalDistribution.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/EmpiricalDistribution.hpp"
+#include "trigemu/Issues.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+namespace {
+std::vector<double>
+weights_of(const std::vector<EmpiricalDistribution::Bin>& bins)
+{
+  std::vector<double> weights;
+  for (auto const& bin : bins) {
+    weights.push_back(bin.weight);
+  }
+  return weights;
+}
+} // namespace
+
+AliasSampler::AliasSampler(const std::vector<double>& weights)
+  : m_probability(weights.size(), 1.)
+  , m_alias(weights.size())
+{
+  double total = std::accumulate(weights.begin(), weights.end(), 0.);
+  const size_t n = weights.size();
+
+  // Scale the weights so that they average 1, and split the columns
+  // into those short of 1 and those over it. Each short column is then
+  // topped up from an over-full one, which may become short itself
+  std::vector<double> scaled(n);
+  std::vector<size_t> small;
+  std::vector<size_t> large;
+  for (size_t i = 0; i < n; ++i) {
+    m_alias[i] = i;
+    scaled[i] = weights[i] * n / total;
+    (scaled[i] < 1. ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    size_t s = small.back();
+    small.pop_back();
+    size_t l = large.back();
+    m_probability[s] = scaled[s];
+    m_alias[s] = l;
+    scaled[l] -= 1. - scaled[s];
+    if (scaled[l] < 1.) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // Whatever's left is 1 but for rounding
+}
+
+EmpiricalDistribution::EmpiricalDistribution(std::vector<Bin> bins)
+  : m_bins(std::move(bins))
+  , m_sampler(weights_of(m_bins))
+{}
+
+std::map<dfmessages::trigger_type_t, TriggerTypeDistributions>
+load_distribution_file(const std::string& path)
+{
+  std::ifstream file(path);
+  if (!file) {
+    throw DistributionFileError(ERS_HERE, path, "can't open it");
+  }
+
+  std::map<std::pair<dfmessages::trigger_type_t, std::string>, std::vector<EmpiricalDistribution::Bin>> bins;
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); ++line_number) {
+    auto first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    unsigned trigger_type = 0;
+    std::string quantity;
+    EmpiricalDistribution::Bin bin{};
+    std::string rest;
+    if (!(fields >> trigger_type >> quantity >> bin.low >> bin.high >> bin.weight) || (fields >> rest) ||
+        (quantity != "window_ticks" && quantity != "link_count") || bin.low > bin.high || bin.low < 0 ||
+        !(bin.weight >= 0) || trigger_type > 0xffff) {
+      throw DistributionFileError(ERS_HERE, path, "line " + std::to_string(line_number) + " is malformed");
+    }
+    bins[{ static_cast<dfmessages::trigger_type_t>(trigger_type), quantity }].push_back(bin);
+  }
+  if (file.bad()) {
+    throw DistributionFileError(ERS_HERE, path, "error reading it");
+  }
+
+  std::map<dfmessages::trigger_type_t, TriggerTypeDistributions> distributions;
+  for (auto& [key, histogram] : bins) {
+    bool any_weight = std::any_of(histogram.begin(), histogram.end(), [](auto const& b) { return b.weight > 0; });
+    if (!any_weight) {
+      throw DistributionFileError(ERS_HERE,
+                                  path,
+                                  "the " + key.second + " histogram of trigger type " + std::to_string(key.first) +
+                                    " has no weight");
+    }
+    auto distribution = std::make_shared<const EmpiricalDistribution>(std::move(histogram));
+    auto& for_type = distributions[key.first];
+    (key.second == "window_ticks" ? for_type.window_ticks : for_type.link_count) = std::move(distribution);
+  }
+  return distributions;
+}
+
+} // namespace dunedaq::trigemu
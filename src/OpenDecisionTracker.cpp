@@ -0,0 +1,248 @@
+/**
+ * @file OpenDecisionTracker.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/OpenDecisionTracker.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+namespace {
+// How many closed or reclaimed trigger numbers we remember, in case more of their tokens turn up
+constexpr size_t s_max_late_token_numbers = 65536;
+} // namespace
+
+void
+OpenDecisionTracker::configure(std::chrono::milliseconds timeout,
+                               size_t journal_capacity,
+                               std::chrono::milliseconds resolution)
+{
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_timeout = timeout;
+    m_resolution = std::max(resolution, std::chrono::milliseconds(1));
+    m_journal_capacity = journal_capacity;
+    m_wheel.clear();
+    if (m_timeout.count() > 0) {
+      // Every armed deadline is less than one turn of the wheel ahead
+      m_wheel.resize(m_timeout / m_resolution + 2);
+    }
+  }
+  clear();
+}
+
+void
+OpenDecisionTracker::clear()
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_open.clear();
+  m_journaled = 0;
+  m_peak_size = 0;
+  for (auto& bucket : m_wheel) {
+    bucket.clear();
+  }
+  m_last_tick = -1;
+  m_late_tokens.clear();
+  m_late_token_order.clear();
+}
+
+void
+OpenDecisionTracker::arm(dfmessages::trigger_number_t trigger_number, Entry& entry, time_point now)
+{
+  if (m_wheel.empty()) {
+    entry.deadline_tick = -1;
+    return;
+  }
+  // Round up, so nothing expires early
+  entry.deadline_tick = tick_of(now + m_timeout) + 1;
+  m_wheel[entry.deadline_tick % m_wheel.size()].push_back(trigger_number);
+}
+
+void
+OpenDecisionTracker::open(const dfmessages::TriggerDecision& decision, time_point now)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto [it, inserted] = m_open.try_emplace(decision.trigger_number, Entry{ now, -1, 0, false, {} });
+  if (!inserted) {
+    return;
+  }
+  m_peak_size = std::max(m_peak_size, m_open.size());
+  if (m_journaled < m_journal_capacity) {
+    it->second.journaled = true;
+    it->second.decision = decision;
+    ++m_journaled;
+  }
+  arm(decision.trigger_number, it->second, now);
+}
+
+bool
+OpenDecisionTracker::close(dfmessages::trigger_number_t trigger_number)
+{
+  Clock::duration open_for;
+  return close(trigger_number, time_point(), open_for);
+}
+
+bool
+OpenDecisionTracker::close(dfmessages::trigger_number_t trigger_number, time_point now, Clock::duration& open_for)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_open.find(trigger_number);
+  if (it == m_open.end()) {
+    return false;
+  }
+  open_for = now - it->second.opened;
+  if (it->second.journaled) {
+    --m_journaled;
+  }
+  // The copies that were sent again will each send a token back too
+  if (it->second.resends > 0) {
+    expect_late_tokens(trigger_number, it->second.resends);
+  }
+  // Its entry in the wheel is skipped when its bucket comes round
+  m_open.erase(it);
+  return true;
+}
+
+void
+OpenDecisionTracker::collect_expired(time_point now, std::vector<Expired>& expired)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_wheel.empty()) {
+    return;
+  }
+  const int64_t size = static_cast<int64_t>(m_wheel.size());
+  const int64_t now_tick = tick_of(now);
+  // After a long gap, one turn of the wheel covers everything
+  int64_t first_tick = std::max(m_last_tick + 1, now_tick - size + 1);
+
+  std::vector<dfmessages::trigger_number_t> later;
+  for (int64_t tick = first_tick; tick <= now_tick; ++tick) {
+    auto& bucket = m_wheel[tick % size];
+    later.clear();
+    for (auto trigger_number : bucket) {
+      auto it = m_open.find(trigger_number);
+      // Closed, rearmed or disarmed since it was put here
+      if (it == m_open.end() || it->second.deadline_tick < 0 || it->second.deadline_tick % size != tick % size) {
+        continue;
+      }
+      if (it->second.deadline_tick > now_tick) {
+        // Due on a later turn of the wheel
+        later.push_back(trigger_number);
+        continue;
+      }
+      auto& entry = it->second;
+      entry.deadline_tick = -1;
+      expired.push_back(Expired{ trigger_number,
+                                 std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.opened),
+                                 entry.resends,
+                                 entry.journaled,
+                                 entry.journaled ? entry.decision : dfmessages::TriggerDecision() });
+    }
+    bucket.swap(later);
+  }
+  m_last_tick = now_tick;
+}
+
+void
+OpenDecisionTracker::rearm(dfmessages::trigger_number_t trigger_number, time_point now)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_open.find(trigger_number);
+  if (it != m_open.end()) {
+    ++it->second.resends;
+    arm(trigger_number, it->second, now);
+  }
+}
+
+void
+OpenDecisionTracker::reclaim(dfmessages::trigger_number_t trigger_number)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_open.find(trigger_number);
+  if (it == m_open.end()) {
+    return;
+  }
+  if (it->second.journaled) {
+    --m_journaled;
+  }
+  // Its token has been given back, so none of its copies' tokens should be
+  expect_late_tokens(trigger_number, it->second.resends + 1);
+  m_open.erase(it);
+}
+
+void
+OpenDecisionTracker::expect_late_tokens(dfmessages::trigger_number_t trigger_number, int count)
+{
+  if (m_late_tokens.emplace(trigger_number, count).second) {
+    m_late_token_order.push_back(trigger_number);
+    if (m_late_token_order.size() > s_max_late_token_numbers) {
+      m_late_tokens.erase(m_late_token_order.front());
+      m_late_token_order.pop_front();
+    }
+  }
+}
+
+bool
+OpenDecisionTracker::take_late_token(dfmessages::trigger_number_t trigger_number)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  auto it = m_late_tokens.find(trigger_number);
+  if (it == m_late_tokens.end()) {
+    return false;
+  }
+  // The number stays in m_late_token_order, and drops out of it in turn
+  if (--it->second == 0) {
+    m_late_tokens.erase(it);
+  }
+  return true;
+}
+
+size_t
+OpenDecisionTracker::size() const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_open.size();
+}
+
+size_t
+OpenDecisionTracker::peak_size() const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_peak_size;
+}
+
+std::chrono::milliseconds
+OpenDecisionTracker::oldest_age(time_point now) const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_open.empty()) {
+    return std::chrono::milliseconds(0);
+  }
+  auto oldest = std::min_element(m_open.begin(), m_open.end(), [](auto const& a, auto const& b) {
+    return a.second.opened < b.second.opened;
+  });
+  return std::chrono::duration_cast<std::chrono::milliseconds>(now - oldest->second.opened);
+}
+
+std::vector<dfmessages::trigger_number_t>
+OpenDecisionTracker::open_trigger_numbers() const
+{
+  std::vector<dfmessages::trigger_number_t> numbers;
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    numbers.reserve(m_open.size());
+    for (auto const& [trigger_number, entry] : m_open) {
+      numbers.push_back(trigger_number);
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+  return numbers;
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,146 @@
+/**
+ * @file RateSchedule.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/RateSchedule.hpp"
+#include "trigemu/Issues.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+std::vector<RateStep>
+make_rate_steps(const RateScheduleParams& params)
+{
+  if (params.model == "none") {
+    return {};
+  }
+  if (params.model == "staircase") {
+    if (params.steps.empty()) {
+      throw InvalidRateSchedule(ERS_HERE, params.model, "there must be at least one step");
+    }
+    for (auto const& step : params.steps) {
+      if (!(step.rate_hz > 0) || step.duration.count() <= 0) {
+        throw InvalidRateSchedule(ERS_HERE, params.model, "the rates and durations must be positive");
+      }
+    }
+    return params.steps;
+  }
+  if (params.model == "linear" || params.model == "exponential") {
+    if (!(params.start_rate_hz > 0) || !(params.end_rate_hz > 0) || params.step_count == 0 ||
+        params.step_duration.count() <= 0) {
+      throw InvalidRateSchedule(
+        ERS_HERE, params.model, "the start and end rates, step count and step duration must be positive");
+    }
+    std::vector<RateStep> steps;
+    for (size_t i = 0; i < params.step_count; ++i) {
+      double f = params.step_count > 1 ? static_cast<double>(i) / (params.step_count - 1) : 0.;
+      double rate_hz = params.model == "linear"
+                         ? params.start_rate_hz + (params.end_rate_hz - params.start_rate_hz) * f
+                         : params.start_rate_hz * std::pow(params.end_rate_hz / params.start_rate_hz, f);
+      steps.push_back(RateStep{ rate_hz, params.step_duration });
+    }
+    return steps;
+  }
+  throw InvalidRateSchedule(ERS_HERE, params.model, "unknown model");
+}
+
+RateSchedule::RateSchedule(std::vector<RateStep> steps,
+                           uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+                           dfmessages::timestamp_t reference_interval_ticks,
+                           double reference_rate_hz,
+                           double saturation_tolerance)
+  : m_steps(std::move(steps))
+  , m_clock_frequency_hz(clock_frequency_hz)
+  , m_reference_interval_ticks(reference_interval_ticks)
+  , m_reference_rate_hz(reference_rate_hz)
+  , m_saturation_tolerance(saturation_tolerance)
+{}
+
+void
+RateSchedule::start(dfmessages::timestamp_t first)
+{
+  m_step_starts.clear();
+  m_step_starts.push_back(first);
+  for (auto const& step : m_steps) {
+    m_step_starts.push_back(m_step_starts.back() + step.duration.count() * m_clock_frequency_hz / 1000);
+  }
+  begin_step(0);
+}
+
+size_t
+RateSchedule::step_at(dfmessages::timestamp_t timestamp) const
+{
+  // The first start after the timestamp is one past its step
+  auto it = std::upper_bound(m_step_starts.begin(), m_step_starts.end(), timestamp);
+  return it == m_step_starts.begin() ? 0 : std::min<size_t>(it - m_step_starts.begin() - 1, m_steps.size());
+}
+
+dfmessages::timestamp_t
+RateSchedule::get_interval_ticks(size_t step) const
+{
+  // The streams' intervals scale with the trigger interval, and their rates inversely
+  return std::max<dfmessages::timestamp_t>(
+    1, std::llround(m_reference_interval_ticks * m_reference_rate_hz / m_steps[step].rate_hz));
+}
+
+void
+RateSchedule::begin_step(size_t step)
+{
+  m_step = step;
+  m_sent = 0;
+  m_skipped = 0;
+  m_lateness_count = 0;
+  m_lateness_max_us = 0;
+  m_lateness_us_bins.fill(0);
+}
+
+void
+RateSchedule::count_sent(uint64_t lateness_us) // NOLINT(build/unsigned)
+{
+  ++m_sent;
+  ++m_lateness_us_bins[statuspage::lateness_bin(lateness_us)];
+  ++m_lateness_count;
+  m_lateness_max_us = std::max(m_lateness_max_us, lateness_us);
+}
+
+RateStepReport
+RateSchedule::end_step(dfmessages::timestamp_t end,
+                       double inhibited_fraction,
+                       uint64_t token_starved_us) // NOLINT(build/unsigned)
+{
+  RateStepReport report{};
+  report.step = m_step;
+  report.requested_rate_hz = m_steps[m_step].rate_hz;
+  // A step cut short by the end of the run counts up to where it got to
+  auto begin = m_step_starts[m_step];
+  end = std::min(end, m_step_starts[m_step + 1]);
+  if (end > begin) {
+    report.achieved_rate_hz = m_sent * static_cast<double>(m_clock_frequency_hz) / (end - begin);
+  }
+  report.triggers = m_sent;
+  report.skipped = m_skipped;
+  report.inhibited_fraction = inhibited_fraction;
+  report.token_starved_us = token_starved_us;
+  auto percentile = [&](double q) {
+    return statuspage::lateness_percentile_us(
+      m_lateness_us_bins.data(), m_lateness_count, m_lateness_max_us, q);
+  };
+  report.lateness_p50_us = percentile(0.5);
+  report.lateness_p90_us = percentile(0.9);
+  report.lateness_p99_us = percentile(0.99);
+  report.lateness_max_us = m_lateness_max_us;
+  report.saturated = m_skipped > m_saturation_tolerance * (m_sent + m_skipped) ||
+                     inhibited_fraction > m_saturation_tolerance;
+  return report;
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,141 @@
+/**
+ * @file RegionInhibits.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/RegionInhibits.hpp"
+#include "trigemu/Issues.hpp"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+RegionInhibitPolicy
+parse_region_inhibit_policy(const std::string& name)
+{
+  if (name == "mask") {
+    return RegionInhibitPolicy::kMask;
+  }
+  if (name == "stream") {
+    return RegionInhibitPolicy::kStream;
+  }
+  throw InvalidRegionInhibitPolicy(ERS_HERE, name);
+}
+
+void
+RegionInhibits::configure(RegionInhibitPolicy policy, std::vector<std::unique_ptr<Region>> regions)
+{
+  if (regions.size() > s_max_regions) {
+    throw InvalidInhibitRegion(
+      ERS_HERE, regions[s_max_regions]->name, "there can be at most " + std::to_string(s_max_regions) + " regions");
+  }
+  std::set<std::string> names;
+  std::unordered_map<uint32_t, uint64_t> link_regions; // NOLINT(build/unsigned)
+  for (size_t i = 0; i < regions.size(); ++i) {
+    if (!names.insert(regions[i]->name).second) {
+      throw InvalidInhibitRegion(ERS_HERE, regions[i]->name, "the name is used more than once");
+    }
+    for (auto link : regions[i]->links) {
+      link_regions[link] |= uint64_t{ 1 } << i; // NOLINT(build/unsigned)
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(m_regions_mutex);
+  m_policy = policy;
+  m_regions.swap(regions);
+  m_link_regions.swap(link_regions);
+  m_busy_regions.store(0);
+}
+
+void
+RegionInhibits::reset()
+{
+  m_busy_regions.store(0);
+  for (auto& region : m_regions) {
+    region->busy_time.reset();
+    region->busy.store(false);
+    region->masked_components.store(0);
+    region->suppressed.store(0);
+  }
+}
+
+void
+RegionInhibits::end_run(uint64_t now_us) // NOLINT(build/unsigned)
+{
+  for (auto& region : m_regions) {
+    region->busy_time.set(false, now_us);
+  }
+}
+
+void
+RegionInhibits::set_busy(size_t region, bool busy, uint64_t now_us) // NOLINT(build/unsigned)
+{
+  const uint64_t bit = uint64_t{ 1 } << region; // NOLINT(build/unsigned)
+  if (busy) {
+    m_busy_regions.fetch_or(bit);
+  } else {
+    m_busy_regions.fetch_and(~bit);
+  }
+  m_regions[region]->busy.store(busy);
+  m_regions[region]->busy_time.set(busy, now_us);
+}
+
+uint64_t // NOLINT(build/unsigned)
+RegionInhibits::regions_of(const dfmessages::GeoID& link) const
+{
+  auto it = m_link_regions.find(link.element_id);
+  return it != m_link_regions.end() ? it->second : 0;
+}
+
+uint64_t // NOLINT(build/unsigned)
+RegionInhibits::regions_of(const std::vector<dfmessages::GeoID>& links) const
+{
+  uint64_t regions = 0; // NOLINT(build/unsigned)
+  for (auto const& link : links) {
+    regions |= regions_of(link);
+  }
+  return regions;
+}
+
+uint64_t // NOLINT(build/unsigned)
+RegionInhibits::regions_of(const dfmessages::TriggerDecision& decision) const
+{
+  uint64_t regions = 0; // NOLINT(build/unsigned)
+  for (auto const& request : decision.components) {
+    regions |= regions_of(request.component);
+  }
+  return regions;
+}
+
+size_t
+RegionInhibits::mask(dfmessages::TriggerDecision& decision, uint64_t busy) // NOLINT(build/unsigned)
+{
+  auto& components = decision.components;
+  auto kept = std::remove_if(components.begin(), components.end(), [&](const dfmessages::ComponentRequest& request) {
+    const uint64_t regions = regions_of(request.component) & busy; // NOLINT(build/unsigned)
+    for (uint64_t r = regions; r != 0; r &= r - 1) {               // NOLINT(build/unsigned)
+      ++m_regions[__builtin_ctzll(r)]->masked_components;
+    }
+    return regions != 0;
+  });
+  const size_t masked = components.end() - kept;
+  components.erase(kept, components.end());
+  return masked;
+}
+
+void
+RegionInhibits::count_suppressed(uint64_t regions) // NOLINT(build/unsigned)
+{
+  for (; regions != 0; regions &= regions - 1) {
+    ++m_regions[__builtin_ctzll(regions)]->suppressed;
+  }
+}
+
+} // namespace dunedaq::trigemu
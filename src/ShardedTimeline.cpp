@@ -0,0 +1,77 @@
+/**
+ * @file ShardedTimeline.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ShardedTimeline.hpp"
+
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+ShardedTimeline::ShardedTimeline(uint64_t shard_count, // NOLINT(build/unsigned)
+                                 uint64_t shard_index, // NOLINT(build/unsigned)
+                                 dfmessages::timestamp_t epoch_ticks,
+                                 int repeat_count)
+  : m_shard_count(shard_count)
+  , m_shard_index(shard_index)
+  , m_epoch_ticks(epoch_ticks)
+  , m_repeat_count(repeat_count)
+{}
+
+dfmessages::timestamp_t
+ShardedTimeline::origin(dfmessages::timestamp_t estimate) const
+{
+  return is_sharded() ? estimate / m_epoch_ticks * m_epoch_ticks : estimate;
+}
+
+dfmessages::timestamp_t
+ShardedTimeline::next_epoch(dfmessages::timestamp_t timestamp) const
+{
+  return is_sharded() ? (timestamp / m_epoch_ticks + 1) * m_epoch_ticks : timestamp;
+}
+
+uint64_t // NOLINT(build/unsigned)
+ShardedTimeline::next_owned_slot(uint64_t slot) const // NOLINT(build/unsigned)
+{
+  return slot + (m_shard_count - slot % m_shard_count + m_shard_index) % m_shard_count;
+}
+
+uint64_t // NOLINT(build/unsigned)
+ShardedTimeline::stop_burst_slot(int i) const
+{
+  return next_owned_slot(m_slot) + i * m_shard_count;
+}
+
+dfmessages::trigger_number_t
+ShardedTimeline::trigger_number(uint64_t slot, // NOLINT(build/unsigned)
+                                dfmessages::trigger_number_t last_sent) const
+{
+  return is_sharded() ? slot * m_repeat_count + 1 : last_sent + 1;
+}
+
+void
+ShardedTimeline::set_intervals(const std::vector<dfmessages::timestamp_t>& intervals_ticks, bool at_once)
+{
+  m_pending_intervals = intervals_ticks;
+  // The instances pick the change up at different slots, but agree on the next epoch
+  m_change_at = at_once ? 0 : next_epoch(front_timestamp());
+}
+
+void
+ShardedTimeline::advance()
+{
+  if (!m_pending_intervals.empty() && front_timestamp() >= m_change_at) {
+    for (size_t i = 0; i < m_pending_intervals.size(); ++i) {
+      m_merger.set_interval(i, m_pending_intervals[i]);
+    }
+    m_pending_intervals.clear();
+  }
+  m_merger.pop();
+  ++m_slot;
+}
+
+} // namespace dunedaq::trigemu
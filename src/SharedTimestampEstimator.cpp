@@ -0,0 +1,67 @@
+/**
+ * @file SharedTimestampEstimator.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/SharedTimestampEstimator.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace dunedaq::trigemu {
+
+namespace {
+// The estimator, with the receiver it reads from, which it only holds by reference
+struct Entry
+{
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> time_sync_source;
+  std::unique_ptr<TimestampEstimator> estimator; // Destroyed first, so its thread stops before the receiver goes
+};
+
+// Estimators that are shared must agree on all of these. make_clock()
+// gives every module of the process the same clock of each kind
+using Key = std::tuple<std::string, dfmessages::run_number_t, uint64_t, const Clock*>; // NOLINT(build/unsigned)
+
+std::mutex g_mutex;
+std::map<Key, std::weak_ptr<Entry>> g_entries;
+} // namespace
+
+std::shared_ptr<TimestampEstimator>
+acquire_shared_timestamp_estimator(const std::string& connection_uid,
+                                   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> time_sync_source,
+                                   uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+                                   dfmessages::run_number_t run_number,
+                                   std::shared_ptr<Clock> clock)
+{
+  Key key{ connection_uid, run_number, clock_frequency_hz, clock.get() };
+  std::lock_guard<std::mutex> lk(g_mutex);
+
+  // Forget the estimators that have been let go of
+  for (auto it = g_entries.begin(); it != g_entries.end();) {
+    it = it->second.expired() ? g_entries.erase(it) : std::next(it);
+  }
+
+  if (auto entry = g_entries[key].lock()) {
+    TLOG_DEBUG(0) << "Sharing the timestamp estimator for " << connection_uid << " in run " << run_number;
+    return std::shared_ptr<TimestampEstimator>(entry, entry->estimator.get());
+  }
+
+  auto entry = std::make_shared<Entry>();
+  entry->time_sync_source = std::move(time_sync_source);
+  entry->estimator = std::make_unique<TimestampEstimator>(
+    entry->time_sync_source, clock_frequency_hz, run_number, std::move(clock), nullptr, nullptr, "ts-est/" + connection_uid);
+  g_entries[key] = entry;
+  TLOG_DEBUG(0) << "Started a shared timestamp estimator for " << connection_uid << " in run " << run_number;
+  return std::shared_ptr<TimestampEstimator>(entry, entry->estimator.get());
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,181 @@
+/**
+ * @file StatusPage.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/StatusPage.hpp"
+#include "trigemu/Issues.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace dunedaq::trigemu {
+
+namespace statuspage {
+
+size_t
+lateness_bin(uint64_t lateness_us) // NOLINT(build/unsigned)
+{
+  if (lateness_us < 4) {
+    return lateness_us;
+  }
+  int msb = 63 - __builtin_clzll(lateness_us);
+  size_t sub = (lateness_us >> (msb - 2)) & 3;
+  return std::min(static_cast<size_t>(msb - 1) * 4 + sub, s_lateness_bins - 1);
+}
+
+uint64_t // NOLINT(build/unsigned)
+lateness_bin_upper_us(size_t bin)
+{
+  if (bin < 4) {
+    return bin;
+  }
+  int msb = static_cast<int>(bin / 4) + 1;
+  uint64_t sub = bin % 4;                                        // NOLINT(build/unsigned)
+  return ((4 + sub + 1) << (msb - 2)) - 1;
+}
+
+uint64_t // NOLINT(build/unsigned)
+lateness_percentile_us(const Status& status, double q)
+{
+  return lateness_percentile_us(status.lateness_us_bins, status.lateness_count, status.lateness_max_us, q);
+}
+
+uint64_t                                                                                // NOLINT(build/unsigned)
+lateness_percentile_us(const uint64_t* bins, uint64_t count, uint64_t max_us, double q) // NOLINT(build/unsigned)
+{
+  if (count == 0) {
+    return 0;
+  }
+  auto target = static_cast<uint64_t>(q * count); // NOLINT(build/unsigned)
+  uint64_t seen = 0;                               // NOLINT(build/unsigned)
+  for (size_t bin = 0; bin < s_lateness_bins; ++bin) {
+    seen += bins[bin];
+    if (seen > target) {
+      return std::min(lateness_bin_upper_us(bin), max_us);
+    }
+  }
+  return max_us;
+}
+
+} // namespace statuspage
+
+namespace {
+// Whether the segment `name` is a status page whose writer has gone without removing it
+bool
+left_behind(const std::string& name)
+{
+  int fd = ::shm_open(name.c_str(), O_RDONLY, 0); // NOLINT
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st = {};
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(statuspage::Page)) {
+    ::close(fd);
+    return false;
+  }
+  void* address = ::mmap(nullptr, sizeof(statuspage::Page), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  auto page = static_cast<const statuspage::Page*>(address);
+  bool gone = page->magic == statuspage::s_magic && page->version == statuspage::s_version && page->writer_pid > 0 &&
+              ::kill(static_cast<pid_t>(page->writer_pid), 0) != 0 && errno == ESRCH;
+  ::munmap(address, sizeof(statuspage::Page));
+  return gone;
+}
+} // namespace
+
+StatusPageWriter::StatusPageWriter(const std::string& name)
+  : m_name(name)
+{
+  // Exclusively, so that a second writer can't take over the page of one that is still running
+  int fd = ::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644); // NOLINT
+  if (fd < 0 && errno == EEXIST && left_behind(m_name)) {
+    ::shm_unlink(m_name.c_str());
+    fd = ::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644); // NOLINT
+  }
+  if (fd < 0) {
+    throw StatusPageError(ERS_HERE, m_name, errno == EEXIST ? "the name is already in use" : std::strerror(errno));
+  }
+  if (::ftruncate(fd, sizeof(statuspage::Page)) != 0) {
+    int err = errno;
+    ::close(fd);
+    ::shm_unlink(m_name.c_str());
+    throw StatusPageError(ERS_HERE, m_name, std::strerror(err));
+  }
+  void* address = ::mmap(nullptr, sizeof(statuspage::Page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    ::shm_unlink(m_name.c_str());
+    throw StatusPageError(ERS_HERE, m_name, std::strerror(err));
+  }
+
+  // Readers check the magic number last, so they don't see a half-made page
+  m_page = new (address) statuspage::Page{};
+  m_page->version = statuspage::s_version;
+  m_page->status_bytes = sizeof(statuspage::Status);
+  m_page->writer_pid = ::getpid();
+  std::atomic_thread_fence(std::memory_order_release);
+  m_page->magic = statuspage::s_magic;
+}
+
+StatusPageWriter::~StatusPageWriter()
+{
+  ::munmap(m_page, sizeof(statuspage::Page));
+  ::shm_unlink(m_name.c_str());
+}
+
+void
+StatusPageWriter::publish(const statuspage::Status& status)
+{
+  m_page->status.store(status);
+}
+
+StatusPageReader::StatusPageReader(const std::string& name)
+  : m_name(name)
+{
+  int fd = ::shm_open(m_name.c_str(), O_RDONLY, 0); // NOLINT
+  if (fd < 0) {
+    throw StatusPageError(ERS_HERE, m_name, std::strerror(errno));
+  }
+  void* address = ::mmap(nullptr, sizeof(statuspage::Page), PROT_READ, MAP_SHARED, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    throw StatusPageError(ERS_HERE, m_name, std::strerror(err));
+  }
+  m_page = static_cast<const statuspage::Page*>(address);
+  if (m_page->magic != statuspage::s_magic || m_page->version != statuspage::s_version ||
+      m_page->status_bytes != sizeof(statuspage::Status)) {
+    ::munmap(const_cast<statuspage::Page*>(m_page), sizeof(statuspage::Page)); // NOLINT
+    throw StatusPageError(ERS_HERE, m_name, "not a status page of version " + std::to_string(statuspage::s_version));
+  }
+}
+
+StatusPageReader::~StatusPageReader()
+{
+  ::munmap(const_cast<statuspage::Page*>(m_page), sizeof(statuspage::Page)); // NOLINT
+}
+
+bool
+StatusPageReader::read(statuspage::Status& status, int max_attempts) const
+{
+  return m_page->status.try_load(status, max_attempts);
+}
+
+} // namespace dunedaq::trigemu
@@ -0,0 +1,110 @@
+/**
+ * @file TimeSyncFile.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/TimeSyncFile.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#define TRACE_NAME "TimeSyncFile" // NOLINT
+
+namespace dunedaq::trigemu {
+
+TimeSyncRecorder::TimeSyncRecorder(const std::string& prefix,
+                                   dfmessages::run_number_t run_number,
+                                   uint64_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  std::ostringstream name;
+  name << prefix << "_run" << std::setw(6) << std::setfill('0') << run_number << ".tdets";
+  m_path = name.str();
+
+  m_file = std::fopen(m_path.c_str(), "wb");
+  if (m_file == nullptr) {
+    throw TimeSyncFileError(ERS_HERE, m_path, std::strerror(errno));
+  }
+  auto header = timesyncfile::make_file_header(clock_frequency_hz, run_number);
+  if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+    int err = errno;
+    std::fclose(m_file);
+    m_file = nullptr;
+    throw TimeSyncFileError(ERS_HERE, m_path, std::strerror(err));
+  }
+  TLOG_DEBUG(1) << "Recording TimeSyncs to " << m_path;
+}
+
+void
+TimeSyncRecorder::record(const dfmessages::TimeSync& time_sync, uint64_t arrival_us) // NOLINT(build/unsigned)
+{
+  if (m_file == nullptr || m_write_failed) {
+    return;
+  }
+  timesyncfile::Record record{ time_sync.daq_time,        time_sync.system_time, arrival_us,
+                               time_sync.sequence_number, time_sync.run_number,  time_sync.source_pid };
+  bool ok = std::fwrite(&record, sizeof(record), 1, m_file) == 1;
+  if (ok && ++m_recorded_count % s_flush_interval == 0) {
+    ok = std::fflush(m_file) == 0;
+  }
+  if (!ok) {
+    // Don't report every TimeSync of the run
+    m_write_failed = true;
+    ers::error(TimeSyncFileError(ERS_HERE, m_path, std::strerror(errno)));
+  }
+}
+
+void
+TimeSyncRecorder::close()
+{
+  if (m_file == nullptr) {
+    return;
+  }
+  if (std::fclose(m_file) != 0 && !m_write_failed) {
+    ers::error(TimeSyncFileError(ERS_HERE, m_path, std::strerror(errno)));
+  }
+  m_file = nullptr;
+  TLOG_DEBUG(1) << "Recorded " << m_recorded_count << " TimeSyncs to " << m_path;
+}
+
+TimeSyncTrace
+read_time_sync_file(const std::string& path)
+{
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    throw TimeSyncFileError(ERS_HERE, path, std::strerror(errno));
+  }
+
+  TimeSyncTrace trace;
+  if (std::fread(&trace.header, sizeof(trace.header), 1, file) != 1 ||
+      !timesyncfile::is_valid_header(trace.header) ||
+      std::fseek(file, trace.header.header_size, SEEK_SET) != 0) {
+    std::fclose(file);
+    throw TimeSyncFileError(ERS_HERE, path, "not a TimeSync file, or unsupported version");
+  }
+
+  // A partial record at the end is one that was still being written
+  timesyncfile::Record record;
+  while (std::fread(&record, sizeof(record), 1, file) == 1) {
+    trace.records.push_back(record);
+  }
+  bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (failed) {
+    throw TimeSyncFileError(ERS_HERE, path, "read error");
+  }
+  if (trace.records.empty()) {
+    throw TimeSyncFileError(ERS_HERE, path, "contains no TimeSyncs");
+  }
+  return trace;
+}
+
+} // namespace dunedaq::trigemu
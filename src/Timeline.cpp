@@ -0,0 +1,201 @@
+/**
+ * @file Timeline.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Timeline.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigemu {
+
+namespace {
+size_t
+round_up_to_power_of_two(size_t n)
+{
+  size_t result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Name, phase and scope of each event type in the trace-event format:
+// "b"/"n"/"e" are the begin, instant and end of an async slice, with
+// the trigger number as its id, and "i" is an instant on the thread
+struct EventFormat
+{
+  const char* name;
+  const char* phase;
+  const char* arg_name;
+};
+
+EventFormat
+format_of(TimelineEvent type)
+{
+  switch (type) {
+    case TimelineEvent::kScheduled:
+      return { "scheduled", "i", "trigger_timestamp" };
+    case TimelineEvent::kCreated:
+      return { "decision", "b", "trigger_timestamp" };
+    case TimelineEvent::kSent:
+      return { "sent", "n", nullptr };
+    case TimelineEvent::kNotSent:
+      return { "decision", "e", nullptr };
+    case TimelineEvent::kSkipped:
+      return { "skipped", "i", "reason" };
+    case TimelineEvent::kRetired:
+      return { "decision", "e", nullptr };
+    case TimelineEvent::kStale:
+      return { "stale", "n", nullptr };
+    case TimelineEvent::kInhibit:
+      return { "inhibit", "i", "busy" };
+    case TimelineEvent::kTimeSync:
+      return { "timesync", "i", "daq_time" };
+    case TimelineEvent::kTimeSyncSent:
+      return { "timesync_sent", "i", "daq_time" };
+    case TimelineEvent::kInhibitSent:
+      return { "inhibit_sent", "i", "busy" };
+    case TimelineEvent::kTokenSent:
+    default:
+      return { "token_sent", "i", nullptr };
+  }
+}
+} // namespace
+
+TimelineBuffer::TimelineBuffer(const std::string& thread_name, size_t capacity, std::shared_ptr<Clock> clock)
+  : m_thread_name(thread_name)
+  , m_clock(std::move(clock))
+  , m_events(round_up_to_power_of_two(capacity))
+  , m_mask(m_events.size() - 1)
+{}
+
+std::vector<TimelineBuffer::Event>
+TimelineBuffer::get_events() const
+{
+  std::vector<Event> events;
+  uint64_t first = get_overwritten_count(); // NOLINT(build/unsigned)
+  events.reserve(m_next - first);
+  for (uint64_t i = first; i < m_next; ++i) { // NOLINT(build/unsigned)
+    events.push_back(m_events[i & m_mask]);
+  }
+  return events;
+}
+
+uint64_t // NOLINT(build/unsigned)
+TimelineBuffer::get_overwritten_count() const
+{
+  return m_next > m_events.size() ? m_next - m_events.size() : 0;
+}
+
+void
+Timeline::reset(size_t capacity, std::shared_ptr<Clock> clock)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_capacity = capacity;
+  m_clock = std::move(clock);
+  m_buffers.clear();
+}
+
+TimelineBuffer*
+Timeline::add_thread(const std::string& thread_name)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_buffers.push_back(std::make_unique<TimelineBuffer>(thread_name, m_capacity, m_clock));
+  return m_buffers.back().get();
+}
+
+void
+Timeline::write(const std::string& path) const
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    throw RecordingError(ERS_HERE, path, std::strerror(errno));
+  }
+
+  // Times are in us since the epoch of the modules' clock, the wall
+  // clock unless they run on the virtual clock, so that timelines
+  // written by modules in the same run line up
+  const int pid = ::getpid();
+  std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  size_t n_events = 0;
+  for (size_t tid = 0; tid < m_buffers.size(); ++tid) {
+    auto const& buffer = *m_buffers[tid];
+    std::fprintf(file,
+                 "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                 first ? "" : ",\n",
+                 pid,
+                 tid,
+                 buffer.get_thread_name().c_str());
+    first = false;
+    if (buffer.get_overwritten_count() > 0) {
+      TLOG_DEBUG(1) << "The timeline of thread " << buffer.get_thread_name() << " lost its "
+                    << buffer.get_overwritten_count() << " oldest events";
+    }
+
+    for (auto const& event : buffer.get_events()) {
+      auto format = format_of(event.type);
+      std::fprintf(file,
+                   ",\n{\"ph\":\"%s\",\"name\":\"%s\",\"cat\":\"trigemu\",\"pid\":%d,\"tid\":%zu,\"ts\":%" PRId64
+                   ".%03d",
+                   format.phase,
+                   format.name,
+                   pid,
+                   tid,
+                   event.time_ns / 1000,
+                   static_cast<int>(event.time_ns % 1000));
+      if (format.phase[0] == 'i') {
+        std::fprintf(file, ",\"s\":\"t\"");
+      } else {
+        std::fprintf(file, ",\"id\":%" PRIu64, event.id);
+      }
+      if (format.arg_name != nullptr) {
+        std::fprintf(file, ",\"args\":{\"%s\":%" PRIu64 "}", format.arg_name, event.arg);
+      } else if (event.type == TimelineEvent::kNotSent) {
+        std::fprintf(file, ",\"args\":{\"not_sent\":1}");
+      }
+      std::fprintf(file, "}");
+      ++n_events;
+    }
+  }
+  std::fprintf(file, "\n]}\n");
+
+  bool failed = std::ferror(file) != 0;
+  failed = std::fclose(file) != 0 || failed;
+  if (failed) {
+    throw RecordingError(ERS_HERE, path, std::strerror(errno));
+  }
+  TLOG_DEBUG(0) << "Wrote " << n_events << " timeline events to " << path;
+}
+
+void
+Timeline::write_for_run(const std::string& prefix, dfmessages::run_number_t run_number) const
+{
+  std::ostringstream path;
+  path << prefix << "_run" << std::setw(6) << std::setfill('0') << run_number << ".json";
+  try {
+    write(path.str());
+  } catch (RecordingError& e) {
+    ers::warning(e);
+  }
+}
+
+} // namespace dunedaq::trigemu
@@ -11,7 +11,11 @@
 
 #include "logging/Logging.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <string>
+#include <utility>
 
 #define TRACE_NAME "TimestampEstimator" // NOLINT
 
@@ -19,10 +23,20 @@ namespace dunedaq::trigemu {
 
 TimestampEstimator::TimestampEstimator(
   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source,
-  uint64_t clock_frequency_hz) // NOLINT(build/unsigned)
+  uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+  dfmessages::run_number_t run_number,
+  std::shared_ptr<Clock> clock,
+  TimelineBuffer* timeline,
+  TimeSyncRecorder* recorder,
+  const std::string& thread_name)
   : m_running_flag(true)
+  , m_sleeper(std::move(clock))
   , m_clock_frequency_hz(clock_frequency_hz)
-  , m_estimator_thread(&TimestampEstimator::estimator_thread_fn, this, std::ref(time_sync_source))
+  , m_run_number(run_number)
+  , m_timeline(timeline)
+  , m_recorder(recorder)
+  , m_clock_participant(m_sleeper.get_clock(), 1)
+  , m_estimator_thread(&TimestampEstimator::estimator_thread_fn, this, std::ref(time_sync_source), thread_name)
 {
   pthread_setname_np(m_estimator_thread.native_handle(), "tde-ts-est");
 }
@@ -30,30 +44,26 @@ TimestampEstimator::TimestampEstimator(
 TimestampEstimator::~TimestampEstimator()
 {
   m_running_flag.store(false);
+  m_sleeper.interrupt();
   m_estimator_thread.join();
 }
 
 void
 TimestampEstimator::estimator_thread_fn(
-  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source)
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source,
+  const std::string& thread_name)
 {
-  // This loop is a hack to deal with the fact that there might be
-  // leftover TimeSync messages from the previous run, because
-  // TriggerDecisionEmulator is stopped before the readout modules
-  // that send the TimeSyncs. So we pop everything we can at
-  // startup. This will definitely get all of the TimeSyncs from the
-  // previous run. It *may* also get TimeSyncs from the current run,
-  // which we drop on the floor. This is fairly harmless: it'll just
-  // slightly delay us getting to the point where we actually start
-  // making the timestamp estimate
-  try {
-    while (true) {
-      dfmessages::TimeSync t{ dfmessages::TypeDefaults::s_invalid_timestamp };
-      t = time_sync_source->receive(std::chrono::milliseconds(1));
-    }
-  } catch (iomanager::TimeoutExpired&) {
-    // Nothing left in the queue
-  }
+  Clock::ThreadScope clock_scope(m_clock_participant, thread_name);
+
+  // There may be leftover TimeSync messages from the previous run on
+  // the queue, because TriggerDecisionEmulator is stopped before the
+  // readout modules that send the TimeSyncs. We used to drain the
+  // queue here, which could also throw away TimeSyncs from the current
+  // run and delayed the first estimate. Instead, TimeSyncs that are
+  // stamped with another run number are dropped as they arrive.
+  // Unstamped TimeSyncs (run number 0) are kept: an old TimeSync
+  // still gives a correct estimate when extrapolated from its
+  // system_time, and a newer one replaces it as soon as it arrives
 
   dfmessages::TimeSync most_recent_timesync{ dfmessages::TypeDefaults::s_invalid_timestamp };
   m_current_timestamp_estimate.store(dfmessages::TypeDefaults::s_invalid_timestamp);
@@ -66,13 +76,32 @@ TimestampEstimator::estimator_thread_fn(
   while (m_running_flag.load()) {
     // First, update the latest timestamp
     try {
-      auto t = time_sync_source->receive(std::chrono::milliseconds(1));
+      // Without waiting: we wait on the clock instead
+      auto t = time_sync_source->receive(iomanager::Receiver::s_no_block);
+      if (m_recorder) {
+        // Everything that arrives, so a replay sees what we saw
+        m_recorder->record(t, m_sleeper.get_clock()->now_us());
+      }
+      if (t.run_number != 0 && t.run_number != m_run_number) {
+        TLOG_DEBUG(10) << "Dropping TimeSync with run number " << t.run_number << ", current run number "
+                       << m_run_number;
+        ++m_other_run_time_sync_count;
+        continue;
+      }
+      const uint64_t arrival_us = m_sleeper.get_clock()->now_us();                   // NOLINT(build/unsigned)
+      const uint64_t previous_arrival_us = m_last_time_sync_us.exchange(arrival_us); // NOLINT(build/unsigned)
+      if (previous_arrival_us != 0 && arrival_us > previous_arrival_us) {
+        m_max_time_sync_gap_us.store(std::max(m_max_time_sync_gap_us.load(), arrival_us - previous_arrival_us));
+      }
+      ++m_time_sync_count;
+      record_timeline_event(m_timeline, TimelineEvent::kTimeSync, 0, t.daq_time);
       dfmessages::timestamp_t estimate = m_current_timestamp_estimate.load();
       dfmessages::timestamp_diff_t diff = estimate - t.daq_time;
       TLOG_DEBUG(10) << "Got a TimeSync timestamp = " << t.daq_time << ", system time = " << t.system_time
                      << " when current timestamp estimate was " << estimate << ". diff=" << diff;
       if (most_recent_timesync.daq_time == dfmessages::TypeDefaults::s_invalid_timestamp ||
           t.daq_time > most_recent_timesync.daq_time) {
+        fit_time_sync(t, most_recent_timesync);
         most_recent_timesync = t;
       }
     } catch (iomanager::TimeoutExpired&) {
@@ -80,10 +109,7 @@ TimestampEstimator::estimator_thread_fn(
 
     if (most_recent_timesync.daq_time != dfmessages::TypeDefaults::s_invalid_timestamp) {
       // Update the current timestamp estimate, based on the most recently-read TimeSync
-      using namespace std::chrono;
-      // std::chrono is the worst
-      auto time_now =
-        static_cast<uint64_t>(duration_cast<microseconds>(system_clock::now().time_since_epoch()).count()); // NOLINT
+      auto time_now = m_sleeper.get_clock()->now_us();
       if (time_now < most_recent_timesync.system_time) {
         // ers::error(InvalidTimeSync(ERS_HERE));
       } else {
@@ -94,10 +120,15 @@ TimestampEstimator::estimator_thread_fn(
           TLOG_DEBUG(1) << "Updating timestamp estimate to " << new_timestamp;
         }
         m_current_timestamp_estimate.store(new_timestamp);
+        m_working_fit.valid = true;
+        m_working_fit.estimate = new_timestamp;
+        m_working_fit.estimate_time_us = time_now;
+        m_fit.store(m_working_fit);
       }
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    m_cpu_time_us.store(thread_cpu_time_us());
+    m_sleeper.sleep_for(std::chrono::milliseconds(10));
   }
 
   // Drain the input queue as best we can. We're not going to do
@@ -105,8 +136,57 @@ TimestampEstimator::estimator_thread_fn(
   // floor
   try {
     while (true)
-      time_sync_source->receive(std::chrono::milliseconds(1));
+      time_sync_source->receive(iomanager::Receiver::s_no_block);
   } catch (iomanager::TimeoutExpired&) {
   }
 }
+
+void
+TimestampEstimator::fit_time_sync(const dfmessages::TimeSync& time_sync, const dfmessages::TimeSync& previous)
+{
+  auto& fit = m_working_fit;
+  if (previous.daq_time != dfmessages::TypeDefaults::s_invalid_timestamp &&
+      time_sync.system_time > previous.system_time) {
+    // How well the last TimeSync and the rate predicted this one
+    double elapsed_s = (time_sync.system_time - previous.system_time) / 1e6;
+    double predicted = previous.daq_time + elapsed_s * fit.rate_hz;
+    double residual = std::abs(static_cast<double>(time_sync.daq_time) - predicted);
+    fit.residual_ticks = std::max(residual, fit.residual_ticks * 0.9);
+
+    // Smooth the rate over the last ten or so intervals
+    double rate_hz = (time_sync.daq_time - previous.daq_time) / elapsed_s;
+    fit.rate_hz = fit.rate_hz * 0.9 + rate_hz * 0.1;
+  }
+  fit.time_sync_daq_time = time_sync.daq_time;
+  fit.time_sync_system_time_us = time_sync.system_time;
+  fit.time_sync_arrival_us = m_sleeper.get_clock()->now_us();
+}
+
+TimestampEstimator::Snapshot
+TimestampEstimator::get_snapshot() const
+{
+  Fit fit = m_fit.load();
+  Snapshot snapshot;
+  if (!fit.valid) {
+    return snapshot;
+  }
+  auto now_us = m_sleeper.get_clock()->now_us();
+  snapshot.valid = true;
+  snapshot.estimate = fit.estimate;
+  snapshot.time_sync_daq_time = fit.time_sync_daq_time;
+  snapshot.time_sync_system_time_us = fit.time_sync_system_time_us;
+  snapshot.age_us = now_us > fit.time_sync_arrival_us ? now_us - fit.time_sync_arrival_us : 0;
+  snapshot.rate_hz = fit.rate_hz;
+
+  // The estimate is extrapolated at the nominal rate, so it's out by
+  // the TimeSyncs' own scatter, plus the difference from the fitted
+  // rate over the extrapolation, plus however long ago it was made
+  double since_time_sync_s =
+    now_us > fit.time_sync_system_time_us ? (now_us - fit.time_sync_system_time_us) / 1e6 : 0.;
+  double since_estimate_s = now_us > fit.estimate_time_us ? (now_us - fit.estimate_time_us) / 1e6 : 0.;
+  double error = fit.residual_ticks + std::abs(fit.rate_hz - m_clock_frequency_hz) * since_time_sync_s +
+                 m_clock_frequency_hz * since_estimate_s;
+  snapshot.error_ticks = static_cast<dfmessages::timestamp_t>(std::ceil(error));
+  return snapshot;
+}
 } // namespace dunedaq::trigemu
@@ -0,0 +1,279 @@
+/**
+ * @file TriggerTraceReader.cpp
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/TriggerTraceReader.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#define TRACE_NAME "TriggerTraceReader" // NOLINT
+
+namespace dunedaq::trigemu {
+
+namespace {
+// How far ahead of the read position we ask the kernel to page the
+// file in, and how far behind it we keep pages around
+constexpr size_t s_readahead_bytes = 16 * 1024 * 1024;
+} // namespace
+
+TriggerTraceReader::TriggerTraceReader(const std::string& path)
+  : m_path(path)
+{
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    throw TraceFileError(ERS_HERE, path, std::strerror(errno));
+  }
+
+  struct stat st;
+  if (::fstat(m_fd, &st) != 0) {
+    int err = errno;
+    ::close(m_fd);
+    throw TraceFileError(ERS_HERE, path, std::strerror(err));
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  if (m_size < sizeof(decisionfile::FileHeader)) {
+    ::close(m_fd);
+    throw TraceFileError(ERS_HERE, path, "file is too short to contain a header");
+  }
+
+  void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (data == MAP_FAILED) {
+    int err = errno;
+    ::close(m_fd);
+    throw TraceFileError(ERS_HERE, path, std::strerror(err));
+  }
+  m_data = static_cast<const char*>(data);
+  ::madvise(data, m_size, MADV_SEQUENTIAL);
+
+  decisionfile::FileHeader header;
+  std::memcpy(&header, m_data, sizeof(header));
+  if (!decisionfile::is_valid_header(header) || header.header_size > m_size) {
+    ::munmap(data, m_size);
+    ::close(m_fd);
+    throw TraceFileError(ERS_HERE, path, "not a trigger decision file, or unsupported version");
+  }
+  m_first_record = header.header_size;
+  m_position = m_first_record;
+
+  load_index();
+  advise(m_position);
+}
+
+TriggerTraceReader::~TriggerTraceReader()
+{
+  ::munmap(const_cast<char*>(m_data), m_size); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+  ::close(m_fd);
+}
+
+void
+TriggerTraceReader::load_index()
+{
+  std::ifstream index_file(m_path + decisionfile::s_index_suffix, std::ios::binary);
+  if (!index_file) {
+    return;
+  }
+  decisionfile::IndexEntry entry;
+  while (index_file.read(reinterpret_cast<char*>(&entry), sizeof(entry))) { // NOLINT
+    if (entry.offset < m_first_record || entry.offset >= m_size) {
+      break;
+    }
+    m_index.push_back(entry);
+  }
+  TLOG_DEBUG(1) << "Loaded " << m_index.size() << " index entries for " << m_path;
+}
+
+void
+TriggerTraceReader::advise(size_t position)
+{
+  if (position + s_readahead_bytes / 2 < m_advised_up_to) {
+    return;
+  }
+  static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  size_t page_start = position / page_size * page_size;
+
+  size_t ahead = std::min(s_readahead_bytes, m_size - page_start);
+  ::madvise(const_cast<char*>(m_data) + page_start, ahead, MADV_WILLNEED); // NOLINT
+  m_advised_up_to = page_start + ahead;
+
+  // Release the pages we've finished with, so replaying a long trace
+  // doesn't grow our resident memory. They're clean file-backed pages,
+  // so this only drops them from our mapping
+  if (page_start > s_readahead_bytes) {
+    size_t behind = (page_start - s_readahead_bytes) / page_size * page_size;
+    ::madvise(const_cast<char*>(m_data), behind, MADV_DONTNEED); // NOLINT
+  }
+}
+
+bool
+TriggerTraceReader::next(dfmessages::TriggerDecision& decision, uint32_t& flags) // NOLINT(build/unsigned)
+{
+  if (m_position + sizeof(decisionfile::RecordHeader) > m_size) {
+    return false;
+  }
+  decisionfile::RecordHeader header;
+  std::memcpy(&header, m_data + m_position, sizeof(header));
+  size_t end = m_position + sizeof(header) + header.n_components * sizeof(decisionfile::ComponentRecord);
+  if (end > m_size) {
+    // A partially-written record at the end of the file
+    return false;
+  }
+
+  flags = header.flags;
+  decision.trigger_number = header.trigger_number;
+  decision.run_number = header.run_number;
+  decision.trigger_timestamp = header.trigger_timestamp;
+  decision.trigger_type = header.trigger_type;
+  decision.components.clear();
+  decision.components.reserve(header.n_components);
+
+  const char* component_data = m_data + m_position + sizeof(header);
+  for (uint16_t i = 0; i < header.n_components; ++i) { // NOLINT(build/unsigned)
+    decisionfile::ComponentRecord record;
+    std::memcpy(&record, component_data + i * sizeof(record), sizeof(record));
+    dfmessages::ComponentRequest request;
+    request.component = dfmessages::GeoID{ static_cast<dfmessages::GeoID::SystemType>(record.system_type),
+                                           record.region_id,
+                                           record.element_id };
+    request.window_begin = record.window_begin;
+    request.window_end = record.window_end;
+    decision.components.push_back(request);
+  }
+
+  m_position = end;
+  advise(m_position);
+  return true;
+}
+
+void
+TriggerTraceReader::rewind()
+{
+  m_position = m_first_record;
+  m_advised_up_to = 0;
+  advise(m_position);
+}
+
+void
+TriggerTraceReader::seek_to_timestamp(dfmessages::timestamp_t timestamp)
+{
+  m_position = m_first_record;
+  // Start from the last indexed record before the timestamp...
+  auto it = std::lower_bound(
+    m_index.begin(), m_index.end(), timestamp, [](const decisionfile::IndexEntry& entry, dfmessages::timestamp_t ts) {
+      return entry.trigger_timestamp < ts;
+    });
+  if (it != m_index.begin()) {
+    m_position = std::prev(it)->offset;
+  }
+
+  // ...and scan forward from there
+  while (m_position + sizeof(decisionfile::RecordHeader) <= m_size) {
+    decisionfile::RecordHeader header;
+    std::memcpy(&header, m_data + m_position, sizeof(header));
+    if (header.flags == 0 && header.trigger_timestamp >= timestamp) {
+      break;
+    }
+    m_position += sizeof(header) + header.n_components * sizeof(decisionfile::ComponentRecord);
+  }
+  m_advised_up_to = 0;
+  advise(std::min(m_position, m_size));
+}
+
+TriggerTraceReplay::TriggerTraceReplay(const std::string& path,
+                                       double time_scale,
+                                       dfmessages::timestamp_t start_offset_ticks,
+                                       bool loop)
+  : m_reader(path)
+  , m_time_scale(time_scale)
+  , m_loop(loop)
+  , m_start_offset_ticks(start_offset_ticks)
+{
+  restart();
+}
+
+void
+TriggerTraceReplay::restart()
+{
+  m_reader.rewind();
+  m_records_in_pass = 0;
+  if (m_start_offset_ticks == 0) {
+    return;
+  }
+  dfmessages::TriggerDecision first;
+  if (next_trigger(first)) {
+    m_reader.seek_to_timestamp(first.trigger_timestamp + m_start_offset_ticks);
+  }
+}
+
+bool
+TriggerTraceReplay::next_trigger(dfmessages::TriggerDecision& record)
+{
+  uint32_t flags = 0; // NOLINT(build/unsigned)
+  while (m_reader.next(record, flags)) {
+    if (flags == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+TriggerTraceReplay::next(dfmessages::TriggerDecision& decision)
+{
+  dfmessages::TriggerDecision record;
+  if (!next_trigger(record)) {
+    if (!m_loop || m_records_in_pass == 0) {
+      return false;
+    }
+    // Start the next pass one mean trigger interval after the last trigger of this one
+    dfmessages::timestamp_t span = m_trace_last - m_trace_start;
+    dfmessages::timestamp_t mean_interval = m_records_in_pass > 1 ? span / (m_records_in_pass - 1) : 0;
+    m_pass_start += std::max<dfmessages::timestamp_t>(std::llround((span + mean_interval) * m_time_scale), 1);
+    restart();
+    if (!next_trigger(record)) {
+      return false;
+    }
+  }
+
+  if (m_records_in_pass == 0) {
+    m_trace_start = record.trigger_timestamp;
+    m_trace_last = record.trigger_timestamp;
+  }
+  // The span of the pass, which is the latest trigger, in case the trace isn't quite in timestamp order
+  m_trace_last = std::max(m_trace_last, record.trigger_timestamp);
+  ++m_records_in_pass;
+
+  auto offset = static_cast<dfmessages::timestamp_diff_t>(
+    std::llround(static_cast<double>(static_cast<dfmessages::timestamp_diff_t>(record.trigger_timestamp - m_trace_start)) *
+                 m_time_scale));
+  decision.trigger_timestamp = m_pass_start + offset;
+  decision.trigger_type = record.trigger_type;
+  decision.components.clear();
+  for (auto const& recorded : record.components) {
+    dfmessages::ComponentRequest request;
+    request.component = recorded.component;
+    auto begin_offset = static_cast<dfmessages::timestamp_diff_t>(recorded.window_begin - record.trigger_timestamp);
+    request.window_begin = decision.trigger_timestamp + begin_offset;
+    request.window_end = request.window_begin + (recorded.window_end - recorded.window_begin);
+    decision.components.push_back(request);
+  }
+  return true;
+}
+
+} // namespace dunedaq::trigemu
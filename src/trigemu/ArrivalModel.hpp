@@ -0,0 +1,110 @@
+/**
+ * @file ArrivalModel.hpp Models of the times at which triggers arrive
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_ARRIVALMODEL_HPP_
+#define TRIGEMU_SRC_TRIGEMU_ARRIVALMODEL_HPP_
+
+#include "dfmessages/Types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Parameters of the arrival models. Which ones are used depends
+ * on the model: see make_arrival_model()
+ */
+struct ArrivalModelParams
+{
+  // "periodic", "jittered", "poisson", "onoff" or "burst"
+  std::string model{ "periodic" };
+  // The (mean) interval between triggers, or between bursts for "burst"
+  dfmessages::timestamp_t interval_ticks{ 0 };
+  // Standard deviation of the trigger times around the periodic grid ("jittered")
+  dfmessages::timestamp_t jitter_ticks{ 0 };
+  // Mean interval between triggers while a burst is on ("onoff")
+  dfmessages::timestamp_t burst_interval_ticks{ 0 };
+  // Mean durations of the on and off states ("onoff")
+  dfmessages::timestamp_t burst_on_ticks{ 0 };
+  dfmessages::timestamp_t burst_off_ticks{ 0 };
+  // Number of triggers in each burst and the time they're spread over ("burst")
+  uint64_t burst_count{ 1 }; // NOLINT(build/unsigned)
+  dfmessages::timestamp_t burst_window_ticks{ 0 };
+  uint64_t seed{ 0 }; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Produces the sequence of trigger timestamps. Timestamps are
+ * non-decreasing; several triggers may share a timestamp
+ */
+class ArrivalModel
+{
+public:
+  virtual ~ArrivalModel() = default;
+
+  // Start the sequence with a trigger at `first`. Also called to
+  // restart the model from a later trigger
+  virtual void start(dfmessages::timestamp_t first) = 0;
+
+  // The timestamp of the trigger following the one at `previous`
+  virtual dfmessages::timestamp_t next(dfmessages::timestamp_t previous) = 0;
+
+  // Change the (mean) interval, eg at resume
+  virtual void set_interval(dfmessages::timestamp_t interval_ticks) = 0;
+};
+
+/**
+ * @brief Create the model named by params.model
+ * @throws InvalidArrivalModel for unknown models or unusable parameters
+ */
+std::unique_ptr<ArrivalModel>
+make_arrival_model(const ArrivalModelParams& params);
+
+// The long-run mean trigger rate of the model described by `params`, in Hz
+double
+mean_rate_hz(const ArrivalModelParams& params, uint64_t clock_frequency_hz); // NOLINT(build/unsigned)
+
+/**
+ * @brief A small buffer of the upcoming trigger timestamps from an
+ * ArrivalModel, computed ahead in batches, so that the sending loop
+ * only has to read the next value, however high the instantaneous rate
+ */
+class TriggerSchedule
+{
+public:
+  explicit TriggerSchedule(std::unique_ptr<ArrivalModel> model, size_t depth = 64);
+
+  void start(dfmessages::timestamp_t first);
+
+  dfmessages::timestamp_t front() const { return m_buffer[m_head]; }
+
+  // Move on to the next trigger
+  void pop();
+
+  // Change the interval. The model is restarted from the next trigger,
+  // and the triggers after it that were already computed are recomputed
+  void set_interval(dfmessages::timestamp_t interval_ticks);
+
+private:
+  void refill();
+
+  std::unique_ptr<ArrivalModel> m_model;
+  std::vector<dfmessages::timestamp_t> m_buffer;
+  size_t m_head{ 0 };
+  size_t m_count{ 0 };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_ARRIVALMODEL_HPP_
@@ -0,0 +1,252 @@
+/**
+ * @file Clock.hpp Clock abstraction used to pace the emulator threads
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_CLOCK_HPP_
+#define TRIGEMU_SRC_TRIGEMU_CLOCK_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Source of "now" and of sleeps for everything in trigemu that
+ * is paced in time. SystemClock follows the wall clock; VirtualClock
+ * lets long schedules be simulated faster than real time
+ */
+class Clock
+{
+public:
+  using time_point = std::chrono::system_clock::time_point;
+  using duration = std::chrono::system_clock::duration;
+
+  virtual ~Clock() = default;
+
+  virtual time_point now() = 0;
+
+  /**
+   * @brief Sleep until `deadline`. The sleep ends early if
+   * `interrupted` returns true: it is checked on entry and after every
+   * call to notify()
+   * @return false if the sleep was interrupted
+   */
+  virtual bool sleep_until(time_point deadline, const std::function<bool()>& interrupted) = 0;
+
+  /**
+   * @brief Like sleep_until(), for threads that aren't participants,
+   * such as the one that runs the commands. They don't hold up the
+   * participants, and a virtual clock wakes them when the time comes
+   */
+  virtual bool wait_until(time_point deadline, const std::function<bool()>& interrupted)
+  {
+    return sleep_until(deadline, interrupted);
+  }
+
+  // Wake up sleepers so they re-check their interruption condition
+  virtual void notify() = 0;
+
+  // Every thread that is paced by the clock should be registered
+  // (see Clock::Participant), so that a virtual clock knows when all
+  // of them are idle
+  virtual void add_participant(int /*count*/) {}
+  virtual void remove_participant(int /*count*/) {}
+
+  // Called by a participant thread when it starts, before it does
+  // anything else. `name` orders threads that are due at the same
+  // time, so it should be unique in the process
+  virtual void enter(const std::string& /*name*/) {}
+
+  // Microseconds since the epoch, the unit of TimeSync::system_time
+  uint64_t now_us() // NOLINT(build/unsigned)
+  {
+    return static_cast<uint64_t>( // NOLINT(build/unsigned)
+      std::chrono::duration_cast<std::chrono::microseconds>(now().time_since_epoch()).count());
+  }
+
+  bool sleep_for(duration d, const std::function<bool()>& interrupted) { return sleep_until(now() + d, interrupted); }
+
+  /**
+   * @brief Registers `count` threads as participants of a clock for
+   * the lifetime of the object. Modules register their threads at
+   * configuration rather than when the threads start, so that a module
+   * that is started first can't run ahead of the others in virtual time.
+   * Each thread leaves when it finishes (see ThreadScope), so that the
+   * clock doesn't wait for it, and rejoin() counts them all again
+   * before they're restarted
+   */
+  class Participant
+  {
+  public:
+    Participant(std::shared_ptr<Clock> clock, int count)
+      : m_clock(std::move(clock))
+      , m_count(count)
+      , m_active(count)
+    {
+      m_clock->add_participant(m_count);
+    }
+    ~Participant() { m_clock->remove_participant(m_active); }
+
+    Participant(Participant const&) = delete;
+    Participant(Participant&&) = delete;
+    Participant& operator=(Participant const&) = delete;
+    Participant& operator=(Participant&&) = delete;
+
+    const std::shared_ptr<Clock>& get_clock() const { return m_clock; }
+
+    // One of the threads has finished
+    void leave()
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (m_active > 0) {
+        --m_active;
+        m_clock->remove_participant(1);
+      }
+    }
+
+    // Count all the threads again, before they're started
+    void rejoin()
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_clock->add_participant(m_count - m_active);
+      m_active = m_count;
+    }
+
+  private:
+    std::shared_ptr<Clock> m_clock;
+    int m_count;
+    std::mutex m_mutex;
+    int m_active;
+  };
+
+  /**
+   * @brief Enters the clock at the start of a participant thread and
+   * leaves it when the thread finishes, however it finishes
+   */
+  class ThreadScope
+  {
+  public:
+    ThreadScope(Participant& participant, const std::string& name)
+      : m_participant(participant)
+    {
+      m_participant.get_clock()->enter(name);
+    }
+    ~ThreadScope() { m_participant.leave(); }
+
+    ThreadScope(ThreadScope const&) = delete;
+    ThreadScope(ThreadScope&&) = delete;
+    ThreadScope& operator=(ThreadScope const&) = delete;
+    ThreadScope& operator=(ThreadScope&&) = delete;
+
+  private:
+    Participant& m_participant;
+  };
+};
+
+/**
+ * @brief The wall clock. Each instance has its own condition variable,
+ * so notify() only wakes the threads sleeping on that instance. Sleeps
+ * re-check their interruption condition, so being woken by another
+ * module's notify() is harmless
+ */
+class SystemClock : public Clock
+{
+public:
+  time_point now() override { return std::chrono::system_clock::now(); }
+  bool sleep_until(time_point deadline, const std::function<bool()>& interrupted) override;
+  void notify() override;
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+};
+
+/**
+ * @brief A clock that only moves while every registered participant is
+ * asleep on it, so a simulation runs as fast as the work between
+ * sleeps completes.
+ *
+ * The participants take turns. When they are all asleep, the clock
+ * wakes exactly one of them: one whose sleep has been interrupted if
+ * there is any, otherwise the one with the earliest deadline, moving
+ * time forward to it. That thread runs on its own until it sleeps
+ * again. So what the participants do, and in what order, depends only
+ * on their code and inputs, not on how the OS schedules them, and the
+ * same inputs give the same results every time. Ties are broken by
+ * the names the threads entered with, then by the order they went to
+ * sleep in.
+ *
+ * A participant must therefore not block on anything but the clock:
+ * it should poll its queues without waiting, and sleep on the clock in
+ * between. One that blocks elsewhere, or that is registered but not
+ * running yet, stops time until it sleeps or leaves.
+ *
+ * Virtual time starts at `start`, by default the wall-clock time at
+ * which the clock was created.
+ */
+class VirtualClock : public Clock
+{
+public:
+  explicit VirtualClock(time_point start = std::chrono::system_clock::now());
+
+  time_point now() override;
+  bool sleep_until(time_point deadline, const std::function<bool()>& interrupted) override;
+  bool wait_until(time_point deadline, const std::function<bool()>& interrupted) override;
+  void notify() override;
+  void add_participant(int count) override;
+  void remove_participant(int count) override;
+  void enter(const std::string& name) override;
+
+private:
+  struct Sleeper
+  {
+    time_point deadline;
+    std::string name;
+    uint64_t sequence; // NOLINT(build/unsigned)
+    const std::function<bool()>* interrupted;
+    bool woken{ false };
+    bool completed{ false }; // Woken at its deadline, rather than by an interruption
+  };
+
+  // Put the calling participant to sleep until the clock wakes it. Called with m_mutex held
+  bool sleep(std::unique_lock<std::mutex>& lk, time_point deadline, const std::function<bool()>* interrupted);
+
+  // If every participant is asleep, wake the next one, and the waiters
+  // that are due before it. Called with m_mutex held
+  void schedule();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  time_point m_now;
+  std::vector<Sleeper*> m_sleepers; // Participants
+  std::vector<Sleeper*> m_waiters;  // Threads in wait_until()
+  int m_participants{ 0 };
+  uint64_t m_sequence{ 0 }; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Get the clock a module should use: the SystemClock or the
+ * VirtualClock shared by every module in the process. Modules
+ * connected by queues agree on the simulated time, and modules that
+ * use the same kind of clock can share the threads that are paced by
+ * it (see acquire_shared_timestamp_estimator)
+ */
+std::shared_ptr<Clock>
+make_clock(bool use_virtual_clock);
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_CLOCK_HPP_
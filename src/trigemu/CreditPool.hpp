@@ -0,0 +1,87 @@
+/**
+ * @file CreditPool.hpp CreditPool Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_CREDITPOOL_HPP_
+#define TRIGEMU_SRC_TRIGEMU_CREDITPOOL_HPP_
+
+#include "trigemu/Clock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Credit-based admission: trigger tokens, as a pool of credits
+ * that the sender takes from and token arrivals give back to.
+ *
+ * Credits are taken all-or-nothing with a compare-and-swap loop, so
+ * the count never goes negative, whatever the interleaving with
+ * release(). A caller waiting for credits is woken by release() rather
+ * than polling. The pool also measures how long the (single)
+ * acquiring thread has spent starved of credits: from its first failed
+ * acquisition to the next successful one.
+ */
+class CreditPool
+{
+public:
+  explicit CreditPool(std::shared_ptr<Clock> clock = std::make_shared<SystemClock>())
+    : m_clock(std::move(clock))
+  {}
+
+  CreditPool(CreditPool const&) = delete;
+  CreditPool(CreditPool&&) = delete;
+  CreditPool& operator=(CreditPool const&) = delete;
+  CreditPool& operator=(CreditPool&&) = delete;
+
+  void set_clock(std::shared_ptr<Clock> clock) { m_clock = std::move(clock); }
+
+  // Start again with `credits` credits, and zero the starvation accounting
+  void reset(int64_t credits);
+
+  // Take `n` credits if there are that many
+  bool try_acquire(int64_t n);
+
+  // Take as many credits as there are, up to `n`. Returns the number taken
+  int64_t try_acquire_up_to(int64_t n);
+
+  /**
+   * @brief Take `n` credits, waiting until `deadline` for them if needed
+   * @return false if the deadline passed, or `interrupted` became true, first
+   */
+  bool acquire_until(int64_t n, Clock::time_point deadline, const std::function<bool()>& interrupted);
+
+  // Give back `n` credits, and wake anyone waiting for them
+  void release(int64_t n = 1);
+
+  int64_t available() const { return m_credits.load(std::memory_order_relaxed); }
+
+  // Total time spent starved of credits, including the current spell, and the number of spells
+  uint64_t get_starved_us() const; // NOLINT(build/unsigned)
+  uint64_t get_starved_count() const { return m_starved_count.load(); } // NOLINT(build/unsigned)
+
+private:
+  // Starvation accounting, after each attempt to acquire
+  void acquired(bool success);
+
+  std::shared_ptr<Clock> m_clock;
+  alignas(64) std::atomic<int64_t> m_credits{ 0 };
+
+  std::atomic<int64_t> m_starved_since_us{ -1 }; // -1 when not starved
+  std::atomic<uint64_t> m_starved_total_us{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_starved_count{ 0 };    // NOLINT(build/unsigned)
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_CREDITPOOL_HPP_
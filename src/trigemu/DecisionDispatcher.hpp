@@ -0,0 +1,147 @@
+/**
+ * @file DecisionDispatcher.hpp DecisionDispatcher Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_DECISIONDISPATCHER_HPP_
+#define TRIGEMU_SRC_TRIGEMU_DECISIONDISPATCHER_HPP_
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+#include "iomanager/Sender.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief How DecisionDispatcher chooses the sink for each decision
+ */
+enum class DispatchPolicy
+{
+  kRoundRobin,       ///< Each sink in turn
+  kLeastOutstanding, ///< The sink with the fewest decisions whose token hasn't come back
+  kHash              ///< A sink chosen from the trigger number, so a given trigger always goes to the same place
+};
+
+/**
+ * @brief Parse "round_robin", "least_outstanding" or "hash"
+ * @throws InvalidDispatchPolicy for anything else
+ */
+DispatchPolicy
+parse_dispatch_policy(const std::string& name);
+
+/**
+ * @brief Sends trigger decisions to one of several sinks, chosen by a
+ * DispatchPolicy.
+ *
+ * A decision is first offered to each sink without waiting, starting
+ * from the policy's choice, so a full sink doesn't hold up the others.
+ * Only if none of them takes it is it sent with `send_timeout` to each
+ * sink in turn. A send that times out is counted as a failure against
+ * the sink. If there are other sinks, it is then skipped for `backoff`
+ * except for sends that don't wait; the only sink is always waited on.
+ * A sink that another thread is already waiting on is never waited on.
+ * If a sink's send throws anything other than a timeout, the exception
+ * is passed on to the caller, and the decision counts as not sent.
+ *
+ * All methods may be called from any thread. Only the choice of sink
+ * is serialised: the sends themselves aren't made under a lock, so a
+ * slow sink doesn't hold up a dispatch() from another thread.
+ */
+class DecisionDispatcher
+{
+public:
+  using sink_t = std::shared_ptr<iomanager::SenderConcept<dfmessages::TriggerDecision>>;
+
+  struct Sink
+  {
+    Sink(const std::string& sink_name, sink_t sink_ptr)
+      : name(sink_name)
+      , sender(sink_ptr)
+    {}
+
+    std::string name;
+    sink_t sender;
+    std::atomic<std::chrono::steady_clock::time_point> skip_until{ std::chrono::steady_clock::time_point() };
+    // The number of threads sending to the sink with a timeout right now
+    std::atomic<int> waiting_senders{ 0 };
+
+    std::atomic<uint64_t> sent{ 0 };          // NOLINT(build/unsigned)
+    std::atomic<uint64_t> send_failures{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<int64_t> outstanding{ 0 };
+    // What get_info() last reported
+    uint64_t reported_sent{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  DecisionDispatcher() = default;
+
+  DecisionDispatcher(DecisionDispatcher const&) = delete;
+  DecisionDispatcher(DecisionDispatcher&&) = delete;
+  DecisionDispatcher& operator=(DecisionDispatcher const&) = delete;
+  DecisionDispatcher& operator=(DecisionDispatcher&&) = delete;
+
+  // Sinks are added once, at init
+  void add_sink(const std::string& name, sink_t sender) { m_sinks.push_back(std::make_unique<Sink>(name, sender)); }
+
+  // Set at conf. Tracking outstanding decisions only makes sense if tokens are coming back
+  void configure(DispatchPolicy policy,
+                 std::chrono::milliseconds send_timeout,
+                 std::chrono::milliseconds backoff,
+                 bool track_outstanding);
+
+  // Forget the outstanding decisions and zero the counters, at start of run
+  void reset();
+
+  /**
+   * @brief Send `decision` to a sink chosen by the policy
+   * @return false if no sink accepted it
+   */
+  bool dispatch(const dfmessages::TriggerDecision& decision);
+
+  // Send `decision` to the first sink, as dispatch() would if it were the only one, without consulting the policy
+  bool dispatch_to_only_sink(const dfmessages::TriggerDecision& decision);
+
+  // The token for `trigger_number` came back
+  void complete(dfmessages::trigger_number_t trigger_number);
+
+  const std::vector<std::unique_ptr<Sink>>& get_sinks() const { return m_sinks; }
+
+private:
+  // The sink the policy would pick first for this decision
+  size_t first_choice(const dfmessages::TriggerDecision& decision);
+
+  // Send to one sink, waiting up to `timeout` for it. Only a timed-out send that waited counts as a failure
+  bool try_send(size_t index, const dfmessages::TriggerDecision& decision, std::chrono::milliseconds timeout);
+
+  std::vector<std::unique_ptr<Sink>> m_sinks;
+
+  DispatchPolicy m_policy{ DispatchPolicy::kRoundRobin };
+  std::chrono::milliseconds m_send_timeout{ 10 };
+  std::chrono::milliseconds m_backoff{ 100 };
+  bool m_track_outstanding{ false };
+
+  // Guards the sink choice
+  std::mutex m_dispatch_mutex;
+  size_t m_next_sink{ 0 };
+
+  // Which sink each outstanding decision went to
+  std::mutex m_outstanding_mutex;
+  std::unordered_map<dfmessages::trigger_number_t, size_t> m_sink_of_trigger;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_DECISIONDISPATCHER_HPP_
@@ -0,0 +1,105 @@
+/**
+ * @file DecisionFile.hpp Binary file format for streams of trigger decisions
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_DECISIONFILE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_DECISIONFILE_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+namespace dunedaq {
+namespace trigemu {
+namespace decisionfile {
+
+// A decision file is a FileHeader followed by a sequence of records,
+// each of which is a RecordHeader followed by n_components
+// ComponentRecords. Everything is stored in host byte order, with
+// fixed-size fields so that a file can be read in place from a memory
+// mapping. Files are append-only: a record that is cut short at the
+// end of a file is one that's still being written, and readers treat
+// it as the end of the file.
+//
+// A record with no flags is a decision sent for the first time, and
+// those are in the order they were sent. Flagged records are further
+// copies of decisions, which a replay skips: repeats under the next
+// trigger number (repeat_trigger_count), and stale decisions sent
+// again, which keep their number and timestamp, so come out of order.
+//
+// Writers may also produce an index file alongside, named
+// <decision file>.idx, which contains one IndexEntry every few
+// records with no flags, so readers can seek by timestamp without
+// scanning.
+
+constexpr char s_magic[8] = { 'T', 'D', 'E', 'D', 'E', 'C', 'S', '\0' };
+constexpr uint32_t s_version = 2;                // NOLINT(build/unsigned)
+constexpr const char* s_index_suffix = ".idx";
+
+// RecordHeader::flags
+constexpr uint32_t s_flag_repeat = 1; // NOLINT(build/unsigned) A repeat of the record before it
+constexpr uint32_t s_flag_resent = 2; // NOLINT(build/unsigned) A stale decision, sent again
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;     // NOLINT(build/unsigned)
+  uint32_t header_size; // NOLINT(build/unsigned)
+  uint64_t reserved;    // NOLINT(build/unsigned)
+};
+static_assert(sizeof(FileHeader) == 24);
+
+struct RecordHeader
+{
+  uint64_t trigger_number;    // NOLINT(build/unsigned)
+  uint64_t trigger_timestamp; // NOLINT(build/unsigned)
+  uint32_t run_number;        // NOLINT(build/unsigned)
+  uint16_t trigger_type;      // NOLINT(build/unsigned)
+  uint16_t n_components;      // NOLINT(build/unsigned)
+  uint32_t flags;             // NOLINT(build/unsigned)
+  uint32_t reserved;          // NOLINT(build/unsigned)
+};
+static_assert(sizeof(RecordHeader) == 32);
+
+struct ComponentRecord
+{
+  uint16_t system_type;  // NOLINT(build/unsigned)
+  uint16_t region_id;    // NOLINT(build/unsigned)
+  uint32_t element_id;   // NOLINT(build/unsigned)
+  uint64_t window_begin; // NOLINT(build/unsigned)
+  uint64_t window_end;   // NOLINT(build/unsigned)
+};
+static_assert(sizeof(ComponentRecord) == 24);
+
+struct IndexEntry
+{
+  uint64_t offset;            // NOLINT(build/unsigned) Byte offset of the record in the decision file
+  uint64_t trigger_timestamp; // NOLINT(build/unsigned)
+};
+static_assert(sizeof(IndexEntry) == 16);
+
+inline FileHeader
+make_file_header()
+{
+  FileHeader header{};
+  std::memcpy(header.magic, s_magic, sizeof(s_magic));
+  header.version = s_version;
+  header.header_size = sizeof(FileHeader);
+  return header;
+}
+
+inline bool
+is_valid_header(const FileHeader& header)
+{
+  return std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0 && header.version == s_version &&
+         header.header_size >= sizeof(FileHeader);
+}
+
+} // namespace decisionfile
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_DECISIONFILE_HPP_
@@ -0,0 +1,134 @@
+/**
+ * @file DecisionRecorder.hpp DecisionRecorder Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_DECISIONRECORDER_HPP_
+#define TRIGEMU_SRC_TRIGEMU_DECISIONRECORDER_HPP_
+
+#include "trigemu/DecisionFile.hpp"
+#include "trigemu/SPSCRing.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Records trigger decisions to decision files (see
+ * DecisionFile.hpp), off the thread that emits them.
+ *
+ * record() only copies the decision into a lock-free ring; if the ring
+ * is full the decision is counted as dropped rather than blocking the
+ * caller. Repeats of a decision are flagged as such. Decisions that are
+ * sent again when they go stale come from another thread, so they have
+ * a ring of their own, are recorded with record_resent(), and are
+ * flagged as resent. A background thread writes the decisions out in batches,
+ * along with an index entry every `index_interval` records, and starts
+ * a new file once the current one exceeds `max_file_bytes`. Files are
+ * named <prefix>_run<run number>_<sequence number>.tdedec
+ */
+class DecisionRecorder
+{
+public:
+  DecisionRecorder(const std::string& prefix,
+                   dfmessages::run_number_t run_number,
+                   size_t max_file_bytes,
+                   size_t index_interval,
+                   bool fsync_on_flush,
+                   size_t ring_capacity = 65536);
+
+  ~DecisionRecorder() { close(); }
+
+  DecisionRecorder(DecisionRecorder const&) = delete;
+  DecisionRecorder(DecisionRecorder&&) = delete;
+  DecisionRecorder& operator=(DecisionRecorder const&) = delete;
+  DecisionRecorder& operator=(DecisionRecorder&&) = delete;
+
+  // Called by the (single) emitting thread. `repeat` is set for the repeats of the decision recorded before
+  void record(const dfmessages::TriggerDecision& decision, bool repeat = false)
+  {
+    push(m_ring, decision, repeat ? decisionfile::s_flag_repeat : 0);
+  }
+
+  // Called by the (single) thread that sends stale decisions again
+  void record_resent(const dfmessages::TriggerDecision& decision)
+  {
+    push(m_resent_ring, decision, decisionfile::s_flag_resent);
+  }
+
+  // Write out everything that was recorded, then close the file. No
+  // more decisions may be recorded afterwards
+  void close();
+
+  uint64_t get_recorded_count() const { return m_recorded_count.load(); } // NOLINT(build/unsigned)
+  uint64_t get_dropped_count() const { return m_dropped_count.load(); }   // NOLINT(build/unsigned)
+
+private:
+  struct Entry
+  {
+    dfmessages::TriggerDecision decision;
+    uint32_t flags{ 0 }; // NOLINT(build/unsigned)
+  };
+
+  // Copied into the slot in place, so that its components keep their capacity
+  void push(SPSCRing<Entry>& ring, const dfmessages::TriggerDecision& decision, uint32_t flags) // NOLINT
+  {
+    if (!ring.try_push_with([&](Entry& slot) {
+          slot.decision = decision;
+          slot.flags = flags;
+        })) {
+      m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void writer_thread_fn();
+
+  void open_next_file();
+  void close_file();
+  void append(const Entry& entry);
+  void flush();
+
+  // Write out what's in `ring`. Returns false if it was empty
+  bool drain(SPSCRing<Entry>& ring, Entry& entry);
+
+  SPSCRing<Entry> m_ring;
+  SPSCRing<Entry> m_resent_ring;
+
+  std::string m_prefix;
+  dfmessages::run_number_t m_run_number;
+  size_t m_max_file_bytes;
+  size_t m_index_interval;
+  bool m_fsync_on_flush;
+
+  // Writer thread state
+  int m_fd{ -1 };
+  int m_index_fd{ -1 };
+  int m_file_sequence{ 0 };
+  size_t m_file_bytes{ 0 };
+  size_t m_records_in_file{ 0 };
+  size_t m_unflagged_in_file{ 0 }; // Only these are indexed
+  std::vector<char> m_buffer;
+  std::vector<char> m_index_buffer;
+
+  std::atomic<uint64_t> m_recorded_count{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dropped_count{ 0 };  // NOLINT(build/unsigned)
+
+  std::atomic<bool> m_running_flag{ true };
+  std::thread m_writer_thread;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_DECISIONRECORDER_HPP_
@@ -0,0 +1,84 @@
+/**
+ * @file EmissionQueue.hpp EmissionQueue Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_EMISSIONQUEUE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_EMISSIONQUEUE_HPP_
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+// A decision made ahead of time, waiting to be sent
+struct PendingDecision
+{
+  dfmessages::timestamp_t emit_at{ 0 }; ///< The timestamp estimate at which to send it
+  dfmessages::timestamp_t trigger_timestamp{ 0 };
+  size_t stream{ 0 };
+  uint64_t slot{ 0 }; // NOLINT(build/unsigned) Its place in a sharded timeline
+  dfmessages::TriggerDecision decision;
+};
+
+/**
+ * @brief The decisions waiting to be sent, in the order of their
+ * emission times. Decisions with the same emission time come out in
+ * the order they went in. Only used by the sending thread
+ */
+class EmissionQueue
+{
+public:
+  bool empty() const { return m_heap.empty(); }
+  size_t size() const { return m_heap.size(); }
+
+  // The decision to send first
+  const PendingDecision& front() const { return m_heap.front().pending; }
+
+  void push(PendingDecision pending)
+  {
+    m_heap.push_back(Entry{ m_pushed++, std::move(pending) });
+    std::push_heap(m_heap.begin(), m_heap.end(), later);
+  }
+
+  PendingDecision pop()
+  {
+    std::pop_heap(m_heap.begin(), m_heap.end(), later);
+    PendingDecision pending = std::move(m_heap.back().pending);
+    m_heap.pop_back();
+    return pending;
+  }
+
+  void clear() { m_heap.clear(); }
+
+private:
+  struct Entry
+  {
+    uint64_t sequence; // NOLINT(build/unsigned)
+    PendingDecision pending;
+  };
+
+  // The heap's ordering: a is sent after b
+  static bool later(const Entry& a, const Entry& b)
+  {
+    return a.pending.emit_at != b.pending.emit_at ? a.pending.emit_at > b.pending.emit_at : a.sequence > b.sequence;
+  }
+
+  std::vector<Entry> m_heap;
+  uint64_t m_pushed{ 0 }; // NOLINT(build/unsigned)
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_EMISSIONQUEUE_HPP_
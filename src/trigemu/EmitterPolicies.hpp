@@ -0,0 +1,166 @@
+/**
+ * @file EmitterPolicies.hpp Policies of the trigger decision sending loop
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_EMITTERPOLICIES_HPP_
+#define TRIGEMU_SRC_TRIGEMU_EMITTERPOLICIES_HPP_
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/CreditPool.hpp"
+#include "trigemu/DecisionDispatcher.hpp"
+#include "trigemu/RegionInhibits.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * The policies TriggerDecisionEmulator's sending loop is compiled for.
+ * Each is fixed for the run, so the loop is instantiated for every
+ * combination and do_start() picks one: what doesn't apply to the run
+ * is compiled out, rather than tested for every trigger. Each policy
+ * holds references to the parts of the emulator it uses, which must
+ * outlive it.
+ *
+ * - Admission: whether a decision takes a token (FreeAdmission, TokenAdmission)
+ * - Inhibit source: whether anything can inhibit triggers (NoInhibitSource, InhibitQueues)
+ * - Trigger source: the arrival models and the links they read out, or
+ *   a trace (GeneratedTriggers, ReplayedTriggers)
+ * - Dispatch: whether there is a choice of sink (OnlySinkDispatch, PolicyDispatch)
+ */
+
+// Decisions are sent without tokens
+class FreeAdmission
+{
+public:
+  static constexpr bool s_takes_tokens = false;
+
+  int admit(int n) { return n; }
+  void give_back(int /*n*/) {}
+};
+
+/**
+ * @brief Each decision takes a token. A trigger gets tokens for all `n`
+ * of its decisions, waiting up to `wait` for them, or else as many as
+ * there are if `allow_partial` is set
+ */
+class TokenAdmission
+{
+public:
+  static constexpr bool s_takes_tokens = true;
+
+  TokenAdmission(CreditPool& tokens,
+                 std::shared_ptr<Clock> clock,
+                 std::chrono::milliseconds wait,
+                 bool allow_partial,
+                 const std::atomic<bool>& running)
+    : m_tokens(tokens)
+    , m_clock(std::move(clock))
+    , m_wait(wait)
+    , m_allow_partial(allow_partial)
+    , m_running(running)
+  {}
+
+  // The number of decisions that may be sent
+  int admit(int n)
+  {
+    if (m_tokens.try_acquire(n)) {
+      return n;
+    }
+    if (m_wait.count() > 0 &&
+        m_tokens.acquire_until(n, m_clock->now() + m_wait, [this]() { return !m_running.load(); })) {
+      return n;
+    }
+    return m_allow_partial ? static_cast<int>(m_tokens.try_acquire_up_to(n)) : 0;
+  }
+  void give_back(int n) { m_tokens.release(n); }
+
+private:
+  CreditPool& m_tokens;
+  std::shared_ptr<Clock> m_clock;
+  std::chrono::milliseconds m_wait;
+  bool m_allow_partial;
+  const std::atomic<bool>& m_running;
+};
+
+// Nothing is connected that could inhibit triggers
+class NoInhibitSource
+{
+public:
+  bool inhibited() const { return false; }
+  uint64_t busy_regions() const { return 0; } // NOLINT(build/unsigned)
+};
+
+// Dataflow, or regions of it, can inhibit triggers
+class InhibitQueues
+{
+public:
+  InhibitQueues(const std::atomic<bool>& inhibited, const RegionInhibits& regions)
+    : m_inhibited(inhibited)
+    , m_regions(regions)
+  {}
+
+  bool inhibited() const { return m_inhibited.load(); }
+  uint64_t busy_regions() const { return m_regions.busy_regions(); } // NOLINT(build/unsigned)
+
+private:
+  const std::atomic<bool>& m_inhibited;
+  const RegionInhibits& m_regions;
+};
+
+// The trigger times come from the streams' arrival models, and each decision's links from its stream
+struct GeneratedTriggers
+{
+  static constexpr bool s_replays = false;
+};
+
+// The trigger times and links come from a trace
+struct ReplayedTriggers
+{
+  static constexpr bool s_replays = true;
+};
+
+// There's one sink, so no policy to consult
+class OnlySinkDispatch
+{
+public:
+  explicit OnlySinkDispatch(DecisionDispatcher& dispatcher)
+    : m_dispatcher(dispatcher)
+  {}
+
+  bool dispatch(const dfmessages::TriggerDecision& decision) { return m_dispatcher.dispatch_to_only_sink(decision); }
+
+private:
+  DecisionDispatcher& m_dispatcher;
+};
+
+// The dispatcher's policy chooses between the sinks
+class PolicyDispatch
+{
+public:
+  explicit PolicyDispatch(DecisionDispatcher& dispatcher)
+    : m_dispatcher(dispatcher)
+  {}
+
+  bool dispatch(const dfmessages::TriggerDecision& decision) { return m_dispatcher.dispatch(decision); }
+
+private:
+  DecisionDispatcher& m_dispatcher;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_EMITTERPOLICIES_HPP_
@@ -0,0 +1,109 @@
+/**
+ * @file EmpiricalDistribution.hpp AliasSampler and EmpiricalDistribution Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_EMPIRICALDISTRIBUTION_HPP_
+#define TRIGEMU_SRC_TRIGEMU_EMPIRICALDISTRIBUTION_HPP_
+
+#include "dfmessages/Types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Draws index i with probability weights[i] / sum(weights), in
+ * constant time however many weights there are (Walker's alias method,
+ * as set up by Vose).
+ *
+ * Each index has a column of height 1, split between itself, with
+ * probability m_probability[i], and one other index, m_alias[i]. A
+ * draw picks a column and then one of its two halves
+ */
+class AliasSampler
+{
+public:
+  // The weights must be non-negative, with a positive sum
+  explicit AliasSampler(const std::vector<double>& weights);
+
+  template<typename Engine>
+  size_t operator()(Engine& engine) const
+  {
+    double x = std::uniform_real_distribution<double>(0., static_cast<double>(m_alias.size()))(engine);
+    size_t column = std::min(static_cast<size_t>(x), m_alias.size() - 1);
+    return x - column < m_probability[column] ? column : m_alias[column];
+  }
+
+  size_t size() const { return m_alias.size(); }
+
+private:
+  std::vector<double> m_probability;
+  std::vector<size_t> m_alias;
+};
+
+/**
+ * @brief A histogram of integer values, for drawing readout windows or
+ * link counts from: a bin is chosen by weight, then a value uniformly
+ * within it
+ */
+class EmpiricalDistribution
+{
+public:
+  struct Bin
+  {
+    int64_t low;  ///< Smallest value in the bin
+    int64_t high; ///< Largest value in the bin
+    double weight;
+  };
+
+  explicit EmpiricalDistribution(std::vector<Bin> bins);
+
+  template<typename Engine>
+  int64_t operator()(Engine& engine) const
+  {
+    auto const& bin = m_bins[m_sampler(engine)];
+    return bin.low == bin.high ? bin.low : std::uniform_int_distribution<int64_t>(bin.low, bin.high)(engine);
+  }
+
+  const std::vector<Bin>& get_bins() const { return m_bins; }
+
+private:
+  std::vector<Bin> m_bins;
+  AliasSampler m_sampler;
+};
+
+// The distributions given for one trigger type. Either may be missing
+struct TriggerTypeDistributions
+{
+  std::shared_ptr<const EmpiricalDistribution> window_ticks;
+  std::shared_ptr<const EmpiricalDistribution> link_count;
+};
+
+/**
+ * @brief Read a distribution file: a text file of lines
+ *
+ *     <trigger type> <window_ticks|link_count> <low> <high> <weight>
+ *
+ * each a bin of the histogram of that quantity for that trigger type.
+ * Blank lines and lines starting with # are skipped
+ * @throws DistributionFileError if it can't be read or is malformed
+ */
+std::map<dfmessages::trigger_type_t, TriggerTypeDistributions>
+load_distribution_file(const std::string& path);
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_EMPIRICALDISTRIBUTION_HPP_
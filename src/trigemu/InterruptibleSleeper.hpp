@@ -0,0 +1,72 @@
+/**
+ * @file InterruptibleSleeper.hpp InterruptibleSleeper Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_INTERRUPTIBLESLEEPER_HPP_
+#define TRIGEMU_SRC_TRIGEMU_INTERRUPTIBLESLEEPER_HPP_
+
+#include "trigemu/Clock.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief A replacement for std::this_thread::sleep_for() in the
+ * polling loops of the emulator threads, which can be cut short when
+ * the run is stopped, so that the stop transition doesn't have to wait
+ * for every thread to finish its current sleep. Sleeps are measured on
+ * a Clock, which is the wall clock unless set_clock() says otherwise.
+ */
+class InterruptibleSleeper
+{
+public:
+  explicit InterruptibleSleeper(std::shared_ptr<Clock> clock = std::make_shared<SystemClock>())
+    : m_clock(std::move(clock))
+  {}
+
+  // Not thread-safe: only call this while nobody is sleeping
+  void set_clock(std::shared_ptr<Clock> clock) { m_clock = std::move(clock); }
+  const std::shared_ptr<Clock>& get_clock() const { return m_clock; }
+
+  /**
+   * @brief Sleep for up to the given duration
+   * @return false if the sleep was cut short (or skipped) by interrupt()
+   */
+  template<class Rep, class Period>
+  bool sleep_for(const std::chrono::duration<Rep, Period>& duration)
+  {
+    return m_clock->sleep_for(std::chrono::duration_cast<Clock::duration>(duration),
+                              [this] { return m_interrupted.load(); });
+  }
+
+  // Wake up all current sleepers. Subsequent sleeps return
+  // immediately until reset() is called
+  void interrupt()
+  {
+    m_interrupted.store(true);
+    m_clock->notify();
+  }
+
+  // Make sleeps last their full duration again, eg at the start of a new run
+  void reset() { m_interrupted.store(false); }
+
+  bool interrupted() const { return m_interrupted.load(); }
+
+private:
+  std::shared_ptr<Clock> m_clock;
+  std::atomic<bool> m_interrupted{ false };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_INTERRUPTIBLESLEEPER_HPP_
@@ -0,0 +1,141 @@
+/**
+ * @file OpenDecisionTracker.hpp OpenDecisionTracker Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_OPENDECISIONTRACKER_HPP_
+#define TRIGEMU_SRC_TRIGEMU_OPENDECISIONTRACKER_HPP_
+
+#include "trigemu/Clock.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Keeps track of the trigger decisions whose token hasn't come
+ * back yet, and finds the ones that have been open for too long.
+ *
+ * Deadlines are kept in a timing wheel with `resolution`-sized buckets,
+ * so that opening, closing and expiring decisions don't depend on how
+ * many are open. Closed decisions are removed from the wheel lazily.
+ * Up to `journal_capacity` of the open decisions are kept in full, so
+ * that they can be sent again. All methods are thread-safe.
+ */
+class OpenDecisionTracker
+{
+public:
+  using time_point = Clock::time_point;
+
+  // A decision found to be stale by collect_expired()
+  struct Expired
+  {
+    dfmessages::trigger_number_t trigger_number;
+    std::chrono::milliseconds age;
+    int resends;
+    bool journaled;
+    dfmessages::TriggerDecision decision; // Only filled if `journaled`
+  };
+
+  OpenDecisionTracker() = default;
+
+  OpenDecisionTracker(OpenDecisionTracker const&) = delete;
+  OpenDecisionTracker(OpenDecisionTracker&&) = delete;
+  OpenDecisionTracker& operator=(OpenDecisionTracker const&) = delete;
+  OpenDecisionTracker& operator=(OpenDecisionTracker&&) = delete;
+
+  // Set the timeout (zero disables expiry) and journal size. Also clear()s
+  void configure(std::chrono::milliseconds timeout,
+                 size_t journal_capacity,
+                 std::chrono::milliseconds resolution = std::chrono::milliseconds(10));
+
+  // Forget all the open decisions
+  void clear();
+
+  void open(const dfmessages::TriggerDecision& decision, time_point now);
+
+  // The decision's token came back. Returns false if the decision wasn't open
+  bool close(dfmessages::trigger_number_t trigger_number);
+  // The same, and if it was open, sets `open_for` to how long it was open since it was first sent
+  bool close(dfmessages::trigger_number_t trigger_number, time_point now, Clock::duration& open_for);
+
+  /**
+   * @brief Append the decisions whose timeout has passed to `expired`.
+   * They stay open, but won't expire again unless they are rearm()ed
+   */
+  void collect_expired(time_point now, std::vector<Expired>& expired);
+
+  // Restart the timeout of an open decision, after it was sent again
+  void rearm(dfmessages::trigger_number_t trigger_number, time_point now);
+
+  // Stop tracking an open decision, and remember that its token was given back
+  void reclaim(dfmessages::trigger_number_t trigger_number);
+
+  /**
+   * @brief Is a token for this closed decision one that was still to
+   * come? A decision that was sent again gets a token back for each
+   * copy, and only the first closes it; a reclaimed one has already had
+   * its token given back. The extra tokens are remembered when the
+   * decision is closed or reclaimed, and each is taken once
+   */
+  bool take_late_token(dfmessages::trigger_number_t trigger_number);
+
+  size_t size() const;
+
+  // The most decisions that were open at once since the last clear()
+  size_t peak_size() const;
+
+  // How long the oldest open decision has been open, or zero if none are
+  std::chrono::milliseconds oldest_age(time_point now) const;
+
+  // The open trigger numbers, in order
+  std::vector<dfmessages::trigger_number_t> open_trigger_numbers() const;
+
+private:
+  struct Entry
+  {
+    time_point opened;
+    int64_t deadline_tick; // -1 when not armed
+    int resends;
+    bool journaled;
+    dfmessages::TriggerDecision decision;
+  };
+
+  int64_t tick_of(time_point t) const { return t.time_since_epoch() / m_resolution; }
+  void arm(dfmessages::trigger_number_t trigger_number, Entry& entry, time_point now);
+  void expect_late_tokens(dfmessages::trigger_number_t trigger_number, int count);
+
+  std::chrono::milliseconds m_timeout{ 0 };
+  std::chrono::milliseconds m_resolution{ 10 };
+  size_t m_journal_capacity{ 0 };
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<dfmessages::trigger_number_t, Entry> m_open;
+  size_t m_journaled{ 0 };
+  size_t m_peak_size{ 0 };
+
+  // The wheel: bucket i holds the decisions due at ticks t with t % size == i
+  std::vector<std::vector<dfmessages::trigger_number_t>> m_wheel;
+  int64_t m_last_tick{ -1 };
+
+  // The tokens still to come for recently closed or reclaimed decisions, and their order, oldest first
+  std::unordered_map<dfmessages::trigger_number_t, int> m_late_tokens;
+  std::deque<dfmessages::trigger_number_t> m_late_token_order;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_OPENDECISIONTRACKER_HPP_
@@ -0,0 +1,143 @@
+/**
+ * @file RateSchedule.hpp RateSchedule Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_RATESCHEDULE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_RATESCHEDULE_HPP_
+
+#include "trigemu/StatusPage.hpp"
+
+#include "dfmessages/Types.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+struct RateStep
+{
+  double rate_hz;
+  std::chrono::milliseconds duration;
+};
+
+/**
+ * @brief Parameters of a rate schedule. Which ones are used depends on
+ * the model: see make_rate_steps()
+ */
+struct RateScheduleParams
+{
+  // "none", "staircase", "linear" or "exponential"
+  std::string model{ "none" };
+  // The steps themselves ("staircase")
+  std::vector<RateStep> steps;
+  // Rates of the first and last steps, the number of steps and the length of each ("linear", "exponential")
+  double start_rate_hz{ 0 };
+  double end_rate_hz{ 0 };
+  size_t step_count{ 0 };
+  std::chrono::milliseconds step_duration{ 0 };
+};
+
+/**
+ * @brief The steps of the schedule: as given for "staircase", or
+ * step_count steps from start_rate_hz to end_rate_hz, evenly spaced
+ * for "linear" or in a geometric progression for "exponential". Empty
+ * for "none"
+ * @throws InvalidRateSchedule for unknown models or unusable parameters
+ */
+std::vector<RateStep>
+make_rate_steps(const RateScheduleParams& params);
+
+// How one step of a schedule went
+struct RateStepReport
+{
+  size_t step;
+  double requested_rate_hz;
+  double achieved_rate_hz;      ///< Triggers sent per second of DAQ time
+  uint64_t triggers;            ///< Triggers sent NOLINT(build/unsigned)
+  uint64_t skipped;             ///< Triggers skipped, inhibited or for lack of tokens NOLINT(build/unsigned)
+  double inhibited_fraction;    ///< Of the step's wall time
+  uint64_t token_starved_us;    // NOLINT(build/unsigned)
+  uint64_t lateness_p50_us;     // NOLINT(build/unsigned)
+  uint64_t lateness_p90_us;     // NOLINT(build/unsigned)
+  uint64_t lateness_p99_us;     // NOLINT(build/unsigned)
+  uint64_t lateness_max_us;     // NOLINT(build/unsigned)
+  bool saturated;               ///< Dataflow didn't keep up: see RateSchedule
+};
+
+/**
+ * @brief Steps the trigger rate through a schedule within a run, for
+ * capacity scans, and tallies how each step went.
+ *
+ * The steps are laid out in DAQ time from the trigger given to start(),
+ * so they don't depend on how promptly the triggers are sent, and
+ * sharded instances agree on them. A step's rate is that of all the
+ * trigger streams together: each stream gets its configured share of
+ * it. A step counts as saturated when more than `saturation_tolerance`
+ * of its triggers were skipped, or dataflow inhibited triggers for more
+ * than that fraction of it.
+ *
+ * Used by the sending thread only.
+ */
+class RateSchedule
+{
+public:
+  /**
+   * @param reference_interval_ticks the trigger interval at which the
+   * streams, together, have a mean rate of `reference_rate_hz`
+   */
+  RateSchedule(std::vector<RateStep> steps,
+               uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+               dfmessages::timestamp_t reference_interval_ticks,
+               double reference_rate_hz,
+               double saturation_tolerance);
+
+  // Lay out the steps from the trigger at `first`
+  void start(dfmessages::timestamp_t first);
+
+  // The step a trigger at `timestamp` is in: get_step_count() once the schedule is over
+  size_t step_at(dfmessages::timestamp_t timestamp) const;
+
+  size_t get_step_count() const { return m_steps.size(); }
+  const RateStep& get_step(size_t step) const { return m_steps[step]; }
+
+  // The trigger interval (as resume sets it) at which the streams, together, have the rate of `step`
+  dfmessages::timestamp_t get_interval_ticks(size_t step) const;
+
+  // Tally the triggers of `step` from now on
+  void begin_step(size_t step);
+  void count_sent(uint64_t lateness_us); // NOLINT(build/unsigned)
+  void count_skipped() { ++m_skipped; }
+
+  // The report on the current step, which ran until the trigger timestamp `end`
+  RateStepReport end_step(dfmessages::timestamp_t end, double inhibited_fraction, uint64_t token_starved_us); // NOLINT
+
+private:
+  std::vector<RateStep> m_steps;
+  uint64_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+  dfmessages::timestamp_t m_reference_interval_ticks;
+  double m_reference_rate_hz;
+  double m_saturation_tolerance;
+  // Where each step starts, and where the last one ends
+  std::vector<dfmessages::timestamp_t> m_step_starts;
+
+  size_t m_step{ 0 };
+  uint64_t m_sent{ 0 };    // NOLINT(build/unsigned)
+  uint64_t m_skipped{ 0 }; // NOLINT(build/unsigned)
+  uint64_t m_lateness_count{ 0 };                                           // NOLINT(build/unsigned)
+  uint64_t m_lateness_max_us{ 0 };                                          // NOLINT(build/unsigned)
+  std::array<uint64_t, statuspage::s_lateness_bins> m_lateness_us_bins{}; // NOLINT(build/unsigned)
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_RATESCHEDULE_HPP_
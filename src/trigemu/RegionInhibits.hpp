@@ -0,0 +1,151 @@
+/**
+ * @file RegionInhibits.hpp RegionInhibits Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_REGIONINHIBITS_HPP_
+#define TRIGEMU_SRC_TRIGEMU_REGIONINHIBITS_HPP_
+
+#include "trigemu/ThreadCounters.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief What to do with a trigger that reads out a busy region
+ */
+enum class RegionInhibitPolicy
+{
+  kMask,  ///< Leave the busy region's components out of the decision. It's dropped if none are left
+  kStream ///< Skip the triggers of every stream with links in the busy region. The other streams carry on
+};
+
+/**
+ * @brief Parse "mask" or "stream"
+ * @throws InvalidRegionInhibitPolicy for anything else
+ */
+RegionInhibitPolicy
+parse_region_inhibit_policy(const std::string& name);
+
+/**
+ * @brief The busy state of groups of links ("regions"), each inhibited
+ * by its own TriggerInhibit connection, so that one busy region
+ * doesn't stop triggering for the whole detector.
+ *
+ * Links are matched by element id, as they are configured for the
+ * streams. A link may be in several regions. The busy state of all
+ * the regions is one bit each in a word, so the sending thread can
+ * tell whether anything is busy with a single load. There can be at
+ * most s_max_regions regions.
+ *
+ * configure() is only called between runs. set_busy() is called from
+ * the inhibit thread, and mask() and count_suppressed() from the
+ * sending thread.
+ */
+class RegionInhibits
+{
+public:
+  static constexpr size_t s_max_regions = 64;
+
+  struct Region
+  {
+    Region(const std::string& region_name, const std::vector<uint32_t>& region_links) // NOLINT(build/unsigned)
+      : name(region_name)
+      , links(region_links)
+    {}
+
+    std::string name;
+    std::vector<uint32_t> links; // NOLINT(build/unsigned)
+
+    StateTimer busy_time;
+    std::atomic<bool> busy{ false };
+    // Written by the sending thread only
+    std::atomic<uint64_t> masked_components{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> suppressed{ 0 };        // NOLINT(build/unsigned)
+    // What get_info() last reported
+    uint64_t reported_masked_components{ 0 }; // NOLINT(build/unsigned)
+    uint64_t reported_suppressed{ 0 };        // NOLINT(build/unsigned)
+    uint64_t reported_busy_us{ 0 };           // NOLINT(build/unsigned)
+  };
+
+  RegionInhibits() = default;
+
+  RegionInhibits(RegionInhibits const&) = delete;
+  RegionInhibits(RegionInhibits&&) = delete;
+  RegionInhibits& operator=(RegionInhibits const&) = delete;
+  RegionInhibits& operator=(RegionInhibits&&) = delete;
+
+  /**
+   * @brief Replace the regions, at conf
+   * @throws InvalidInhibitRegion if a name repeats or there are more than s_max_regions
+   */
+  void configure(RegionInhibitPolicy policy, std::vector<std::unique_ptr<Region>> regions);
+
+  // Nothing busy and the counters zeroed, at start of run
+  void reset();
+  // Close the busy spells, at stop, so the busy times are for the run
+  void end_run(uint64_t now_us); // NOLINT(build/unsigned)
+
+  void set_busy(size_t region, bool busy, uint64_t now_us); // NOLINT(build/unsigned)
+
+  // One bit for each busy region, by index
+  uint64_t busy_regions() const { return m_busy_regions.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+
+  RegionInhibitPolicy get_policy() const { return m_policy; }
+  size_t size() const { return m_regions.size(); }
+  const std::string& get_name(size_t region) const { return m_regions[region]->name; }
+
+  // The regions a link is in, one bit each
+  uint64_t regions_of(const dfmessages::GeoID& link) const; // NOLINT(build/unsigned)
+  uint64_t regions_of(const std::vector<dfmessages::GeoID>& links) const; // NOLINT(build/unsigned)
+  // The regions a decision's components are in
+  uint64_t regions_of(const dfmessages::TriggerDecision& decision) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief Take the components in the regions in `busy` out of `decision`,
+   * and count them against those regions
+   * @return the number of components taken out
+   */
+  size_t mask(dfmessages::TriggerDecision& decision, uint64_t busy); // NOLINT(build/unsigned)
+
+  // A trigger was skipped because the regions in `regions` were busy
+  void count_suppressed(uint64_t regions); // NOLINT(build/unsigned)
+
+  // Call `fn` on each region, with the regions locked against replacement
+  template<typename Fn>
+  void for_each_region(Fn&& fn)
+  {
+    std::lock_guard<std::mutex> lk(m_regions_mutex);
+    for (auto& region : m_regions) {
+      fn(*region);
+    }
+  }
+
+private:
+  RegionInhibitPolicy m_policy{ RegionInhibitPolicy::kMask };
+  std::vector<std::unique_ptr<Region>> m_regions;
+  // Protects m_regions against replacement at conf while get_info() reads them
+  std::mutex m_regions_mutex;
+  // The regions each link is in, by element id
+  std::unordered_map<uint32_t, uint64_t> m_link_regions; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_busy_regions{ 0 };             // NOLINT(build/unsigned)
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_REGIONINHIBITS_HPP_
@@ -0,0 +1,108 @@
+/**
+ * @file SPSCRing.hpp SPSCRing Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_SPSCRING_HPP_
+#define TRIGEMU_SRC_TRIGEMU_SPSCRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Bounded lock-free ring buffer for exactly one producer thread
+ * and one consumer thread.
+ *
+ * The slots are allocated once, up front, and items are copy-assigned
+ * into them and swapped out of them. For types like TriggerDecision,
+ * whose slots keep their vector capacity from one use to the next,
+ * pushing doesn't allocate once the ring has been round once.
+ */
+template<class T>
+class SPSCRing
+{
+public:
+  // The capacity is rounded up to a power of two
+  explicit SPSCRing(size_t capacity)
+    : m_slots(round_up_to_power_of_two(capacity))
+    , m_mask(m_slots.size() - 1)
+  {}
+
+  SPSCRing(SPSCRing const&) = delete;
+  SPSCRing(SPSCRing&&) = delete;
+  SPSCRing& operator=(SPSCRing const&) = delete;
+  SPSCRing& operator=(SPSCRing&&) = delete;
+
+  // Producer side. Returns false, without blocking, if the ring is full
+  bool try_push(const T& item)
+  {
+    return try_push_with([&item](T& slot) { slot = item; });
+  }
+
+  // The same, with `fill` writing the item into its slot in place
+  template<class Fill>
+  bool try_push_with(Fill&& fill)
+  {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_cached_tail == m_slots.size()) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head - m_cached_tail == m_slots.size()) {
+        return false;
+      }
+    }
+    fill(m_slots[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the ring is empty
+  bool try_pop(T& item)
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_cached_head) {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail == m_cached_head) {
+        return false;
+      }
+    }
+    using std::swap;
+    swap(item, m_slots[tail & m_mask]);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return m_slots.size(); }
+
+private:
+  static size_t round_up_to_power_of_two(size_t n)
+  {
+    size_t result = 1;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  std::vector<T> m_slots;
+  const size_t m_mask;
+
+  // Producer and consumer indices live on separate cache lines, each
+  // with the producer's (or consumer's) cached copy of the other one
+  alignas(64) std::atomic<size_t> m_head{ 0 };
+  size_t m_cached_tail{ 0 };
+  alignas(64) std::atomic<size_t> m_tail{ 0 };
+  size_t m_cached_head{ 0 };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_SPSCRING_HPP_
@@ -0,0 +1,80 @@
+/**
+ * @file SeqLock.hpp SeqLock Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_SEQLOCK_HPP_
+#define TRIGEMU_SRC_TRIGEMU_SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief A value of plain type T that one thread updates and any
+ * number of threads read, without locks.
+ *
+ * The writer makes the sequence number odd, copies the value in and
+ * makes the number even again; a reader copies the value out and
+ * tries again if the number was odd or changed meanwhile. Writing
+ * never waits for readers. The layout is fixed, so a SeqLock can also
+ * live in memory shared between processes.
+ */
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied bytewise");
+
+public:
+  // From one thread at a time
+  void store(const T& value)
+  {
+    uint64_t sequence = m_sequence.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&m_value, &value, sizeof(T));
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // A consistent copy of the value. Returns false if the writer kept it busy for `max_attempts` tries
+  bool try_load(T& value, int max_attempts) const
+  {
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+      uint64_t before = m_sequence.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+      if (before % 2 != 0) {
+        continue;
+      }
+      std::memcpy(&value, &m_value, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_sequence.load(std::memory_order_relaxed) == before) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // A consistent copy of the value, however long it takes
+  T load() const
+  {
+    T value;
+    while (!try_load(value, 1000)) {
+    }
+    return value;
+  }
+
+private:
+  std::atomic<uint64_t> m_sequence{ 0 }; // NOLINT(build/unsigned)
+  T m_value{};
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_SEQLOCK_HPP_
@@ -0,0 +1,130 @@
+/**
+ * @file ShardedTimeline.hpp ShardedTimeline Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_SHARDEDTIMELINE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_SHARDEDTIMELINE_HPP_
+
+#include "trigemu/TriggerStream.hpp"
+
+#include "dfmessages/Types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief The trigger timeline of a set of streams, numbered in slots,
+ * whose slots may be shared between several emulator instances.
+ *
+ * With sharding, every instance generates the whole timeline, and
+ * sends the triggers in the slots with slot % shard_count ==
+ * shard_index. For their slots to line up, the instances must agree on
+ * where the timeline starts and on the slot at which each change of
+ * interval takes effect, whatever their own estimate of the current
+ * time and whenever their own resume command arrived:
+ *
+ * - the timeline is started from the beginning of the current shard
+ *   epoch (see origin()), and the slots that have already passed are
+ *   skipped;
+ * - a change of interval from set_intervals() takes effect at the first
+ *   trigger of the next epoch, unless it comes from something that
+ *   every instance does at the same slot, like a rate schedule step.
+ *
+ * So the instances have to be started, and resumed, within the same
+ * epoch. The caller must also pass every slot, its own or not, at the
+ * slot's due time, so that the instances move through the timeline
+ * together.
+ *
+ * The timeline also numbers the decisions. With sharding, each slot
+ * owns repeat_count trigger numbers, from slot * repeat_count + 1, so
+ * the instances never send the same number, whichever slots each of
+ * them skips. Without sharding the numbers follow the order the
+ * decisions are sent in, without gaps.
+ *
+ * Without sharding there is one instance, the timeline starts from the
+ * current time, and changes take effect at the next trigger.
+ */
+class ShardedTimeline
+{
+public:
+  ShardedTimeline(uint64_t shard_count,                   // NOLINT(build/unsigned)
+                  uint64_t shard_index,                   // NOLINT(build/unsigned)
+                  dfmessages::timestamp_t epoch_ticks,
+                  int repeat_count);
+
+  bool is_sharded() const { return m_shard_count > 1; }
+
+  // Where the timeline starts, given the current time estimate
+  dfmessages::timestamp_t origin(dfmessages::timestamp_t estimate) const;
+  // The start of the epoch after the one `timestamp` is in: `timestamp` itself without sharding
+  dfmessages::timestamp_t next_epoch(dfmessages::timestamp_t timestamp) const;
+
+  // Add a stream whose first trigger is at `first`, before the first advance()
+  void add_stream(std::unique_ptr<ArrivalModel> model, dfmessages::timestamp_t first)
+  {
+    m_merger.add_stream(std::move(model), first);
+  }
+
+  // The next trigger, from the streams, and the stream it belongs to
+  dfmessages::timestamp_t front_timestamp() const { return m_merger.front_timestamp(); }
+  size_t front_stream() const { return m_merger.front_stream(); }
+
+  // The position of the next trigger in the timeline, counting from zero at the origin
+  uint64_t slot() const { return m_slot; } // NOLINT(build/unsigned)
+  // Whether the next trigger is this instance's to send
+  bool owns_slot() const { return owns(m_slot); }
+  // This instance's first slot from `slot` on
+  uint64_t next_owned_slot(uint64_t slot) const; // NOLINT(build/unsigned)
+  // The slot of trigger `i` of the stop burst, which takes this instance's slots from the next trigger on
+  uint64_t stop_burst_slot(int i) const; // NOLINT(build/unsigned)
+
+  /**
+   * @brief The number of the first decision sent for the trigger in
+   * `slot`, given the number of the last decision this instance sent.
+   * Its repeats take the numbers after it
+   */
+  dfmessages::trigger_number_t trigger_number(uint64_t slot, // NOLINT(build/unsigned)
+                                              dfmessages::trigger_number_t last_sent) const;
+
+  /**
+   * @brief Change the streams' intervals, one for each stream in the
+   * order they were added. `at_once` applies them from the next trigger
+   * on even with sharding: only for changes that every instance makes
+   * at the same slot
+   */
+  void set_intervals(const std::vector<dfmessages::timestamp_t>& intervals_ticks, bool at_once);
+
+  // Move on to the next trigger of the streams
+  void advance();
+  // Move on to the next slot without touching the streams, for triggers that come from elsewhere, eg a trace
+  void advance_slot() { ++m_slot; }
+
+private:
+  bool owns(uint64_t slot) const { return slot % m_shard_count == m_shard_index; } // NOLINT(build/unsigned)
+
+  uint64_t m_shard_count;                  // NOLINT(build/unsigned)
+  uint64_t m_shard_index;                  // NOLINT(build/unsigned)
+  dfmessages::timestamp_t m_epoch_ticks;
+  int m_repeat_count;
+
+  TriggerStreamMerger m_merger;
+  uint64_t m_slot{ 0 }; // NOLINT(build/unsigned)
+
+  // A change of interval waiting for the trigger at or after m_change_at
+  std::vector<dfmessages::timestamp_t> m_pending_intervals;
+  dfmessages::timestamp_t m_change_at{ 0 };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_SHARDEDTIMELINE_HPP_
@@ -0,0 +1,50 @@
+/**
+ * @file SharedTimestampEstimator.hpp acquire_shared_timestamp_estimator function
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_SHAREDTIMESTAMPESTIMATOR_HPP_
+#define TRIGEMU_SRC_TRIGEMU_SHAREDTIMESTAMPESTIMATOR_HPP_
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/TimestampEstimator.hpp"
+
+#include "iomanager/Receiver.hpp"
+
+#include "dfmessages/TimeSync.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief A TimestampEstimator shared by all the modules in the process
+ * that read TimeSyncs from `connection_uid` in the same run, with the
+ * same clock frequency and the same kind of clock (see make_clock).
+ *
+ * The first module to ask for one starts it, and the others get the
+ * same one, so there's one thread and one consumer on the TimeSync
+ * queue, which sees all the TimeSyncs, however many modules there are.
+ * It's stopped when the last of them lets go of it, normally at stop,
+ * and the next run starts a new one.
+ *
+ * A shared estimator doesn't record on any module's timeline, since it
+ * may outlive the module that started it.
+ */
+std::shared_ptr<TimestampEstimator>
+acquire_shared_timestamp_estimator(const std::string& connection_uid,
+                                   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> time_sync_source,
+                                   uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+                                   dfmessages::run_number_t run_number,
+                                   std::shared_ptr<Clock> clock);
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_SHAREDTIMESTAMPESTIMATOR_HPP_
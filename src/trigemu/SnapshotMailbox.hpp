@@ -0,0 +1,59 @@
+/**
+ * @file SnapshotMailbox.hpp SnapshotMailbox Class
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_SNAPSHOTMAILBOX_HPP_
+#define TRIGEMU_SRC_TRIGEMU_SNAPSHOTMAILBOX_HPP_
+
+#include <atomic>
+#include <memory>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Hands immutable snapshots (of a configuration, say) from any
+ * thread to the one thread that uses them, with an atomic pointer swap.
+ *
+ * publish() replaces the snapshot waiting in the box, if the user
+ * hasn't taken it yet. take() empties the box. The user owns what it
+ * takes, so it can keep using its current snapshot, without locks or
+ * reference counts, until it chooses to take the next one; nothing is
+ * freed while it's in use.
+ */
+template<typename T>
+class SnapshotMailbox
+{
+public:
+  SnapshotMailbox() = default;
+  ~SnapshotMailbox() { delete m_pending.exchange(nullptr); }
+
+  SnapshotMailbox(SnapshotMailbox const&) = delete;
+  SnapshotMailbox(SnapshotMailbox&&) = delete;
+  SnapshotMailbox& operator=(SnapshotMailbox const&) = delete;
+  SnapshotMailbox& operator=(SnapshotMailbox&&) = delete;
+
+  void publish(std::unique_ptr<T> snapshot) { delete m_pending.exchange(snapshot.release(), std::memory_order_acq_rel); }
+
+  // The latest snapshot published since the last take(), or null. From the using thread
+  std::unique_ptr<T> take()
+  {
+    // Just a load when there's nothing new, which is nearly always
+    if (m_pending.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+    return std::unique_ptr<T>(m_pending.exchange(nullptr, std::memory_order_acq_rel));
+  }
+
+private:
+  std::atomic<T*> m_pending{ nullptr };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_SNAPSHOTMAILBOX_HPP_
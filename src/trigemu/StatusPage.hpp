@@ -0,0 +1,149 @@
+/**
+ * @file StatusPage.hpp StatusPage structure, StatusPageWriter and StatusPageReader Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_STATUSPAGE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_STATUSPAGE_HPP_
+
+#include "trigemu/SeqLock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+namespace trigemu {
+
+namespace statuspage {
+
+constexpr uint64_t s_magic = 0x5444455354415431ULL; // "TDESTAT1" NOLINT(build/unsigned)
+constexpr uint32_t s_version = 2;                    // NOLINT(build/unsigned)
+
+// Lateness histogram: 4 linear bins per power of two, up to 2^40 us
+constexpr size_t s_lateness_bins = 160;
+
+// Which bin a lateness in us goes in, and the largest lateness the bin holds
+size_t
+lateness_bin(uint64_t lateness_us); // NOLINT(build/unsigned)
+uint64_t                            // NOLINT(build/unsigned)
+lateness_bin_upper_us(size_t bin);
+
+enum class State : uint64_t // NOLINT(build/unsigned)
+{
+  kStopped,
+  kRunning,
+  kPaused
+};
+
+/**
+ * @brief What the emulator publishes: cumulative counters for the run
+ * and its current state. Plain data, copied in and out as a whole
+ */
+struct Status
+{
+  uint64_t update_time_us;          ///< System time of the last update NOLINT(build/unsigned)
+  uint64_t run_number;              // NOLINT(build/unsigned)
+  State state;
+  uint64_t triggers;                ///< Decisions sent in this run NOLINT(build/unsigned)
+  uint64_t inhibited;               ///< Triggers skipped for lack of tokens NOLINT(build/unsigned)
+  uint64_t decisions_not_sent;      ///< Decisions no sink accepted NOLINT(build/unsigned)
+  uint64_t tokens_received;         // NOLINT(build/unsigned)
+  int64_t tokens_available;
+  uint64_t open_decisions;          // NOLINT(build/unsigned)
+  uint64_t last_trigger_number;     // NOLINT(build/unsigned)
+  uint64_t last_trigger_timestamp;  // NOLINT(build/unsigned)
+  uint64_t timestamp_estimate;      // NOLINT(build/unsigned)
+  int64_t time_sync_age_us;         ///< -1 if there hasn't been a TimeSync
+  /// How late each decision was sent, after its timestamp plus the trigger delay
+  uint64_t lateness_count;                        // NOLINT(build/unsigned)
+  uint64_t lateness_max_us;                       // NOLINT(build/unsigned)
+  uint64_t lateness_us_bins[s_lateness_bins];     // NOLINT(build/unsigned)
+};
+
+// The lateness below which fraction `q` of the decisions fell, to the resolution of the histogram
+uint64_t // NOLINT(build/unsigned)
+lateness_percentile_us(const Status& status, double q);
+// The same, for any histogram of s_lateness_bins bins
+uint64_t                                                                                 // NOLINT(build/unsigned)
+lateness_percentile_us(const uint64_t* bins, uint64_t count, uint64_t max_us, double q); // NOLINT(build/unsigned)
+
+// The layout of the shared memory segment
+struct Page
+{
+  uint64_t magic;          // NOLINT(build/unsigned)
+  uint32_t version;        // NOLINT(build/unsigned)
+  uint32_t status_bytes;   // NOLINT(build/unsigned)
+  int64_t writer_pid;      ///< The process that publishes the page
+  SeqLock<Status> status;
+};
+
+} // namespace statuspage
+
+/**
+ * @brief Publishes a statuspage::Status in a named POSIX shared memory
+ * segment, for external monitors to sample without involving the DAQ
+ * process.
+ *
+ * The status is behind a SeqLock, so writing never waits for
+ * readers. The segment belongs to one writer, and is removed when the
+ * writer is destroyed.
+ */
+class StatusPageWriter
+{
+public:
+  /**
+   * @brief Create the segment `name` (eg "/trigemu-tde"). A status page
+   * of that name left behind by a process that has gone is replaced
+   * @throws StatusPageError if it can't be created, or if another writer is using the name
+   */
+  explicit StatusPageWriter(const std::string& name);
+  ~StatusPageWriter();
+
+  StatusPageWriter(StatusPageWriter const&) = delete;
+  StatusPageWriter(StatusPageWriter&&) = delete;
+  StatusPageWriter& operator=(StatusPageWriter const&) = delete;
+  StatusPageWriter& operator=(StatusPageWriter&&) = delete;
+
+  // From one thread at a time
+  void publish(const statuspage::Status& status);
+
+private:
+  std::string m_name;
+  statuspage::Page* m_page{ nullptr };
+};
+
+/**
+ * @brief Reads the status published by a StatusPageWriter, from any
+ * process
+ */
+class StatusPageReader
+{
+public:
+  /**
+   * @brief Map the segment `name` read-only
+   * @throws StatusPageError if it doesn't exist, or isn't a status page of this version
+   */
+  explicit StatusPageReader(const std::string& name);
+  ~StatusPageReader();
+
+  StatusPageReader(StatusPageReader const&) = delete;
+  StatusPageReader(StatusPageReader&&) = delete;
+  StatusPageReader& operator=(StatusPageReader const&) = delete;
+  StatusPageReader& operator=(StatusPageReader&&) = delete;
+
+  // A consistent copy of the status. Returns false if the writer kept it busy for `max_attempts` tries
+  bool read(statuspage::Status& status, int max_attempts = 1000) const;
+
+private:
+  std::string m_name;
+  const statuspage::Page* m_page{ nullptr };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_STATUSPAGE_HPP_
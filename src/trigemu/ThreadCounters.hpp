@@ -0,0 +1,115 @@
+/**
+ * @file ThreadCounters.hpp ThreadCounters and StateTimer Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_THREADCOUNTERS_HPP_
+#define TRIGEMU_SRC_TRIGEMU_THREADCOUNTERS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+namespace dunedaq {
+namespace trigemu {
+
+// CPU time used so far by the calling thread, in us
+inline uint64_t // NOLINT(build/unsigned)
+thread_cpu_time_us()
+{
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000; // NOLINT
+}
+
+/**
+ * @brief The counters of one thread, indexed by the enum `Index`, which
+ * ends with `kCount`.
+ *
+ * Only the owning thread writes the counters, so it updates them with a
+ * plain load and store rather than an atomic read-modify-write, and
+ * each block has its own cache lines, so that threads counting don't
+ * contend with each other or with the monitoring thread reading them.
+ */
+template<typename Index>
+class ThreadCounters
+{
+public:
+  static constexpr size_t s_size = static_cast<size_t>(Index::kCount);
+
+  void add(Index i, uint64_t n = 1) // NOLINT(build/unsigned)
+  {
+    auto& value = m_values[static_cast<size_t>(i)];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  uint64_t get(Index i) const { return m_values[static_cast<size_t>(i)].load(std::memory_order_relaxed); } // NOLINT
+
+  // Record the owning thread's CPU time so far
+  void sample_cpu_time() { m_cpu_time_us.store(thread_cpu_time_us(), std::memory_order_relaxed); }
+  uint64_t get_cpu_time_us() const { return m_cpu_time_us.load(std::memory_order_relaxed); } // NOLINT
+
+  // Only while the owning thread isn't running
+  void reset()
+  {
+    for (auto& value : m_values) {
+      value.store(0, std::memory_order_relaxed);
+    }
+    m_cpu_time_us.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  alignas(64) std::array<std::atomic<uint64_t>, s_size> m_values{}; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_cpu_time_us{ 0 };                          // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Accumulates the time spent in an on/off state, such as
+ * inhibited. set() is called by one thread, on each change of state;
+ * total_us() may be called from any thread.
+ */
+class StateTimer
+{
+public:
+  void set(bool on, uint64_t now_us) // NOLINT(build/unsigned)
+  {
+    int64_t since = m_on_since_us.load();
+    if (on && since < 0) {
+      m_on_since_us.store(static_cast<int64_t>(now_us));
+    } else if (!on && since >= 0) {
+      m_total_us.store(m_total_us.load() + (now_us - static_cast<uint64_t>(since))); // NOLINT(build/unsigned)
+      m_on_since_us.store(-1);
+    }
+  }
+
+  // Time spent on, including the current spell
+  uint64_t total_us(uint64_t now_us) const // NOLINT(build/unsigned)
+  {
+    uint64_t total = m_total_us.load(); // NOLINT(build/unsigned)
+    int64_t since = m_on_since_us.load();
+    if (since >= 0 && now_us > static_cast<uint64_t>(since)) { // NOLINT(build/unsigned)
+      total += now_us - static_cast<uint64_t>(since);          // NOLINT(build/unsigned)
+    }
+    return total;
+  }
+
+  void reset()
+  {
+    m_on_since_us.store(-1);
+    m_total_us.store(0);
+  }
+
+private:
+  std::atomic<int64_t> m_on_since_us{ -1 };   // -1 when off
+  std::atomic<uint64_t> m_total_us{ 0 };      // NOLINT(build/unsigned)
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_THREADCOUNTERS_HPP_
@@ -0,0 +1,129 @@
+/**
+ * @file TimeSyncFile.hpp Binary file format for recorded TimeSync streams
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_TIMESYNCFILE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_TIMESYNCFILE_HPP_
+
+#include "dfmessages/TimeSync.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+namespace timesyncfile {
+
+// A TimeSync file is a FileHeader followed by one Record for every
+// TimeSync received, in the order they were received. Everything is
+// stored in host byte order. As with decision files, a record that is
+// cut short at the end of the file is treated as the end of the file.
+
+constexpr char s_magic[8] = { 'T', 'D', 'E', 'T', 'S', 'Y', 'N', '\0' };
+constexpr uint32_t s_version = 1; // NOLINT(build/unsigned)
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;            // NOLINT(build/unsigned)
+  uint32_t header_size;        // NOLINT(build/unsigned)
+  uint64_t clock_frequency_hz; // NOLINT(build/unsigned)
+  uint32_t run_number;         // NOLINT(build/unsigned) The run the stream was recorded in
+  uint32_t reserved;           // NOLINT(build/unsigned)
+};
+static_assert(sizeof(FileHeader) == 32);
+
+struct Record
+{
+  uint64_t daq_time;        // NOLINT(build/unsigned)
+  uint64_t system_time;     // NOLINT(build/unsigned)
+  uint64_t arrival_us;      // NOLINT(build/unsigned) When the recorder got it, by its clock
+  uint64_t sequence_number; // NOLINT(build/unsigned)
+  uint32_t run_number;      // NOLINT(build/unsigned)
+  uint32_t source_pid;      // NOLINT(build/unsigned)
+};
+static_assert(sizeof(Record) == 40);
+
+inline FileHeader
+make_file_header(uint64_t clock_frequency_hz, dfmessages::run_number_t run_number) // NOLINT(build/unsigned)
+{
+  FileHeader header{};
+  std::memcpy(header.magic, s_magic, sizeof(s_magic));
+  header.version = s_version;
+  header.header_size = sizeof(FileHeader);
+  header.clock_frequency_hz = clock_frequency_hz;
+  header.run_number = run_number;
+  return header;
+}
+
+inline bool
+is_valid_header(const FileHeader& header)
+{
+  return std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0 && header.version == s_version &&
+         header.header_size >= sizeof(FileHeader);
+}
+
+} // namespace timesyncfile
+
+/**
+ * @brief Records the TimeSyncs a module receives, with when it received
+ * them, to <prefix>_run<run number>.tdets
+ *
+ * TimeSyncs arrive at a few Hz at most, so records are written straight
+ * through a stdio buffer from the receiving thread, which is flushed
+ * every `s_flush_interval` records and at close(). Not thread-safe: one
+ * thread records.
+ */
+class TimeSyncRecorder
+{
+public:
+  TimeSyncRecorder(const std::string& prefix,
+                   dfmessages::run_number_t run_number,
+                   uint64_t clock_frequency_hz); // NOLINT(build/unsigned)
+
+  ~TimeSyncRecorder() { close(); }
+
+  TimeSyncRecorder(TimeSyncRecorder const&) = delete;
+  TimeSyncRecorder(TimeSyncRecorder&&) = delete;
+  TimeSyncRecorder& operator=(TimeSyncRecorder const&) = delete;
+  TimeSyncRecorder& operator=(TimeSyncRecorder&&) = delete;
+
+  void record(const dfmessages::TimeSync& time_sync, uint64_t arrival_us); // NOLINT(build/unsigned)
+
+  void close();
+
+  const std::string& get_path() const { return m_path; }
+  uint64_t get_recorded_count() const { return m_recorded_count; } // NOLINT(build/unsigned)
+
+private:
+  static constexpr uint64_t s_flush_interval = 16; // NOLINT(build/unsigned)
+
+  std::string m_path;
+  std::FILE* m_file{ nullptr };
+  uint64_t m_recorded_count{ 0 }; // NOLINT(build/unsigned)
+  bool m_write_failed{ false };
+};
+
+// A whole TimeSync file, read into memory
+struct TimeSyncTrace
+{
+  timesyncfile::FileHeader header;
+  std::vector<timesyncfile::Record> records;
+};
+
+// Throws TimeSyncFileError if the file can't be read or isn't a TimeSync file
+TimeSyncTrace
+read_time_sync_file(const std::string& path);
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_TIMESYNCFILE_HPP_
@@ -0,0 +1,150 @@
+/**
+ * @file Timeline.hpp Timeline and TimelineBuffer Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_TIMELINE_HPP_
+#define TRIGEMU_SRC_TRIGEMU_TIMELINE_HPP_
+
+#include "trigemu/Clock.hpp"
+
+#include "dfmessages/Types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief The things that happen to a trigger decision, and around it,
+ * that a Timeline records
+ */
+enum class TimelineEvent : uint8_t // NOLINT(build/unsigned)
+{
+  kScheduled,    ///< A trigger timestamp came up on the schedule. arg = trigger timestamp
+  kCreated,      ///< A decision was created. id = trigger number, arg = trigger timestamp
+  kSent,         ///< A decision was accepted by a sink. id = trigger number
+  kNotSent,      ///< No sink accepted a decision. id = trigger number
+  kSkipped,      ///< A trigger wasn't sent. arg = 0 if inhibited or paused, 1 for lack of tokens, 2 if expired,
+                 ///< 3 if regions it reads out were busy
+  kRetired,      ///< A decision's token came back. id = trigger number
+  kStale,        ///< A decision's token didn't come back in time. id = trigger number
+  kInhibit,      ///< A TriggerInhibit arrived. id = 0, or 1 + the index of the region it's for. arg = 1 if busy
+  kTimeSync,     ///< A TimeSync arrived. arg = its DAQ time
+  kTimeSyncSent, ///< A TimeSync was sent. arg = its DAQ time
+  kInhibitSent,  ///< A TriggerInhibit was sent. arg = 1 if busy
+  kTokenSent     ///< A token was sent
+};
+
+/**
+ * @brief The events of one thread: a fixed-size ring that keeps the
+ * most recent `capacity` events.
+ *
+ * Only the owning thread writes to it, with plain stores and no
+ * locks, so recording an event costs a clock read and a 32-byte copy.
+ * The time is read from the module's Clock, so that with a virtual
+ * clock the timeline is in simulated time. It's read once the thread
+ * has been joined.
+ */
+class TimelineBuffer
+{
+public:
+  struct Event
+  {
+    int64_t time_ns;
+    uint64_t id;  // NOLINT(build/unsigned)
+    uint64_t arg; // NOLINT(build/unsigned)
+    TimelineEvent type;
+  };
+
+  TimelineBuffer(const std::string& thread_name, size_t capacity, std::shared_ptr<Clock> clock);
+
+  TimelineBuffer(TimelineBuffer const&) = delete;
+  TimelineBuffer(TimelineBuffer&&) = delete;
+  TimelineBuffer& operator=(TimelineBuffer const&) = delete;
+  TimelineBuffer& operator=(TimelineBuffer&&) = delete;
+
+  void record(TimelineEvent type, uint64_t id = 0, uint64_t arg = 0) // NOLINT(build/unsigned)
+  {
+    auto time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_clock->now().time_since_epoch()).count();
+    m_events[m_next++ & m_mask] = Event{ time_ns, id, arg, type };
+  }
+
+  const std::string& get_thread_name() const { return m_thread_name; }
+
+  // The events still in the ring, oldest first, and how many were overwritten
+  std::vector<Event> get_events() const;
+  uint64_t get_overwritten_count() const; // NOLINT(build/unsigned)
+
+private:
+  std::string m_thread_name;
+  std::shared_ptr<Clock> m_clock;
+  std::vector<Event> m_events;
+  size_t m_mask;
+  uint64_t m_next{ 0 }; // NOLINT(build/unsigned)
+};
+
+// Record an event if the timeline is on, ie if `buffer` isn't null
+inline void
+record_timeline_event(TimelineBuffer* buffer, TimelineEvent type, uint64_t id = 0, uint64_t arg = 0) // NOLINT
+{
+  if (buffer != nullptr) {
+    buffer->record(type, id, arg);
+  }
+}
+
+/**
+ * @brief Collects the TimelineBuffers of a module's threads over a run,
+ * and writes them out as a Chrome trace-event JSON file, which can be
+ * opened in Perfetto or chrome://tracing.
+ *
+ * Each decision appears as an async slice from its creation to the
+ * return of its token, with its sends and staleness marked on it, and
+ * the other events as instants on the thread that saw them.
+ */
+class Timeline
+{
+public:
+  Timeline() = default;
+
+  Timeline(Timeline const&) = delete;
+  Timeline(Timeline&&) = delete;
+  Timeline& operator=(Timeline const&) = delete;
+  Timeline& operator=(Timeline&&) = delete;
+
+  // Start collecting again, with `capacity` events per thread (rounded up to a power of two), timed by `clock`
+  void reset(size_t capacity, std::shared_ptr<Clock> clock = make_clock(false));
+
+  // A buffer for a thread to record into. It lives until the next reset()
+  TimelineBuffer* add_thread(const std::string& thread_name);
+
+  /**
+   * @brief Write out all the buffers. Only once the threads that
+   * record into them have been joined
+   * @throws RecordingError if the file can't be written
+   */
+  void write(const std::string& path) const;
+
+  // Write out the buffers to <prefix>_run<run number>.json, with a warning rather than an exception on failure
+  void write_for_run(const std::string& prefix, dfmessages::run_number_t run_number) const;
+
+private:
+  size_t m_capacity{ 0 };
+  std::shared_ptr<Clock> m_clock;
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<TimelineBuffer>> m_buffers;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_TIMELINE_HPP_
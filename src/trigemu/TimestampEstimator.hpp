@@ -1,7 +1,7 @@
 /**
  * @file TimestampEstimator.hpp TimestampEstimator Class
  *
- * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
  * received with this code.
  */
@@ -9,6 +9,13 @@
 #ifndef TRIGEMU_SRC_TRIGEMU_TIMESTAMPESTIMATOR_HPP_
 #define TRIGEMU_SRC_TRIGEMU_TIMESTAMPESTIMATOR_HPP_
 
+#include "trigemu/Clock.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/SeqLock.hpp"
+#include "trigemu/ThreadCounters.hpp"
+#include "trigemu/TimeSyncFile.hpp"
+#include "trigemu/Timeline.hpp"
+
 #include "iomanager/Receiver.hpp"
 
 #include "dfmessages/TimeSync.hpp"
@@ -16,6 +23,7 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <thread>
 
 namespace dunedaq {
@@ -24,26 +32,96 @@ namespace trigemu {
 class TimestampEstimator
 {
 public:
+  // A consistent view of the estimate and of what it's based on
+  struct Snapshot
+  {
+    bool valid{ false }; ///< false until the first TimeSync of the run
+    dfmessages::timestamp_t estimate{ dfmessages::TypeDefaults::s_invalid_timestamp };
+    // The TimeSync the estimate is extrapolated from
+    dfmessages::timestamp_t time_sync_daq_time{ dfmessages::TypeDefaults::s_invalid_timestamp };
+    uint64_t time_sync_system_time_us{ 0 }; // NOLINT(build/unsigned)
+    uint64_t age_us{ 0 };                   ///< Time since that TimeSync arrived NOLINT(build/unsigned)
+    double rate_hz{ 0 }; ///< DAQ clock rate fitted to the TimeSyncs; the nominal rate until there are two
+    dfmessages::timestamp_t error_ticks{ 0 }; ///< Bound on the error of the estimate, now
+  };
+
   TimestampEstimator(std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source,
-                     uint64_t clock_frequency_hz); // NOLINT(build/unsigned)
+                     uint64_t clock_frequency_hz, // NOLINT(build/unsigned)
+                     dfmessages::run_number_t run_number,
+                     std::shared_ptr<Clock> clock = make_clock(false),
+                     TimelineBuffer* timeline = nullptr,
+                     TimeSyncRecorder* recorder = nullptr,
+                     const std::string& thread_name = "tde-ts-est");
 
   ~TimestampEstimator();
 
   TimestampEstimator(TimestampEstimator const&) = delete;
-  TimestampEstimator(TimestampEstimator&&) = default;
+  TimestampEstimator(TimestampEstimator&&) = delete;
   TimestampEstimator& operator=(TimestampEstimator const&) = delete;
-  TimestampEstimator& operator=(TimestampEstimator&&) = default;
+  TimestampEstimator& operator=(TimestampEstimator&&) = delete;
 
   dfmessages::timestamp_t get_timestamp_estimate() const { return m_current_timestamp_estimate.load(); }
 
+  // The estimate with its age, rate and error bound. Doesn't take any locks
+  Snapshot get_snapshot() const;
+
+  // Number of TimeSyncs that were dropped because they were stamped with a different run number
+  uint64_t get_other_run_time_sync_count() const { return m_other_run_time_sync_count.load(); } // NOLINT(build/unsigned)
+
+  // When the last TimeSync of this run arrived, by our clock, in us. 0 if none has yet
+  uint64_t get_last_time_sync_us() const { return m_last_time_sync_us.load(); } // NOLINT(build/unsigned)
+
+  // Number of TimeSyncs of this run received, and the longest gap between two of them, in us
+  uint64_t get_time_sync_count() const { return m_time_sync_count.load(); }           // NOLINT(build/unsigned)
+  uint64_t get_max_time_sync_gap_us() const { return m_max_time_sync_gap_us.load(); } // NOLINT(build/unsigned)
+
+  // CPU time used by the estimator thread, in us
+  uint64_t get_cpu_time_us() const { return m_cpu_time_us.load(); } // NOLINT(build/unsigned)
+
 private:
-  void estimator_thread_fn(std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source);
+  void estimator_thread_fn(std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>>& time_sync_source,
+                           const std::string& thread_name);
+
+  // Update the fitted rate and error from a TimeSync newer than `previous`
+  void fit_time_sync(const dfmessages::TimeSync& time_sync, const dfmessages::TimeSync& previous);
 
+  // What the estimator thread knows, published for get_snapshot()
+  struct Fit
+  {
+    bool valid{ false };
+    dfmessages::timestamp_t estimate{ dfmessages::TypeDefaults::s_invalid_timestamp };
+    uint64_t estimate_time_us{ 0 }; // When the estimate was made NOLINT(build/unsigned)
+    dfmessages::timestamp_t time_sync_daq_time{ dfmessages::TypeDefaults::s_invalid_timestamp };
+    uint64_t time_sync_system_time_us{ 0 }; // NOLINT(build/unsigned)
+    uint64_t time_sync_arrival_us{ 0 };     // NOLINT(build/unsigned)
+    double rate_hz{ 0 };
+    double residual_ticks{ 0 }; // Decaying maximum of the error in predicting each TimeSync from the last
+  };
   // The estimate of the current timestamp
   std::atomic<dfmessages::timestamp_t> m_current_timestamp_estimate{ dfmessages::TypeDefaults::s_invalid_timestamp };
 
   std::atomic<bool> m_running_flag{ false };
+  InterruptibleSleeper m_sleeper;
   uint64_t m_clock_frequency_hz; // NOLINT
+  dfmessages::run_number_t m_run_number;
+  std::atomic<uint64_t> m_other_run_time_sync_count{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_last_time_sync_us{ 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_time_sync_count{ 0 };           // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_time_sync_gap_us{ 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_cpu_time_us{ 0 };               // NOLINT(build/unsigned)
+  // Where the estimator thread records the TimeSyncs it gets, if anywhere
+  TimelineBuffer* m_timeline;
+  // Where the estimator thread records every TimeSync it receives, if anywhere
+  TimeSyncRecorder* m_recorder;
+  SeqLock<Fit> m_fit;
+  // The estimator thread's working copy. The rate starts out nominal
+  Fit m_working_fit{ false, dfmessages::TypeDefaults::s_invalid_timestamp,
+                     0,     dfmessages::TypeDefaults::s_invalid_timestamp,
+                     0,     0,
+                     static_cast<double>(m_clock_frequency_hz), 0 };
+  // The estimator thread, which is counted here rather than by the
+  // modules, since a shared estimator has one thread for all of them
+  Clock::Participant m_clock_participant;
   std::thread m_estimator_thread;
 };
 
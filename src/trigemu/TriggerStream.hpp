@@ -0,0 +1,97 @@
+/**
+ * @file TriggerStream.hpp TriggerStreamConf and TriggerStreamMerger Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_TRIGGERSTREAM_HPP_
+#define TRIGEMU_SRC_TRIGEMU_TRIGGERSTREAM_HPP_
+
+#include "trigemu/ArrivalModel.hpp"
+
+#include "daqdataformats/GeoID.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Everything that describes one stream of generated triggers:
+ * when they happen, their type, and what they read out
+ */
+struct TriggerStreamConf
+{
+  std::string name;
+  dfmessages::trigger_type_t trigger_type{ 0xff };
+  ArrivalModelParams arrival;
+
+  std::vector<dfmessages::GeoID> links;
+  int min_links_in_request{ 0 };
+  int max_links_in_request{ 0 };
+
+  daqdataformats::timestamp_diff_t trigger_window_offset{ 0 };
+  dfmessages::timestamp_t min_readout_window_ticks{ 0 };
+  dfmessages::timestamp_t max_readout_window_ticks{ 0 };
+};
+
+/**
+ * @brief Merges the trigger schedules of several streams into a single
+ * sequence in timestamp order. Triggers of different streams at the
+ * same timestamp come out in the order the streams were added
+ */
+class TriggerStreamMerger
+{
+public:
+  // Add a stream whose first trigger is at `first`. Streams are numbered from zero in the order they're added
+  void add_stream(std::unique_ptr<ArrivalModel> model, dfmessages::timestamp_t first)
+  {
+    m_schedules.emplace_back(std::move(model));
+    m_schedules.back().start(first);
+    m_queue.emplace(first, m_schedules.size() - 1);
+  }
+
+  bool empty() const { return m_queue.empty(); }
+
+  // The timestamp of the next trigger, and the stream it belongs to
+  dfmessages::timestamp_t front_timestamp() const { return m_queue.top().first; }
+  size_t front_stream() const { return m_queue.top().second; }
+
+  // Move on to the next trigger
+  void pop()
+  {
+    size_t stream = m_queue.top().second;
+    m_queue.pop();
+    auto& schedule = m_schedules[stream];
+    schedule.pop();
+    m_queue.emplace(schedule.front(), stream);
+  }
+
+  // Change the interval of one stream. Its next trigger, which is
+  // already in the queue, stays where it is
+  void set_interval(size_t stream, dfmessages::timestamp_t interval_ticks)
+  {
+    m_schedules[stream].set_interval(interval_ticks);
+  }
+
+private:
+  using Entry = std::pair<dfmessages::timestamp_t, size_t>;
+
+  std::vector<TriggerSchedule> m_schedules;
+  // Holds the next trigger of each stream, earliest on top
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_queue;
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_TRIGGERSTREAM_HPP_
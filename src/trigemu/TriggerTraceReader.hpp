@@ -0,0 +1,136 @@
+/**
+ * @file TriggerTraceReader.hpp TriggerTraceReader and TriggerTraceReplay Classes
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGEMU_SRC_TRIGEMU_TRIGGERTRACEREADER_HPP_
+#define TRIGEMU_SRC_TRIGEMU_TRIGGERTRACEREADER_HPP_
+
+#include "trigemu/DecisionFile.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "dfmessages/Types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigemu {
+
+/**
+ * @brief Sequential reader for a decision file (see DecisionFile.hpp).
+ *
+ * The file is memory-mapped rather than read into memory. Pages ahead
+ * of the read position are requested from the kernel in advance, and
+ * pages behind it are released, so traces much larger than RAM can be
+ * streamed at full rate.
+ */
+class TriggerTraceReader
+{
+public:
+  explicit TriggerTraceReader(const std::string& path);
+  ~TriggerTraceReader();
+
+  TriggerTraceReader(TriggerTraceReader const&) = delete;
+  TriggerTraceReader(TriggerTraceReader&&) = delete;
+  TriggerTraceReader& operator=(TriggerTraceReader const&) = delete;
+  TriggerTraceReader& operator=(TriggerTraceReader&&) = delete;
+
+  /**
+   * @brief Read the next decision in the file, and its record's flags
+   * (decisionfile::s_flag_repeat, s_flag_resent)
+   * @return false at the end of the file
+   */
+  bool next(dfmessages::TriggerDecision& decision, uint32_t& flags); // NOLINT(build/unsigned)
+  bool next(dfmessages::TriggerDecision& decision)
+  {
+    uint32_t flags; // NOLINT(build/unsigned)
+    return next(decision, flags);
+  }
+
+  // Go back to the first record
+  void rewind();
+
+  // Position the reader at the first record with no flags and a
+  // trigger_timestamp >= `timestamp`, using the index file if there is one
+  void seek_to_timestamp(dfmessages::timestamp_t timestamp);
+
+  const std::string& get_path() const { return m_path; }
+
+private:
+  // Issue madvise() calls for the window around the read position
+  void advise(size_t position);
+
+  void load_index();
+
+  std::string m_path;
+  int m_fd{ -1 };
+  const char* m_data{ nullptr };
+  size_t m_size{ 0 };
+  size_t m_first_record{ 0 };
+  size_t m_position{ 0 };
+  size_t m_advised_up_to{ 0 };
+
+  std::vector<decisionfile::IndexEntry> m_index;
+};
+
+/**
+ * @brief Turns the records of a trace file into decisions for the
+ * current run.
+ *
+ * The first replayed record (the first one at least
+ * `start_offset_ticks` after the start of the trace) is placed at the
+ * timestamp given to set_start_timestamp(). Later records keep their
+ * spacing from that first one, multiplied by `time_scale`. Readout
+ * windows keep their position and length relative to the trigger
+ * timestamp. With `loop` set, the
+ * trace is repeated indefinitely, each repetition following the
+ * previous one after the trace's mean trigger interval. Flagged
+ * records (repeats and resent decisions) are skipped, so each trigger
+ * of the trace is replayed once.
+ */
+class TriggerTraceReplay
+{
+public:
+  TriggerTraceReplay(const std::string& path,
+                     double time_scale,
+                     dfmessages::timestamp_t start_offset_ticks,
+                     bool loop);
+
+  // Set where the replay starts in the current run's timeline. Call before the first next()
+  void set_start_timestamp(dfmessages::timestamp_t timestamp) { m_pass_start = timestamp; }
+
+  /**
+   * @brief Fill the timestamp, type and components of the next replayed decision
+   * @return false when the trace is exhausted
+   */
+  bool next(dfmessages::TriggerDecision& decision);
+
+private:
+  // Position the reader at the start of the replayed section of the trace
+  void restart();
+  // The next record with no flags
+  bool next_trigger(dfmessages::TriggerDecision& record);
+
+  TriggerTraceReader m_reader;
+  double m_time_scale;
+  bool m_loop;
+
+  dfmessages::timestamp_t m_start_offset_ticks;
+  dfmessages::timestamp_t m_trace_start{ dfmessages::TypeDefaults::s_invalid_timestamp };
+  dfmessages::timestamp_t m_trace_last{ 0 };
+  uint64_t m_records_in_pass{ 0 }; // NOLINT(build/unsigned)
+
+  // Where the start of the current pass through the trace lands in the run
+  dfmessages::timestamp_t m_pass_start{ 0 };
+};
+
+} // namespace trigemu
+} // namespace dunedaq
+
+#endif // TRIGEMU_SRC_TRIGEMU_TRIGGERTRACEREADER_HPP_
@@ -0,0 +1,250 @@
+/**
+ * @file emitter_policy_benchmark.cxx
+ *
+ * Time the policies that TriggerDecisionEmulator's sending loop is
+ * compiled for (see EmitterPolicies.hpp): admitting the trigger,
+ * checking the inhibits and dispatching the decision to a sink that
+ * discards it. Each configuration is run once with the policies the
+ * emulator would pick for it, and once with a generic set that tests
+ * every choice at run time, as the loop did before it was specialised.
+ *
+ * This doesn't run send_trigger_decisions() itself, which needs a
+ * configured module with its connections, timestamp estimate and
+ * threads. emit() below is a stand-in that makes the same policy calls
+ * in the same order, so it measures what the specialisation changes,
+ * but not the rest of the loop: creating the decisions, the timeline,
+ * the recorder and the rate schedule, which are the same either way
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/CreditPool.hpp"
+#include "trigemu/DecisionDispatcher.hpp"
+#include "trigemu/EmitterPolicies.hpp"
+#include "trigemu/RegionInhibits.hpp"
+
+#include "iomanager/Sender.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+namespace {
+
+// Takes every decision, and drops it
+class NullSink : public iomanager::SenderConcept<dfmessages::TriggerDecision>
+{
+public:
+  void send(dfmessages::TriggerDecision&& /*decision*/, Sender::timeout_t /*timeout*/) override { ++m_sent; }
+
+private:
+  uint64_t m_sent{ 0 }; // NOLINT(build/unsigned)
+};
+
+// Takes tokens if there's a token source, which it looks up for every trigger, as the generic loop did
+class RuntimeAdmission
+{
+public:
+  explicit RuntimeAdmission(const std::atomic<TokenAdmission*>& token_source)
+    : m_token_source(token_source)
+  {}
+
+  int admit(int n)
+  {
+    auto tokens = m_token_source.load(std::memory_order_relaxed);
+    return tokens != nullptr ? tokens->admit(n) : n;
+  }
+  void give_back(int n)
+  {
+    if (auto tokens = m_token_source.load(std::memory_order_relaxed)) {
+      tokens->give_back(n);
+    }
+  }
+
+private:
+  const std::atomic<TokenAdmission*>& m_token_source;
+};
+
+struct Counts
+{
+  uint64_t sent{ 0 };    // NOLINT(build/unsigned)
+  uint64_t skipped{ 0 }; // NOLINT(build/unsigned)
+};
+
+// The policy-dependent steps for each of `triggers` triggers. Each token comes straight back
+template<typename Admission, typename InhibitSource, typename Dispatch>
+Counts
+emit(Admission admission,
+     InhibitSource inhibits,
+     Dispatch dispatch,
+     const dfmessages::TriggerDecision& decision,
+     uint64_t triggers) // NOLINT(build/unsigned)
+{
+  Counts counts;
+  for (uint64_t i = 0; i < triggers; ++i) { // NOLINT(build/unsigned)
+    if (inhibits.inhibited()) {
+      ++counts.skipped;
+      continue;
+    }
+    const int granted = admission.admit(1);
+    if (granted == 0 || inhibits.busy_regions() != 0) {
+      admission.give_back(granted);
+      ++counts.skipped;
+      continue;
+    }
+    if (dispatch.dispatch(decision)) {
+      ++counts.sent;
+    } else {
+      ++counts.skipped;
+    }
+    admission.give_back(granted);
+  }
+  return counts;
+}
+
+// The best of a few runs, to leave out the warming up and the other processes' interference
+template<typename Fn>
+double
+time_ns_per_trigger(Fn&& fn, uint64_t triggers) // NOLINT(build/unsigned)
+{
+  double best_ns = 0;
+  for (int run = 0; run < 5; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    Counts counts = fn();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (counts.sent + counts.skipped != triggers) {
+      std::cerr << "Lost count of the triggers" << std::endl;
+      std::exit(1);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / triggers;
+    best_ns = run == 0 ? ns : std::min(best_ns, ns);
+  }
+  return best_ns;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  if (argc > 2) {
+    std::cerr << "Usage: " << argv[0] << " [number of triggers]" << std::endl;
+    return 1;
+  }
+  const uint64_t triggers = argc == 2 ? std::stoull(argv[1]) : 10'000'000; // NOLINT(build/unsigned)
+
+  dfmessages::TriggerDecision decision;
+  decision.trigger_number = 1;
+  decision.trigger_timestamp = 1'000'000;
+  for (uint32_t link = 0; link < 10; ++link) { // NOLINT(build/unsigned)
+    dfmessages::ComponentRequest request;
+    request.component.element_id = link;
+    request.window_begin = decision.trigger_timestamp - 1000;
+    request.window_end = decision.trigger_timestamp + 1000;
+    decision.components.push_back(request);
+  }
+
+  std::atomic<bool> running{ true };
+  std::atomic<bool> inhibited{ false };
+  RegionInhibits regions;
+  std::vector<std::unique_ptr<RegionInhibits::Region>> region_list;
+  region_list.push_back(std::make_unique<RegionInhibits::Region>("apa0", std::vector<uint32_t>{ 0, 1, 2 })); // NOLINT
+  regions.configure(RegionInhibitPolicy::kMask, std::move(region_list));
+
+  CreditPool tokens(make_clock(false));
+  tokens.reset(10);
+  TokenAdmission token_admission(tokens, make_clock(false), std::chrono::milliseconds(0), false, running);
+
+  DecisionDispatcher one_sink;
+  one_sink.add_sink("sink", std::make_shared<NullSink>());
+  one_sink.configure(DispatchPolicy::kRoundRobin, std::chrono::milliseconds(10), std::chrono::milliseconds(100), false);
+  DecisionDispatcher three_sinks;
+  for (auto name : { "sink_a", "sink_b", "sink_c" }) {
+    three_sinks.add_sink(name, std::make_shared<NullSink>());
+  }
+  three_sinks.configure(
+    DispatchPolicy::kRoundRobin, std::chrono::milliseconds(10), std::chrono::milliseconds(100), false);
+
+  std::atomic<TokenAdmission*> no_token_source{ nullptr };
+  std::atomic<TokenAdmission*> token_source{ &token_admission };
+
+  struct Result
+  {
+    std::string configuration;
+    double generic_ns;
+    double specialised_ns;
+  };
+  std::vector<Result> results;
+
+  results.push_back(
+    { "no tokens, no inhibits, one sink",
+      time_ns_per_trigger(
+        [&]() {
+          return emit(RuntimeAdmission(no_token_source),
+                      InhibitQueues(inhibited, regions),
+                      PolicyDispatch(one_sink),
+                      decision,
+                      triggers);
+        },
+        triggers),
+      time_ns_per_trigger(
+        [&]() { return emit(FreeAdmission(), NoInhibitSource(), OnlySinkDispatch(one_sink), decision, triggers); },
+        triggers) });
+
+  results.push_back(
+    { "tokens, inhibits, one sink",
+      time_ns_per_trigger(
+        [&]() {
+          return emit(RuntimeAdmission(token_source),
+                      InhibitQueues(inhibited, regions),
+                      PolicyDispatch(one_sink),
+                      decision,
+                      triggers);
+        },
+        triggers),
+      time_ns_per_trigger(
+        [&]() {
+          return emit(
+            token_admission, InhibitQueues(inhibited, regions), OnlySinkDispatch(one_sink), decision, triggers);
+        },
+        triggers) });
+
+  results.push_back(
+    { "tokens, inhibits, three sinks",
+      time_ns_per_trigger(
+        [&]() {
+          return emit(RuntimeAdmission(token_source),
+                      InhibitQueues(inhibited, regions),
+                      PolicyDispatch(three_sinks),
+                      decision,
+                      triggers);
+        },
+        triggers),
+      time_ns_per_trigger(
+        [&]() {
+          return emit(
+            token_admission, InhibitQueues(inhibited, regions), PolicyDispatch(three_sinks), decision, triggers);
+        },
+        triggers) });
+
+  std::cout << std::left << std::setw(34) << "configuration" << std::right << std::setw(14) << "generic ns"
+            << std::setw(18) << "specialised ns" << std::endl;
+  for (auto const& result : results) {
+    std::cout << std::left << std::setw(34) << result.configuration << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << result.generic_ns << std::setw(18) << result.specialised_ns
+              << std::endl;
+  }
+  return 0;
+}
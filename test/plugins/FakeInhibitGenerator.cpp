@@ -25,6 +25,8 @@ FakeInhibitGenerator::FakeInhibitGenerator(const std::string& name)
   : DAQModule(name)
   , m_running_flag{ false }
   , m_inhibit_interval_ms{ 0 }
+  , m_clock(make_clock(false))
+  , m_sleeper(m_clock)
 {
   register_command("conf", &FakeInhibitGenerator::do_configure);
   register_command("start", &FakeInhibitGenerator::do_start);
@@ -47,12 +49,26 @@ FakeInhibitGenerator::do_configure(const nlohmann::json& confobj)
 {
   auto params = confobj.get<fakeinhibitgenerator::ConfParams>();
   m_inhibit_interval_ms = std::chrono::milliseconds(params.inhibit_interval_ms);
+  m_clock_participant.reset();
+  m_clock = make_clock(params.use_virtual_clock);
+  m_sleeper.set_clock(m_clock);
+  m_clock_participant = std::make_unique<Clock::Participant>(m_clock, 1);
+  m_timeline_file_prefix = params.timeline_file_prefix;
+  m_timeline_events_per_thread = params.timeline_events_per_thread;
 }
 
 void
-FakeInhibitGenerator::do_start(const nlohmann::json& /*startobj*/)
+FakeInhibitGenerator::do_start(const nlohmann::json& startobj)
 {
+  m_run_number = startobj.value<dunedaq::daqdataformats::run_number_t>("run", 0);
+  m_sleeper.reset();
+  m_sender_timeline = nullptr;
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.reset(m_timeline_events_per_thread, m_clock);
+    m_sender_timeline = m_timeline.add_thread("inhibit-sender");
+  }
   m_running_flag.store(true);
+  m_clock_participant->rejoin();
   m_threads.push_back(std::thread(&FakeInhibitGenerator::send_inhibits, this, m_inhibit_interval_ms));
 }
 
@@ -60,21 +76,29 @@ void
 FakeInhibitGenerator::do_stop(const nlohmann::json& /* stopobj */)
 {
   m_running_flag.store(false);
+  m_sleeper.interrupt();
   for (auto& thread : m_threads)
     thread.join();
   m_threads.clear();
+
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.write_for_run(m_timeline_file_prefix, m_run_number);
+    m_sender_timeline = nullptr;
+    m_timeline.reset(0);
+  }
 }
 
 void
 FakeInhibitGenerator::send_inhibits(const std::chrono::milliseconds inhibit_interval_ms)
 {
-  auto time_now = system_clock::now();
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/inhibit-sender");
+  auto time_now = m_clock->now();
   auto next_switch_time = time_now + inhibit_interval_ms;
   bool busy = false;
 
   while (true) {
-    while (m_running_flag.load() && system_clock::now() < next_switch_time) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    while (m_running_flag.load() && m_clock->now() < next_switch_time) {
+      m_sleeper.sleep_for(std::chrono::milliseconds(1));
     }
 
     if (!m_running_flag.load())
@@ -82,8 +106,9 @@ FakeInhibitGenerator::send_inhibits(const std::chrono::milliseconds inhibit_inte
 
     busy = !busy;
     TLOG_DEBUG(1) << "Sending TriggerInhibit with busy=" << busy;
-    dfmessages::TriggerInhibit busyi{ busy };
+    dfmessages::TriggerInhibit busyi{ busy, m_run_number };
     m_trigger_inhibit_sink->send(std::move(busyi), std::chrono::milliseconds(1));
+    record_timeline_event(m_sender_timeline, TimelineEvent::kInhibitSent, 0, busy ? 1 : 0);
 
     next_switch_time += inhibit_interval_ms;
   }
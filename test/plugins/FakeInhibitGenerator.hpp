@@ -8,6 +8,10 @@
 #ifndef TRIGEMU_TEST_PLUGINS_FAKEINHIBITGENERATOR_HPP_
 #define TRIGEMU_TEST_PLUGINS_FAKEINHIBITGENERATOR_HPP_
 
+#include "trigemu/Clock.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/Timeline.hpp"
+
 #include "appfwk/DAQModule.hpp"
 #include "iomanager/Sender.hpp"
 
@@ -41,10 +45,21 @@ private:
   void send_inhibits(const std::chrono::milliseconds inhibit_interval_ms);
 
   std::atomic<bool> m_running_flag;
+  dfmessages::run_number_t m_run_number{ 0 };
   std::vector<std::thread> m_threads;
 
   std::shared_ptr<iomanager::SenderConcept<dfmessages::TriggerInhibit>> m_trigger_inhibit_sink;
   std::chrono::milliseconds m_inhibit_interval_ms;
+
+  std::shared_ptr<Clock> m_clock;
+  InterruptibleSleeper m_sleeper;
+  std::unique_ptr<Clock::Participant> m_clock_participant;
+
+  // Optional timeline of what we send, written out at stop
+  std::string m_timeline_file_prefix;
+  size_t m_timeline_events_per_thread{ 0 };
+  Timeline m_timeline;
+  TimelineBuffer* m_sender_timeline{ nullptr };
 };
 
 } // namespace dunedaq::trigemu
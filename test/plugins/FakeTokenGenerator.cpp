@@ -28,6 +28,8 @@ FakeTokenGenerator::FakeTokenGenerator(const std::string& name)
   , m_running_flag{ false }
   , m_token_interval_mean_ms{ 0 }
   , m_token_interval_sigma_ms{ 0 }
+  , m_clock(make_clock(false))
+  , m_sleeper(m_clock)
 {
   register_command("conf", &FakeTokenGenerator::do_configure);
   register_command("start", &FakeTokenGenerator::do_start);
@@ -52,13 +54,26 @@ FakeTokenGenerator::do_configure(const nlohmann::json& confobj)
   m_token_interval_mean_ms = params.token_interval_ms;
   m_token_interval_sigma_ms = params.token_sigma_ms;
   m_initial_tokens = params.initial_tokens;
+  m_clock_participant.reset();
+  m_clock = make_clock(params.use_virtual_clock);
+  m_sleeper.set_clock(m_clock);
+  m_clock_participant = std::make_unique<Clock::Participant>(m_clock, 1);
+  m_timeline_file_prefix = params.timeline_file_prefix;
+  m_timeline_events_per_thread = params.timeline_events_per_thread;
 }
 
 void
 FakeTokenGenerator::do_start(const nlohmann::json& startobj)
 {
   m_run_number = startobj.value<dunedaq::daqdataformats::run_number_t>("run", 0);
+  m_sleeper.reset();
+  m_sender_timeline = nullptr;
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.reset(m_timeline_events_per_thread, m_clock);
+    m_sender_timeline = m_timeline.add_thread("ftg-token-gen");
+  }
   m_running_flag.store(true);
+  m_clock_participant->rejoin();
   m_token_thread = std::thread(&FakeTokenGenerator::send_tokens, this);
   pthread_setname_np(m_token_thread.native_handle(), "ftg-token-gen");
 }
@@ -67,12 +82,20 @@ void
 FakeTokenGenerator::do_stop(const nlohmann::json& /* stopobj */)
 {
   m_running_flag.store(false);
+  m_sleeper.interrupt();
   m_token_thread.join();
+
+  if (!m_timeline_file_prefix.empty()) {
+    m_timeline.write_for_run(m_timeline_file_prefix, m_run_number);
+    m_sender_timeline = nullptr;
+    m_timeline.reset(0);
+  }
 }
 
 void
 FakeTokenGenerator::send_tokens()
 {
+  Clock::ThreadScope clock_scope(*m_clock_participant, get_name() + "/token-gen");
   std::normal_distribution<double> distn(m_token_interval_mean_ms, m_token_interval_sigma_ms);
   std::mt19937 random_engine;
 
@@ -81,6 +104,7 @@ FakeTokenGenerator::send_tokens()
     token.run_number = m_run_number;
     TLOG_DEBUG(0) << "Pushing initial token with run number " << m_run_number << " onto queue";
     m_token_sink->send(std::move(token), iomanager::Sender::s_block);
+    record_timeline_event(m_sender_timeline, TimelineEvent::kTokenSent);
   }
 
   while (m_running_flag.load()) {
@@ -88,12 +112,13 @@ FakeTokenGenerator::send_tokens()
     token.run_number = m_run_number;
     TLOG_DEBUG(0) << "Pushing token with run number " << m_run_number << " onto queue";
     m_token_sink->send(std::move(token), iomanager::Sender::s_block);
+    record_timeline_event(m_sender_timeline, TimelineEvent::kTokenSent);
     int interval = static_cast<int>(std::round(distn(random_engine)));
     if (interval <= 0)
       interval = 1;
 
     TLOG_DEBUG(0) << "Sleeping for " << interval << " ms.";
-    std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    m_sleeper.sleep_for(std::chrono::milliseconds(interval));
   }
 }
 
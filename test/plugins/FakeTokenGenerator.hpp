@@ -8,6 +8,10 @@
 #ifndef TRIGEMU_TEST_PLUGINS_FAKETOKENGENERATOR_HPP_
 #define TRIGEMU_TEST_PLUGINS_FAKETOKENGENERATOR_HPP_
 
+#include "trigemu/Clock.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/Timeline.hpp"
+
 #include "appfwk/DAQModule.hpp"
 #include "iomanager/Sender.hpp"
 
@@ -47,6 +51,16 @@ private:
   int m_initial_tokens;
   int m_token_interval_mean_ms;
   int m_token_interval_sigma_ms;
+
+  std::shared_ptr<Clock> m_clock;
+  InterruptibleSleeper m_sleeper;
+  std::unique_ptr<Clock::Participant> m_clock_participant;
+
+  // Optional timeline of what we send, written out at stop
+  std::string m_timeline_file_prefix;
+  size_t m_timeline_events_per_thread{ 0 };
+  Timeline m_timeline;
+  TimelineBuffer* m_sender_timeline{ nullptr };
 };
 
 } // namespace dunedaq::trigemu
@@ -0,0 +1,169 @@
+/**
+ * @file ArrivalModel_test.cxx ArrivalModel and TriggerSchedule class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ArrivalModel.hpp"
+#include "trigemu/Issues.hpp"
+
+#define BOOST_TEST_MODULE ArrivalModel_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(ArrivalModel_test)
+
+namespace {
+
+ArrivalModelParams
+make_params(const std::string& model)
+{
+  ArrivalModelParams params;
+  params.model = model;
+  params.interval_ticks = 1000;
+  params.jitter_ticks = 100;
+  params.burst_interval_ticks = 100;
+  params.burst_on_ticks = 10'000;
+  params.burst_off_ticks = 90'000;
+  params.burst_count = 4;
+  params.burst_window_ticks = 200;
+  params.seed = 42;
+  return params;
+}
+
+std::vector<dfmessages::timestamp_t>
+generate(const ArrivalModelParams& params, dfmessages::timestamp_t first, size_t count)
+{
+  auto model = make_arrival_model(params);
+  model->start(first);
+  std::vector<dfmessages::timestamp_t> timestamps{ first };
+  while (timestamps.size() < count) {
+    timestamps.push_back(model->next(timestamps.back()));
+  }
+  return timestamps;
+}
+
+const std::vector<std::string> s_models{ "periodic", "jittered", "poisson", "onoff", "burst" };
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(PeriodicSpacing)
+{
+  auto timestamps = generate(make_params("periodic"), 5000, 100);
+  for (size_t i = 0; i < timestamps.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(timestamps[i], 5000 + i * 1000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TimestampsNeverGoBack)
+{
+  for (auto const& model : s_models) {
+    auto timestamps = generate(make_params(model), 1'000'000, 10'000);
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+      BOOST_REQUIRE_MESSAGE(timestamps[i] >= timestamps[i - 1], model << " went back at trigger " << i);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SameSeedSameSequence)
+{
+  for (auto const& model : s_models) {
+    auto params = make_params(model);
+    auto first = generate(params, 0, 1000);
+    BOOST_CHECK_MESSAGE(first == generate(params, 0, 1000), model << " isn't repeatable");
+    if (model != "periodic") {
+      params.seed = 43;
+      BOOST_CHECK_MESSAGE(first != generate(params, 0, 1000), model << " ignores the seed");
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MeanRateMatchesModel)
+{
+  const uint64_t clock_frequency_hz = 50'000'000; // NOLINT(build/unsigned)
+  for (auto const& model : s_models) {
+    auto params = make_params(model);
+    const size_t count = 200'000;
+    auto timestamps = generate(params, 0, count);
+    const double measured_hz =
+      static_cast<double>(count - 1) * clock_frequency_hz / static_cast<double>(timestamps.back());
+    const double expected_hz = mean_rate_hz(params, clock_frequency_hz);
+    BOOST_CHECK_MESSAGE(std::abs(measured_hz / expected_hz - 1) < 0.05,
+                        model << ": measured " << measured_hz << " Hz, expected " << expected_hz << " Hz");
+  }
+  BOOST_CHECK_EQUAL(mean_rate_hz(make_params("periodic"), clock_frequency_hz), 50'000);
+  BOOST_CHECK_EQUAL(mean_rate_hz(make_params("burst"), clock_frequency_hz), 200'000);
+  // 10% of the time at 500 kHz, the rest at 50 kHz
+  BOOST_CHECK_CLOSE(mean_rate_hz(make_params("onoff"), clock_frequency_hz), 95'000, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(BurstsStayInTheirWindow)
+{
+  auto timestamps = generate(make_params("burst"), 0, 400);
+  for (size_t i = 0; i < timestamps.size(); ++i) {
+    const dfmessages::timestamp_t burst_start = (i / 4) * 1000;
+    BOOST_REQUIRE_GE(timestamps[i], burst_start);
+    BOOST_REQUIRE_LT(timestamps[i], burst_start + 200);
+    if (i % 4 == 0) {
+      BOOST_CHECK_EQUAL(timestamps[i], burst_start);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(InvalidParamsThrow)
+{
+  auto params = make_params("periodic");
+  params.interval_ticks = 0;
+  BOOST_CHECK_THROW(make_arrival_model(params), InvalidArrivalModel);
+
+  params = make_params("onoff");
+  params.burst_interval_ticks = 0;
+  BOOST_CHECK_THROW(make_arrival_model(params), InvalidArrivalModel);
+
+  params = make_params("burst");
+  params.burst_count = 0;
+  BOOST_CHECK_THROW(make_arrival_model(params), InvalidArrivalModel);
+
+  BOOST_CHECK_THROW(make_arrival_model(make_params("sometimes")), InvalidArrivalModel);
+}
+
+BOOST_AUTO_TEST_CASE(ScheduleFollowsModel)
+{
+  auto params = make_params("poisson");
+  auto expected = generate(params, 7000, 1000);
+
+  // Small enough to be refilled many times over
+  TriggerSchedule schedule(make_arrival_model(params), 8);
+  schedule.start(7000);
+  for (auto timestamp : expected) {
+    BOOST_REQUIRE_EQUAL(schedule.front(), timestamp);
+    schedule.pop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ScheduleIntervalChangeKeepsFront)
+{
+  TriggerSchedule schedule(make_arrival_model(make_params("periodic")), 8);
+  schedule.start(0);
+  schedule.pop();
+  schedule.pop();
+  BOOST_REQUIRE_EQUAL(schedule.front(), 2000);
+
+  // The trigger already due stays, the ones after it take the new interval
+  schedule.set_interval(300);
+  for (dfmessages::timestamp_t expected = 2000; expected < 2000 + 100 * 300; expected += 300) {
+    BOOST_REQUIRE_EQUAL(schedule.front(), expected);
+    schedule.pop();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,168 @@
+/**
+ * @file CreditPool_test.cxx CreditPool class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/CreditPool.hpp"
+
+#define BOOST_TEST_MODULE CreditPool_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(CreditPool_test)
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// A clock that only moves when it's told to, or when someone sleeps on it
+class ManualClock : public Clock
+{
+public:
+  time_point now() override { return m_now; }
+  bool sleep_until(time_point deadline, const std::function<bool()>& interrupted) override
+  {
+    if (interrupted()) {
+      return false;
+    }
+    m_now = std::max(m_now, deadline);
+    return true;
+  }
+  void notify() override {}
+
+  void advance(duration d) { m_now += d; }
+
+private:
+  time_point m_now{ std::chrono::hours(1000) };
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(AllOrNothing)
+{
+  CreditPool pool;
+  pool.reset(3);
+  BOOST_CHECK(!pool.try_acquire(4));
+  BOOST_CHECK_EQUAL(pool.available(), 3);
+  BOOST_CHECK(pool.try_acquire(2));
+  BOOST_CHECK_EQUAL(pool.available(), 1);
+  BOOST_CHECK_EQUAL(pool.try_acquire_up_to(5), 1);
+  BOOST_CHECK_EQUAL(pool.try_acquire_up_to(5), 0);
+  BOOST_CHECK_EQUAL(pool.available(), 0);
+  pool.release(2);
+  BOOST_CHECK_EQUAL(pool.available(), 2);
+  BOOST_CHECK(pool.try_acquire(2));
+}
+
+BOOST_AUTO_TEST_CASE(NeverNegativeUnderContention)
+{
+  CreditPool pool;
+  pool.reset(0);
+  std::atomic<bool> done{ false };
+  std::atomic<int64_t> held{ 0 };
+  std::atomic<bool> went_negative{ false };
+
+  // Takers take 1, 2 or 3 at a time while a releaser trickles credits in
+  std::vector<std::thread> takers;
+  for (int64_t n = 1; n <= 3; ++n) {
+    takers.emplace_back([&, n]() {
+      while (!done.load()) {
+        if (pool.try_acquire(n)) {
+          held += n;
+        }
+        went_negative = went_negative || pool.available() < 0;
+      }
+    });
+  }
+  for (int i = 0; i < 100'000; ++i) {
+    pool.release();
+  }
+  while (held.load() + pool.available() < 100'000 || pool.available() >= 3) {
+    std::this_thread::yield();
+  }
+  done.store(true);
+  for (auto& taker : takers) {
+    taker.join();
+  }
+  BOOST_CHECK(!went_negative.load());
+  BOOST_CHECK_EQUAL(held.load() + pool.available(), 100'000);
+}
+
+BOOST_AUTO_TEST_CASE(WaiterIsWokenByRelease)
+{
+  CreditPool pool(std::make_shared<SystemClock>());
+  pool.reset(0);
+  const auto start = std::chrono::steady_clock::now();
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(20ms);
+    pool.release(2);
+  });
+  BOOST_CHECK(pool.acquire_until(2, std::chrono::system_clock::now() + 10s, []() { return false; }));
+  BOOST_CHECK_LT(std::chrono::steady_clock::now() - start, 5s);
+  releaser.join();
+  BOOST_CHECK_EQUAL(pool.available(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DeadlineAndInterruption)
+{
+  auto clock = std::make_shared<ManualClock>();
+  CreditPool pool(clock);
+  pool.reset(0);
+  const auto start = clock->now();
+  BOOST_CHECK(!pool.acquire_until(1, start + 5ms, []() { return false; }));
+  BOOST_CHECK(clock->now() == start + 5ms);
+  BOOST_CHECK(!pool.acquire_until(1, start + 1h, []() { return true; }));
+  BOOST_CHECK(clock->now() == start + 5ms);
+  pool.release();
+  BOOST_CHECK(pool.acquire_until(1, start, []() { return false; }));
+}
+
+BOOST_AUTO_TEST_CASE(StarvationIsTimed)
+{
+  auto clock = std::make_shared<ManualClock>();
+  CreditPool pool(clock);
+  pool.reset(1);
+  BOOST_CHECK(pool.try_acquire(1));
+  BOOST_CHECK_EQUAL(pool.get_starved_us(), 0);
+  BOOST_CHECK_EQUAL(pool.get_starved_count(), 0);
+
+  // One spell of 3 ms, however many attempts fail in it
+  BOOST_CHECK(!pool.try_acquire(1));
+  clock->advance(1ms);
+  BOOST_CHECK(!pool.try_acquire(1));
+  clock->advance(2ms);
+  BOOST_CHECK_EQUAL(pool.get_starved_us(), 3000);
+  pool.release();
+  BOOST_CHECK(pool.try_acquire(1));
+  clock->advance(10ms);
+  BOOST_CHECK_EQUAL(pool.get_starved_us(), 3000);
+  BOOST_CHECK_EQUAL(pool.get_starved_count(), 1);
+
+  // A partial grant ends a spell too
+  BOOST_CHECK_EQUAL(pool.try_acquire_up_to(2), 0);
+  clock->advance(4ms);
+  pool.release();
+  BOOST_CHECK_EQUAL(pool.try_acquire_up_to(2), 1);
+  BOOST_CHECK_EQUAL(pool.get_starved_us(), 7000);
+  BOOST_CHECK_EQUAL(pool.get_starved_count(), 2);
+
+  pool.reset(0);
+  BOOST_CHECK_EQUAL(pool.get_starved_us(), 0);
+  BOOST_CHECK_EQUAL(pool.get_starved_count(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,288 @@
+/**
+ * @file DecisionDispatcher_test.cxx DecisionDispatcher class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/DecisionDispatcher.hpp"
+#include "trigemu/Issues.hpp"
+
+#include "iomanager/Receiver.hpp"
+#include "iomanager/Sender.hpp"
+
+#include "ers/Issue.hpp"
+
+#define BOOST_TEST_MODULE DecisionDispatcher_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(DecisionDispatcher_test)
+
+namespace {
+
+// A sink that holds up to `capacity` decisions, or blocks every send until it is opened
+class FakeSink : public iomanager::SenderConcept<dfmessages::TriggerDecision>
+{
+public:
+  explicit FakeSink(size_t capacity)
+    : m_capacity(capacity)
+  {}
+
+  void send(dfmessages::TriggerDecision&& decision, Sender::timeout_t timeout) override
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    if (!m_cv.wait_for(lk, timeout, [&]() { return m_received.size() < m_capacity; })) {
+      throw iomanager::TimeoutExpired(ERS_HERE, "sink", "send", timeout.count());
+    }
+    m_received.push_back(decision.trigger_number);
+  }
+
+  // Let every send through from now on
+  void open()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_capacity = std::numeric_limits<size_t>::max();
+    m_cv.notify_all();
+  }
+
+  std::vector<dfmessages::trigger_number_t> received()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_received;
+  }
+
+private:
+  size_t m_capacity;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<dfmessages::trigger_number_t> m_received;
+};
+
+// A sink that fails every send with something other than a timeout
+class BrokenSink : public iomanager::SenderConcept<dfmessages::TriggerDecision>
+{
+public:
+  void send(dfmessages::TriggerDecision&& /*decision*/, Sender::timeout_t /*timeout*/) override
+  {
+    throw std::runtime_error("broken sink");
+  }
+};
+
+dfmessages::TriggerDecision
+make_decision(dfmessages::trigger_number_t trigger_number)
+{
+  dfmessages::TriggerDecision decision;
+  decision.trigger_number = trigger_number;
+  return decision;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RoundRobinSharesEvenly)
+{
+  DecisionDispatcher dispatcher;
+  std::vector<std::shared_ptr<FakeSink>> sinks;
+  for (int i = 0; i < 3; ++i) {
+    sinks.push_back(std::make_shared<FakeSink>(1000));
+    dispatcher.add_sink("sink" + std::to_string(i), sinks.back());
+  }
+  dispatcher.configure(DispatchPolicy::kRoundRobin, std::chrono::milliseconds(10), std::chrono::milliseconds(100), false);
+  for (dfmessages::trigger_number_t tn = 0; tn < 30; ++tn) {
+    BOOST_REQUIRE(dispatcher.dispatch(make_decision(tn)));
+  }
+  for (size_t i = 0; i < sinks.size(); ++i) {
+    auto received = sinks[i]->received();
+    BOOST_REQUIRE_EQUAL(received.size(), 10);
+    for (auto tn : received) {
+      BOOST_CHECK_EQUAL(tn % 3, i);
+    }
+    BOOST_CHECK_EQUAL(dispatcher.get_sinks()[i]->sent.load(), 10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(HashIsRepeatable)
+{
+  DecisionDispatcher dispatcher;
+  std::vector<std::shared_ptr<FakeSink>> sinks;
+  for (int i = 0; i < 4; ++i) {
+    sinks.push_back(std::make_shared<FakeSink>(1000));
+    dispatcher.add_sink("sink" + std::to_string(i), sinks.back());
+  }
+  dispatcher.configure(DispatchPolicy::kHash, std::chrono::milliseconds(10), std::chrono::milliseconds(100), false);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (dfmessages::trigger_number_t tn = 0; tn < 100; ++tn) {
+      BOOST_REQUIRE(dispatcher.dispatch(make_decision(tn)));
+    }
+  }
+  for (auto& sink : sinks) {
+    auto received = sink->received();
+    BOOST_CHECK_GT(received.size(), 0);
+    // Each trigger number that went here went here both times
+    BOOST_REQUIRE_EQUAL(received.size() % 2, 0);
+    for (size_t i = 0; i < received.size() / 2; ++i) {
+      BOOST_CHECK_EQUAL(received[i], received[i + received.size() / 2]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LeastOutstandingFollowsTokens)
+{
+  DecisionDispatcher dispatcher;
+  auto first = std::make_shared<FakeSink>(1000);
+  auto second = std::make_shared<FakeSink>(1000);
+  dispatcher.add_sink("first", first);
+  dispatcher.add_sink("second", second);
+  dispatcher.configure(
+    DispatchPolicy::kLeastOutstanding, std::chrono::milliseconds(10), std::chrono::milliseconds(100), true);
+
+  // The first sink never gives its tokens back, so it's only chosen on ties
+  for (dfmessages::trigger_number_t tn = 0; tn < 20; ++tn) {
+    BOOST_REQUIRE(dispatcher.dispatch(make_decision(tn)));
+    for (auto done : second->received()) {
+      dispatcher.complete(done);
+    }
+  }
+  BOOST_CHECK_LE(first->received().size(), 1);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->outstanding.load(), static_cast<int64_t>(first->received().size()));
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[1]->outstanding.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FullSinkIsNotWaitedOn)
+{
+  DecisionDispatcher dispatcher;
+  auto full = std::make_shared<FakeSink>(0);
+  auto free = std::make_shared<FakeSink>(1000);
+  dispatcher.add_sink("full", full);
+  dispatcher.add_sink("free", free);
+  dispatcher.configure(DispatchPolicy::kHash, std::chrono::seconds(10), std::chrono::seconds(10), false);
+
+  // Half of these hash to the full sink, which would take 10 s each if it were waited on
+  const auto start = std::chrono::steady_clock::now();
+  for (dfmessages::trigger_number_t tn = 0; tn < 100; ++tn) {
+    BOOST_REQUIRE(dispatcher.dispatch(make_decision(tn)));
+  }
+  BOOST_CHECK_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  BOOST_CHECK_EQUAL(free->received().size(), 100);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->send_failures.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TimedOutSinkIsBackedOff)
+{
+  DecisionDispatcher dispatcher;
+  auto first = std::make_shared<FakeSink>(0);
+  auto second = std::make_shared<FakeSink>(0);
+  dispatcher.add_sink("first", first);
+  dispatcher.add_sink("second", second);
+  dispatcher.configure(DispatchPolicy::kRoundRobin, std::chrono::milliseconds(20), std::chrono::seconds(10), false);
+
+  // Both are waited on once, then only tried without waiting
+  auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(!dispatcher.dispatch(make_decision(1)));
+  BOOST_CHECK_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(40));
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->send_failures.load(), 1);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[1]->send_failures.load(), 1);
+
+  start = std::chrono::steady_clock::now();
+  BOOST_CHECK(!dispatcher.dispatch(make_decision(2)));
+  BOOST_CHECK_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->send_failures.load(), 1);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[1]->send_failures.load(), 1);
+
+  // They're still offered decisions, and take them once they have room
+  second->open();
+  BOOST_CHECK(dispatcher.dispatch(make_decision(3)));
+  BOOST_CHECK_EQUAL(second->received().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(OnlySinkIsNotBackedOff)
+{
+  DecisionDispatcher dispatcher;
+  BOOST_CHECK(!dispatcher.dispatch_to_only_sink(make_decision(0)));
+
+  auto full = std::make_shared<FakeSink>(0);
+  dispatcher.add_sink("full", full);
+  dispatcher.configure(DispatchPolicy::kRoundRobin, std::chrono::milliseconds(20), std::chrono::seconds(10), true);
+
+  // There's nowhere else to go, so it's waited on every time, by either method
+  for (dfmessages::trigger_number_t tn = 1; tn <= 2; ++tn) {
+    auto start = std::chrono::steady_clock::now();
+    BOOST_CHECK(!dispatcher.dispatch_to_only_sink(make_decision(tn)));
+    BOOST_CHECK_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    start = std::chrono::steady_clock::now();
+    BOOST_CHECK(!dispatcher.dispatch(make_decision(tn)));
+    BOOST_CHECK_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  }
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->send_failures.load(), 4);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->outstanding.load(), 0);
+
+  full->open();
+  BOOST_CHECK(dispatcher.dispatch_to_only_sink(make_decision(3)));
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->sent.load(), 1);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->outstanding.load(), 1);
+  dispatcher.complete(3);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->outstanding.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(OtherSendErrorsArePassedOn)
+{
+  DecisionDispatcher dispatcher;
+  dispatcher.add_sink("broken", std::make_shared<BrokenSink>());
+  dispatcher.add_sink("full", std::make_shared<FakeSink>(0));
+  dispatcher.configure(
+    DispatchPolicy::kLeastOutstanding, std::chrono::milliseconds(10), std::chrono::milliseconds(100), true);
+
+  BOOST_CHECK_THROW(dispatcher.dispatch(make_decision(1)), std::runtime_error);
+  BOOST_CHECK_THROW(dispatcher.dispatch_to_only_sink(make_decision(2)), std::runtime_error);
+  // The broken sink isn't left looking busy
+  auto& broken = *dispatcher.get_sinks()[0];
+  BOOST_CHECK_EQUAL(broken.outstanding.load(), 0);
+  BOOST_CHECK_EQUAL(broken.waiting_senders.load(), 0);
+  BOOST_CHECK_EQUAL(broken.sent.load(), 0);
+  dispatcher.complete(1);
+  BOOST_CHECK_EQUAL(broken.outstanding.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(WaitingSenderDoesNotBlockOthers)
+{
+  DecisionDispatcher dispatcher;
+  auto blocked = std::make_shared<FakeSink>(0);
+  auto free = std::make_shared<FakeSink>(0);
+  dispatcher.add_sink("blocked", blocked);
+  dispatcher.add_sink("free", free);
+  dispatcher.configure(DispatchPolicy::kRoundRobin, std::chrono::seconds(10), std::chrono::seconds(10), false);
+
+  // Both full: this one waits on the first sink, for up to 10 s
+  std::thread waiter([&]() { BOOST_CHECK(dispatcher.dispatch(make_decision(1))); });
+  while (dispatcher.get_sinks()[0]->waiting_senders.load() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Round robin picks the second sink, which has room now
+  free->open();
+  const auto start = std::chrono::steady_clock::now();
+  BOOST_CHECK(dispatcher.dispatch(make_decision(2)));
+  BOOST_CHECK_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  BOOST_CHECK_EQUAL(free->received().size(), 1);
+
+  blocked->open();
+  waiter.join();
+  BOOST_CHECK_EQUAL(blocked->received().size(), 1);
+  BOOST_CHECK_EQUAL(dispatcher.get_sinks()[0]->waiting_senders.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+/**
+ * @file DecisionRecorder_test.cxx DecisionRecorder class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/DecisionRecorder.hpp"
+#include "trigemu/Issues.hpp"
+#include "trigemu/TriggerTraceReader.hpp"
+
+#define BOOST_TEST_MODULE DecisionRecorder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(DecisionRecorder_test)
+
+namespace {
+
+std::filesystem::path
+make_directory(const std::string& name)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              ("trigemu_recorder_test_" + std::to_string(::getpid()) + "_" + name);
+  std::filesystem::create_directories(path);
+  return path;
+}
+
+dfmessages::TriggerDecision
+make_decision(dfmessages::trigger_number_t trigger_number)
+{
+  dfmessages::TriggerDecision decision;
+  decision.trigger_number = trigger_number;
+  decision.run_number = 7;
+  decision.trigger_timestamp = 1000 * trigger_number;
+  return decision;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ResendsAreRecordedToo)
+{
+  auto directory = make_directory("resends");
+  const std::string prefix = (directory / "decisions").string();
+  constexpr dfmessages::trigger_number_t sent = 20000;
+
+  {
+    DecisionRecorder recorder(prefix, 7, 1 << 30, 16, false, 1024);
+    // The sending thread and the thread that resends stale decisions
+    // record at the same time. A decision is resent after it was sent
+    std::atomic<dfmessages::trigger_number_t> last_sent{ 0 };
+    std::thread resender([&]() {
+      for (dfmessages::trigger_number_t n = 1; n <= sent; n += 10) {
+        while (last_sent.load() < n) {
+          std::this_thread::yield();
+        }
+        recorder.record_resent(make_decision(n));
+      }
+    });
+    for (dfmessages::trigger_number_t n = 1; n <= sent; ++n) {
+      recorder.record(make_decision(n));
+      last_sent.store(n);
+      if (n % 64 == 0) {
+        // Give the writer a chance, so that nothing is dropped
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+      }
+    }
+    resender.join();
+    recorder.close();
+    BOOST_CHECK_EQUAL(recorder.get_dropped_count(), 0);
+    BOOST_CHECK_EQUAL(recorder.get_recorded_count(), sent + sent / 10);
+  }
+
+  // Each decision once, and every tenth one again
+  std::map<dfmessages::trigger_number_t, int> times_recorded;
+  dfmessages::trigger_number_t last_sent = 0;
+  bool sent_in_order = true;
+  TriggerTraceReader reader(prefix + "_run000007_0000.tdedec");
+  dfmessages::TriggerDecision decision;
+  uint32_t flags = 0; // NOLINT(build/unsigned)
+  while (reader.next(decision, flags)) {
+    if (++times_recorded[decision.trigger_number] == 1) {
+      sent_in_order = sent_in_order && decision.trigger_number == last_sent + 1;
+      last_sent = decision.trigger_number;
+      BOOST_CHECK_EQUAL(flags, 0);
+    } else {
+      BOOST_CHECK_EQUAL(flags, decisionfile::s_flag_resent);
+    }
+    BOOST_CHECK_EQUAL(decision.trigger_timestamp, 1000 * decision.trigger_number);
+  }
+  BOOST_CHECK(sent_in_order);
+  BOOST_REQUIRE_EQUAL(times_recorded.size(), sent);
+  for (auto const& [trigger_number, count] : times_recorded) {
+    BOOST_CHECK_EQUAL(count, trigger_number % 10 == 1 ? 2 : 1);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_CASE(BadPathFailsAtConstruction)
+{
+  BOOST_CHECK_THROW(DecisionRecorder("/nonexistent/directory/decisions", 1, 1 << 30, 16, false), RecordingError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+/**
+ * @file EmissionQueue_test.cxx EmissionQueue class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/EmissionQueue.hpp"
+
+#define BOOST_TEST_MODULE EmissionQueue_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(EmissionQueue_test)
+
+namespace {
+
+PendingDecision
+make_pending(dfmessages::timestamp_t emit_at, dfmessages::trigger_number_t trigger_number)
+{
+  PendingDecision pending;
+  pending.emit_at = emit_at;
+  pending.trigger_timestamp = emit_at + 1000;
+  pending.decision.trigger_number = trigger_number;
+  pending.decision.trigger_timestamp = pending.trigger_timestamp;
+  return pending;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(EmptyQueue)
+{
+  EmissionQueue queue;
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+
+  queue.push(make_pending(100, 1));
+  BOOST_CHECK(!queue.empty());
+  BOOST_CHECK_EQUAL(queue.size(), 1);
+  queue.clear();
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ComesOutInEmissionOrder)
+{
+  std::mt19937 random_engine(3);
+  std::uniform_int_distribution<dfmessages::timestamp_t> emit_at(0, 1'000'000);
+  std::vector<dfmessages::timestamp_t> times;
+  EmissionQueue queue;
+  for (dfmessages::trigger_number_t i = 1; i <= 1000; ++i) {
+    times.push_back(emit_at(random_engine));
+    queue.push(make_pending(times.back(), i));
+  }
+  std::sort(times.begin(), times.end());
+
+  for (auto time : times) {
+    BOOST_REQUIRE(!queue.empty());
+    BOOST_CHECK_EQUAL(queue.front().emit_at, time);
+    auto pending = queue.pop();
+    BOOST_CHECK_EQUAL(pending.emit_at, time);
+    // The decision comes out with its own trigger
+    BOOST_CHECK_EQUAL(pending.decision.trigger_timestamp, pending.trigger_timestamp);
+  }
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SameTimeKeepsPushOrder)
+{
+  EmissionQueue queue;
+  // Three decisions at each of three times, pushed with the times interleaved
+  dfmessages::trigger_number_t trigger_number = 1;
+  for (int round = 0; round < 3; ++round) {
+    for (dfmessages::timestamp_t emit_at : { 300, 100, 200 }) {
+      queue.push(make_pending(emit_at, trigger_number++));
+    }
+  }
+
+  std::vector<dfmessages::trigger_number_t> order;
+  while (!queue.empty()) {
+    order.push_back(queue.pop().decision.trigger_number);
+  }
+  const std::vector<dfmessages::trigger_number_t> expected{ 2, 5, 8, 3, 6, 9, 1, 4, 7 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(PushesBetweenPops)
+{
+  EmissionQueue queue;
+  queue.push(make_pending(100, 1));
+  queue.push(make_pending(300, 2));
+  BOOST_CHECK_EQUAL(queue.pop().decision.trigger_number, 1);
+
+  // Made later, but due before the one that's waiting
+  queue.push(make_pending(200, 3));
+  queue.push(make_pending(300, 4));
+  BOOST_CHECK_EQUAL(queue.pop().decision.trigger_number, 3);
+  BOOST_CHECK_EQUAL(queue.pop().decision.trigger_number, 2);
+  BOOST_CHECK_EQUAL(queue.pop().decision.trigger_number, 4);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
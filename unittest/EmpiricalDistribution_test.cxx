@@ -0,0 +1,150 @@
+/**
+ * @file EmpiricalDistribution_test.cxx AliasSampler and EmpiricalDistribution class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/EmpiricalDistribution.hpp"
+#include "trigemu/Issues.hpp"
+
+#define BOOST_TEST_MODULE EmpiricalDistribution_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(EmpiricalDistribution_test)
+
+namespace {
+
+// How often each index is drawn, out of `draws`
+std::vector<double>
+frequencies(const AliasSampler& sampler, size_t draws)
+{
+  std::mt19937_64 engine(1);
+  std::vector<double> counts(sampler.size(), 0.);
+  for (size_t i = 0; i < draws; ++i) {
+    counts[sampler(engine)] += 1.;
+  }
+  for (auto& count : counts) {
+    count /= draws;
+  }
+  return counts;
+}
+
+// A distribution file of its own for each test, removed afterwards
+struct DistributionFile
+{
+  explicit DistributionFile(const std::string& contents)
+    : path((std::filesystem::temp_directory_path() /
+            ("trigemu_distribution_test_" + std::to_string(::getpid()) + "_" + std::to_string(s_count++)))
+             .string())
+  {
+    std::ofstream(path) << contents;
+  }
+  ~DistributionFile() { std::remove(path.c_str()); }
+
+  std::string path;
+  static inline int s_count = 0;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(DrawsInProportionToTheWeights)
+{
+  const std::vector<double> weights{ 1, 0, 5, 2, 0.5, 11.5 };
+  AliasSampler sampler(weights);
+  BOOST_REQUIRE_EQUAL(sampler.size(), weights.size());
+
+  const size_t draws = 1'000'000;
+  auto drawn = frequencies(sampler, draws);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    const double expected = weights[i] / 20.;
+    // Five standard deviations
+    const double tolerance = 5 * std::sqrt(expected * (1 - expected) / draws) + 1e-9;
+    BOOST_CHECK_MESSAGE(std::abs(drawn[i] - expected) < tolerance,
+                        "index " << i << " drawn " << drawn[i] << ", expected " << expected);
+  }
+  // Nothing with no weight, ever
+  BOOST_CHECK_EQUAL(drawn[1], 0.);
+}
+
+BOOST_AUTO_TEST_CASE(SingleAndEqualWeights)
+{
+  AliasSampler single({ 3. });
+  std::mt19937_64 engine(2);
+  for (int i = 0; i < 100; ++i) {
+    BOOST_REQUIRE_EQUAL(single(engine), 0);
+  }
+
+  auto drawn = frequencies(AliasSampler(std::vector<double>(8, 1.)), 800'000);
+  for (auto frequency : drawn) {
+    BOOST_CHECK_CLOSE(frequency, 0.125, 2);
+  }
+
+  // Only the last one has weight: whatever's left over at the end of the set-up mustn't be drawn wrongly
+  auto last_only = frequencies(AliasSampler({ 0, 0, 0, 1e-3 }), 10'000);
+  BOOST_CHECK_EQUAL(last_only[3], 1.);
+}
+
+BOOST_AUTO_TEST_CASE(ValuesComeFromTheirBins)
+{
+  EmpiricalDistribution distribution({ { 10, 10, 1 }, { 100, 199, 3 }, { 5000, 5000, 0 } });
+  std::mt19937_64 engine(3);
+  int in_first = 0;
+  for (int i = 0; i < 100'000; ++i) {
+    const int64_t value = distribution(engine);
+    BOOST_REQUIRE(value == 10 || (value >= 100 && value <= 199));
+    in_first += value == 10 ? 1 : 0;
+  }
+  BOOST_CHECK_CLOSE(in_first / 100'000., 0.25, 3);
+}
+
+BOOST_AUTO_TEST_CASE(ReadsADistributionFile)
+{
+  DistributionFile file("# type quantity low high weight\n"
+                        "\n"
+                        "1 window_ticks 1000 1999 2\n"
+                        "1 window_ticks 2000 2999 1\n"
+                        "  1 link_count 4 4 1\n"
+                        "7 link_count 1 10 1\n");
+  auto distributions = load_distribution_file(file.path);
+  BOOST_REQUIRE_EQUAL(distributions.size(), 2);
+  BOOST_REQUIRE(distributions[1].window_ticks);
+  BOOST_REQUIRE(distributions[1].link_count);
+  BOOST_CHECK_EQUAL(distributions[1].window_ticks->get_bins().size(), 2);
+  BOOST_CHECK_EQUAL(distributions[1].link_count->get_bins()[0].low, 4);
+  BOOST_CHECK(!distributions[7].window_ticks);
+  BOOST_REQUIRE(distributions[7].link_count);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsMalformedFiles)
+{
+  BOOST_CHECK_THROW(load_distribution_file("/nonexistent/trigemu_distributions"), DistributionFileError);
+  for (auto contents : { "1 window_ticks 1000 1999\n",
+                         "1 window_ticks 1000 1999 1 extra\n",
+                         "1 readout_ticks 1000 1999 1\n",
+                         "1 window_ticks 2000 1999 1\n",
+                         "1 window_ticks -5 10 1\n",
+                         "1 window_ticks 1 10 -1\n",
+                         "70000 link_count 1 10 1\n",
+                         "1 link_count 1 10 0\n1 link_count 11 20 0\n" }) {
+    DistributionFile file(contents);
+    BOOST_CHECK_THROW(load_distribution_file(file.path), DistributionFileError);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,223 @@
+/**
+ * @file OpenDecisionTracker_test.cxx OpenDecisionTracker class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/OpenDecisionTracker.hpp"
+
+#define BOOST_TEST_MODULE OpenDecisionTracker_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(OpenDecisionTracker_test)
+
+namespace {
+
+using namespace std::chrono_literals;
+
+const OpenDecisionTracker::time_point s_start(std::chrono::hours(1000));
+
+dfmessages::TriggerDecision
+make_decision(dfmessages::trigger_number_t trigger_number)
+{
+  dfmessages::TriggerDecision decision;
+  decision.trigger_number = trigger_number;
+  decision.trigger_timestamp = 1000 * trigger_number;
+  return decision;
+}
+
+std::vector<dfmessages::trigger_number_t>
+expired_numbers(OpenDecisionTracker& tracker, OpenDecisionTracker::time_point now)
+{
+  std::vector<OpenDecisionTracker::Expired> expired;
+  tracker.collect_expired(now, expired);
+  std::vector<dfmessages::trigger_number_t> numbers;
+  for (auto const& e : expired) {
+    numbers.push_back(e.trigger_number);
+  }
+  return numbers;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(OpenAndClose)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(0ms, 0);
+  for (dfmessages::trigger_number_t tn = 1; tn <= 5; ++tn) {
+    tracker.open(make_decision(tn), s_start + tn * 1ms);
+  }
+  BOOST_CHECK_EQUAL(tracker.size(), 5);
+  BOOST_CHECK(tracker.oldest_age(s_start + 11ms) == 10ms);
+
+  Clock::duration open_for;
+  BOOST_CHECK(tracker.close(1, s_start + 21ms, open_for));
+  BOOST_CHECK(open_for == 20ms);
+  BOOST_CHECK(!tracker.close(1));
+  BOOST_CHECK(tracker.close(4));
+  BOOST_CHECK((tracker.open_trigger_numbers() == std::vector<dfmessages::trigger_number_t>{ 2, 3, 5 }));
+  BOOST_CHECK_EQUAL(tracker.peak_size(), 5);
+
+  // Without a timeout nothing expires
+  BOOST_CHECK(expired_numbers(tracker, s_start + 24h).empty());
+
+  tracker.clear();
+  BOOST_CHECK_EQUAL(tracker.size(), 0);
+  BOOST_CHECK_EQUAL(tracker.peak_size(), 0);
+  BOOST_CHECK(tracker.oldest_age(s_start) == 0ms);
+}
+
+BOOST_AUTO_TEST_CASE(ExpiresAfterTimeoutNotBefore)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(100ms, 0, 10ms);
+  tracker.open(make_decision(1), s_start);
+  tracker.open(make_decision(2), s_start + 50ms);
+  tracker.open(make_decision(3), s_start + 60ms);
+  tracker.close(3);
+
+  for (auto t = s_start; t < s_start + 100ms; t += 1ms) {
+    BOOST_REQUIRE(expired_numbers(tracker, t).empty());
+  }
+  // At most one resolution step late
+  std::vector<dfmessages::trigger_number_t> expired;
+  for (auto t = s_start + 100ms; t <= s_start + 170ms; t += 1ms) {
+    auto now_expired = expired_numbers(tracker, t);
+    expired.insert(expired.end(), now_expired.begin(), now_expired.end());
+    if (t == s_start + 120ms) {
+      BOOST_CHECK((expired == std::vector<dfmessages::trigger_number_t>{ 1 }));
+    }
+  }
+  BOOST_CHECK((expired == std::vector<dfmessages::trigger_number_t>{ 1, 2 }));
+  // Expired decisions stay open, and don't expire again
+  BOOST_CHECK_EQUAL(tracker.size(), 2);
+  BOOST_CHECK(expired_numbers(tracker, s_start + 1h).empty());
+}
+
+BOOST_AUTO_TEST_CASE(LongGapAndLaterTurns)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(100ms, 0, 10ms);
+  tracker.open(make_decision(1), s_start);
+  // Shares a bucket with 1's deadline, one turn of the wheel later
+  BOOST_CHECK(expired_numbers(tracker, s_start + 20ms).empty());
+  tracker.open(make_decision(2), s_start + 120ms);
+  BOOST_CHECK((expired_numbers(tracker, s_start + 115ms) == std::vector<dfmessages::trigger_number_t>{ 1 }));
+  BOOST_CHECK((expired_numbers(tracker, s_start + 235ms) == std::vector<dfmessages::trigger_number_t>{ 2 }));
+
+  // Not collected for a long time: everything due comes out at once
+  tracker.open(make_decision(3), s_start + 300ms);
+  tracker.open(make_decision(4), s_start + 350ms);
+  BOOST_CHECK((expired_numbers(tracker, s_start + 1h) == std::vector<dfmessages::trigger_number_t>{ 3, 4 }));
+}
+
+BOOST_AUTO_TEST_CASE(RearmAndJournal)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(100ms, 2, 10ms);
+  for (dfmessages::trigger_number_t tn = 1; tn <= 3; ++tn) {
+    tracker.open(make_decision(tn), s_start);
+  }
+  std::vector<OpenDecisionTracker::Expired> expired;
+  tracker.collect_expired(s_start + 200ms, expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 3);
+  size_t journaled = 0;
+  for (auto const& e : expired) {
+    BOOST_CHECK_EQUAL(e.resends, 0);
+    BOOST_CHECK(e.age == 200ms);
+    if (e.journaled) {
+      ++journaled;
+      BOOST_CHECK_EQUAL(e.decision.trigger_number, e.trigger_number);
+      BOOST_CHECK_EQUAL(e.decision.trigger_timestamp, 1000 * e.trigger_number);
+    }
+  }
+  // Only as many as the journal holds
+  BOOST_CHECK_EQUAL(journaled, 2);
+
+  // Sent again: it expires once more after another timeout, counting the resend
+  tracker.rearm(1, s_start + 200ms);
+  BOOST_CHECK(expired_numbers(tracker, s_start + 290ms).empty());
+  expired.clear();
+  tracker.collect_expired(s_start + 320ms, expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1);
+  BOOST_CHECK_EQUAL(expired[0].trigger_number, 1);
+  BOOST_CHECK_EQUAL(expired[0].resends, 1);
+
+  // Closing frees a journal slot for the next decision
+  tracker.close(1);
+  tracker.open(make_decision(4), s_start + 400ms);
+  expired.clear();
+  tracker.collect_expired(s_start + 600ms, expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1);
+  BOOST_CHECK(expired[0].journaled);
+}
+
+BOOST_AUTO_TEST_CASE(ReclaimedTokensAreRecognised)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(100ms, 10, 10ms);
+  tracker.open(make_decision(1), s_start);
+  tracker.open(make_decision(2), s_start);
+  tracker.reclaim(1);
+  BOOST_CHECK_EQUAL(tracker.size(), 1);
+  BOOST_CHECK(!tracker.close(1));
+  // Its token turns up late, once
+  BOOST_CHECK(tracker.take_late_token(1));
+  BOOST_CHECK(!tracker.take_late_token(1));
+  BOOST_CHECK(!tracker.take_late_token(2));
+  // A reclaimed decision doesn't expire
+  BOOST_CHECK((expired_numbers(tracker, s_start + 1h) == std::vector<dfmessages::trigger_number_t>{ 2 }));
+}
+
+BOOST_AUTO_TEST_CASE(ResentCopiesTokensAreLate)
+{
+  OpenDecisionTracker tracker;
+  tracker.configure(100ms, 10, 10ms);
+  tracker.open(make_decision(1), s_start);
+  tracker.open(make_decision(2), s_start);
+  tracker.open(make_decision(3), s_start);
+  BOOST_REQUIRE_EQUAL(expired_numbers(tracker, s_start + 200ms).size(), 3);
+  // All three are sent again, 1 twice
+  for (dfmessages::trigger_number_t tn = 1; tn <= 3; ++tn) {
+    tracker.rearm(tn, s_start + 200ms);
+  }
+  BOOST_REQUIRE_EQUAL(expired_numbers(tracker, s_start + 400ms).size(), 3);
+  tracker.rearm(1, s_start + 400ms);
+
+  // The first token for each closes it, and the later ones are late
+  BOOST_CHECK(tracker.close(1));
+  BOOST_CHECK(!tracker.close(1));
+  BOOST_CHECK(tracker.take_late_token(1));
+  BOOST_CHECK(tracker.take_late_token(1));
+  BOOST_CHECK(!tracker.take_late_token(1));
+
+  BOOST_CHECK(tracker.close(2));
+  BOOST_CHECK(tracker.take_late_token(2));
+  BOOST_CHECK(!tracker.take_late_token(2));
+
+  // A reclaimed decision that was sent again has a token to come for each copy
+  tracker.reclaim(3);
+  BOOST_CHECK(!tracker.close(3));
+  BOOST_CHECK(tracker.take_late_token(3));
+  BOOST_CHECK(tracker.take_late_token(3));
+  BOOST_CHECK(!tracker.take_late_token(3));
+  BOOST_CHECK_EQUAL(tracker.size(), 0);
+
+  // A decision that was never sent again has no late tokens
+  tracker.open(make_decision(4), s_start + 400ms);
+  BOOST_CHECK(tracker.close(4));
+  BOOST_CHECK(!tracker.take_late_token(4));
+  // Nor does one that was never open
+  BOOST_CHECK(!tracker.take_late_token(5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+/**
+ * @file RateSchedule_test.cxx RateSchedule class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/RateSchedule.hpp"
+
+#define BOOST_TEST_MODULE RateSchedule_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(RateSchedule_test)
+
+namespace {
+
+constexpr uint64_t s_clock_frequency_hz = 50'000'000; // NOLINT(build/unsigned)
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(Models)
+{
+  RateScheduleParams params;
+  BOOST_CHECK(make_rate_steps(params).empty());
+
+  params.model = "linear";
+  params.start_rate_hz = 100;
+  params.end_rate_hz = 400;
+  params.step_count = 4;
+  params.step_duration = std::chrono::milliseconds(500);
+  auto steps = make_rate_steps(params);
+  BOOST_REQUIRE_EQUAL(steps.size(), 4);
+  BOOST_CHECK_CLOSE(steps[0].rate_hz, 100, 1e-9);
+  BOOST_CHECK_CLOSE(steps[1].rate_hz, 200, 1e-9);
+  BOOST_CHECK_CLOSE(steps[3].rate_hz, 400, 1e-9);
+  BOOST_CHECK(steps[2].duration == std::chrono::milliseconds(500));
+
+  params.model = "exponential";
+  params.end_rate_hz = 800;
+  steps = make_rate_steps(params);
+  BOOST_REQUIRE_EQUAL(steps.size(), 4);
+  BOOST_CHECK_CLOSE(steps[1].rate_hz, 200, 1e-9);
+  BOOST_CHECK_CLOSE(steps[2].rate_hz, 400, 1e-9);
+  BOOST_CHECK_CLOSE(steps[3].rate_hz, 800, 1e-9);
+
+  params.model = "staircase";
+  BOOST_CHECK_THROW(make_rate_steps(params), InvalidRateSchedule);
+  params.steps = { RateStep{ 10, std::chrono::milliseconds(100) }, RateStep{ 0, std::chrono::milliseconds(100) } };
+  BOOST_CHECK_THROW(make_rate_steps(params), InvalidRateSchedule);
+  params.steps[1].rate_hz = 20;
+  BOOST_CHECK_EQUAL(make_rate_steps(params).size(), 2);
+
+  params.model = "sawtooth";
+  BOOST_CHECK_THROW(make_rate_steps(params), InvalidRateSchedule);
+}
+
+BOOST_AUTO_TEST_CASE(StepsAreLaidOutFromTheStart)
+{
+  std::vector<RateStep> steps{ { 100, std::chrono::milliseconds(10) }, { 200, std::chrono::milliseconds(20) } };
+  RateSchedule schedule(steps, s_clock_frequency_hz, 500'000, 100, 0.05);
+  const dfmessages::timestamp_t start = 1'000'000;
+  const dfmessages::timestamp_t ticks_per_ms = s_clock_frequency_hz / 1000;
+  schedule.start(start);
+  BOOST_CHECK_EQUAL(schedule.step_at(start), 0);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 10 * ticks_per_ms - 1), 0);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 10 * ticks_per_ms), 1);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 30 * ticks_per_ms - 1), 1);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 30 * ticks_per_ms), 2);
+
+  // Started again later, eg after a pause, the steps move with it
+  schedule.start(start + 100 * ticks_per_ms);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 100 * ticks_per_ms), 0);
+  BOOST_CHECK_EQUAL(schedule.step_at(start + 115 * ticks_per_ms), 1);
+}
+
+BOOST_AUTO_TEST_CASE(RateIsSharedBetweenTheStreams)
+{
+  std::vector<RateStep> steps{ { 100, std::chrono::milliseconds(10) }, { 400, std::chrono::milliseconds(10) } };
+
+  // One stream at the configured interval of 1 ms: the interval gives the rate directly
+  RateSchedule one_stream(steps, s_clock_frequency_hz, 50'000, 1000, 0.05);
+  BOOST_CHECK_EQUAL(one_stream.get_interval_ticks(0), s_clock_frequency_hz / 100);
+  BOOST_CHECK_EQUAL(one_stream.get_interval_ticks(1), s_clock_frequency_hz / 400);
+
+  // Two streams at 1 kHz each: each runs at half the step's rate, so the intervals double
+  RateSchedule two_streams(steps, s_clock_frequency_hz, 50'000, 2000, 0.05);
+  BOOST_CHECK_EQUAL(two_streams.get_interval_ticks(0), 2 * s_clock_frequency_hz / 100);
+  BOOST_CHECK_EQUAL(two_streams.get_interval_ticks(1), 2 * s_clock_frequency_hz / 400);
+}
+
+BOOST_AUTO_TEST_CASE(StepReports)
+{
+  std::vector<RateStep> steps{ { 1000, std::chrono::milliseconds(100) }, { 2000, std::chrono::milliseconds(100) } };
+  RateSchedule schedule(steps, s_clock_frequency_hz, 50'000, 1000, 0.05);
+  const dfmessages::timestamp_t ticks_per_ms = s_clock_frequency_hz / 1000;
+  schedule.start(0);
+
+  // All 100 sent, a few late
+  for (int i = 0; i < 100; ++i) {
+    schedule.count_sent(i < 95 ? 0 : 1000);
+  }
+  auto report = schedule.end_step(100 * ticks_per_ms, 0.01, 0);
+  BOOST_CHECK_EQUAL(report.step, 0);
+  BOOST_CHECK_EQUAL(report.triggers, 100);
+  BOOST_CHECK_CLOSE(report.achieved_rate_hz, 1000, 1e-9);
+  BOOST_CHECK_EQUAL(report.lateness_p50_us, 0);
+  BOOST_CHECK_EQUAL(report.lateness_max_us, 1000);
+  BOOST_CHECK(!report.saturated);
+
+  // A tenth skipped, and cut short half way by the end of the run
+  schedule.begin_step(1);
+  for (int i = 0; i < 100; ++i) {
+    if (i % 10 == 0) {
+      schedule.count_skipped();
+    } else {
+      schedule.count_sent(0);
+    }
+  }
+  report = schedule.end_step(150 * ticks_per_ms, 0, 0);
+  BOOST_CHECK_EQUAL(report.step, 1);
+  BOOST_CHECK_EQUAL(report.skipped, 10);
+  BOOST_CHECK_CLOSE(report.achieved_rate_hz, 90 * 1000 / 50., 1e-9);
+  BOOST_CHECK(report.saturated);
+
+  // Inhibited for too long also counts
+  schedule.begin_step(0);
+  schedule.count_sent(0);
+  BOOST_CHECK(schedule.end_step(100 * ticks_per_ms, 0.2, 0).saturated);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,199 @@
+/**
+ * @file RegionInhibits_test.cxx RegionInhibits class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/RegionInhibits.hpp"
+
+#define BOOST_TEST_MODULE RegionInhibits_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(RegionInhibits_test)
+
+namespace {
+
+dfmessages::GeoID
+make_link(uint32_t element_id) // NOLINT(build/unsigned)
+{
+  dfmessages::GeoID link;
+  link.element_id = element_id;
+  return link;
+}
+
+// One component for each link
+dfmessages::TriggerDecision
+make_decision(const std::vector<uint32_t>& element_ids) // NOLINT(build/unsigned)
+{
+  dfmessages::TriggerDecision decision;
+  for (auto element_id : element_ids) {
+    dfmessages::ComponentRequest request;
+    request.component = make_link(element_id);
+    decision.components.push_back(request);
+  }
+  return decision;
+}
+
+// apa0 has links 0-2, apa1 links 2-4, so link 2 is in both
+void
+configure_two_regions(RegionInhibits& regions, RegionInhibitPolicy policy = RegionInhibitPolicy::kMask)
+{
+  std::vector<std::unique_ptr<RegionInhibits::Region>> list;
+  list.push_back(std::make_unique<RegionInhibits::Region>("apa0", std::vector<uint32_t>{ 0, 1, 2 })); // NOLINT
+  list.push_back(std::make_unique<RegionInhibits::Region>("apa1", std::vector<uint32_t>{ 2, 3, 4 })); // NOLINT
+  regions.configure(policy, std::move(list));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ParsesPolicies)
+{
+  BOOST_CHECK(parse_region_inhibit_policy("mask") == RegionInhibitPolicy::kMask);
+  BOOST_CHECK(parse_region_inhibit_policy("stream") == RegionInhibitPolicy::kStream);
+  BOOST_CHECK_THROW(parse_region_inhibit_policy("Mask"), InvalidRegionInhibitPolicy);
+  BOOST_CHECK_THROW(parse_region_inhibit_policy(""), InvalidRegionInhibitPolicy);
+}
+
+BOOST_AUTO_TEST_CASE(RegionsOfLinks)
+{
+  RegionInhibits regions;
+  configure_two_regions(regions, RegionInhibitPolicy::kStream);
+  BOOST_CHECK(regions.get_policy() == RegionInhibitPolicy::kStream);
+  BOOST_REQUIRE_EQUAL(regions.size(), 2);
+  BOOST_CHECK_EQUAL(regions.get_name(0), "apa0");
+  BOOST_CHECK_EQUAL(regions.get_name(1), "apa1");
+
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(0)), 0b01);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(2)), 0b11);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(4)), 0b10);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(5)), 0);
+  BOOST_CHECK_EQUAL(regions.regions_of(std::vector<dfmessages::GeoID>{ make_link(1), make_link(5) }), 0b01);
+  BOOST_CHECK_EQUAL(regions.regions_of(std::vector<dfmessages::GeoID>{ make_link(0), make_link(3) }), 0b11);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_decision({ 3, 4, 7 })), 0b10);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_decision({})), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BusyRegions)
+{
+  RegionInhibits regions;
+  configure_two_regions(regions);
+  BOOST_CHECK_EQUAL(regions.busy_regions(), 0);
+
+  regions.set_busy(1, true, 1000);
+  BOOST_CHECK_EQUAL(regions.busy_regions(), 0b10);
+  regions.set_busy(0, true, 1500);
+  BOOST_CHECK_EQUAL(regions.busy_regions(), 0b11);
+  // Being told again doesn't start a new spell
+  regions.set_busy(1, true, 1800);
+  regions.set_busy(1, false, 2000);
+  BOOST_CHECK_EQUAL(regions.busy_regions(), 0b01);
+
+  // apa0 is still busy at the end of the run, which closes its spell
+  regions.end_run(4000);
+  std::vector<uint64_t> busy_us; // NOLINT(build/unsigned)
+  std::vector<bool> busy;
+  regions.for_each_region([&](RegionInhibits::Region& region) {
+    busy_us.push_back(region.busy_time.total_us(10'000));
+    busy.push_back(region.busy.load());
+  });
+  BOOST_REQUIRE_EQUAL(busy_us.size(), 2);
+  BOOST_CHECK_EQUAL(busy_us[0], 2500);
+  BOOST_CHECK_EQUAL(busy_us[1], 1000);
+  BOOST_CHECK(busy[0]);
+  BOOST_CHECK(!busy[1]);
+
+  regions.reset();
+  BOOST_CHECK_EQUAL(regions.busy_regions(), 0);
+  regions.for_each_region([&](RegionInhibits::Region& region) {
+    BOOST_CHECK(!region.busy.load());
+    BOOST_CHECK_EQUAL(region.busy_time.total_us(10'000), 0);
+  });
+}
+
+BOOST_AUTO_TEST_CASE(MasksBusyComponents)
+{
+  RegionInhibits regions;
+  configure_two_regions(regions);
+
+  auto decision = make_decision({ 0, 2, 3, 5, 1 });
+  // Only apa1 is busy: link 2 goes because it's in apa1 as well, and link 5 is in no region
+  BOOST_CHECK_EQUAL(regions.mask(decision, 0b10), 2);
+  std::vector<uint32_t> left; // NOLINT(build/unsigned)
+  for (auto const& request : decision.components) {
+    left.push_back(request.component.element_id);
+  }
+  const std::vector<uint32_t> expected{ 0, 5, 1 }; // NOLINT(build/unsigned)
+  BOOST_CHECK_EQUAL_COLLECTIONS(left.begin(), left.end(), expected.begin(), expected.end());
+
+  // Both busy: link 2 counts against both regions
+  auto both = make_decision({ 2 });
+  BOOST_CHECK_EQUAL(regions.mask(both, 0b11), 1);
+  BOOST_CHECK(both.components.empty());
+  BOOST_CHECK_EQUAL(regions.mask(both, 0b11), 0);
+
+  regions.count_suppressed(0b01);
+  regions.count_suppressed(0b11);
+  std::vector<uint64_t> masked, suppressed; // NOLINT(build/unsigned)
+  regions.for_each_region([&](RegionInhibits::Region& region) {
+    masked.push_back(region.masked_components.load());
+    suppressed.push_back(region.suppressed.load());
+  });
+  BOOST_CHECK_EQUAL(masked[0], 1);
+  BOOST_CHECK_EQUAL(masked[1], 3);
+  BOOST_CHECK_EQUAL(suppressed[0], 2);
+  BOOST_CHECK_EQUAL(suppressed[1], 1);
+
+  regions.reset();
+  regions.for_each_region([&](RegionInhibits::Region& region) {
+    BOOST_CHECK_EQUAL(region.masked_components.load(), 0);
+    BOOST_CHECK_EQUAL(region.suppressed.load(), 0);
+  });
+}
+
+BOOST_AUTO_TEST_CASE(RejectsBadRegions)
+{
+  RegionInhibits regions;
+  configure_two_regions(regions);
+
+  std::vector<std::unique_ptr<RegionInhibits::Region>> repeated;
+  repeated.push_back(std::make_unique<RegionInhibits::Region>("apa0", std::vector<uint32_t>{ 0 })); // NOLINT
+  repeated.push_back(std::make_unique<RegionInhibits::Region>("apa0", std::vector<uint32_t>{ 1 })); // NOLINT
+  BOOST_CHECK_THROW(regions.configure(RegionInhibitPolicy::kMask, std::move(repeated)), InvalidInhibitRegion);
+
+  std::vector<std::unique_ptr<RegionInhibits::Region>> too_many;
+  for (uint32_t i = 0; i <= RegionInhibits::s_max_regions; ++i) { // NOLINT(build/unsigned)
+    too_many.push_back(std::make_unique<RegionInhibits::Region>("region" + std::to_string(i),
+                                                                std::vector<uint32_t>{ i })); // NOLINT
+  }
+  BOOST_CHECK_THROW(regions.configure(RegionInhibitPolicy::kMask, std::move(too_many)), InvalidInhibitRegion);
+
+  // The regions that were there are kept
+  BOOST_REQUIRE_EQUAL(regions.size(), 2);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(2)), 0b11);
+
+  // As many as there can be is fine, and the last one gets the top bit
+  std::vector<std::unique_ptr<RegionInhibits::Region>> most;
+  for (uint32_t i = 0; i < RegionInhibits::s_max_regions; ++i) { // NOLINT(build/unsigned)
+    most.push_back(std::make_unique<RegionInhibits::Region>("region" + std::to_string(i),
+                                                            std::vector<uint32_t>{ i })); // NOLINT
+  }
+  regions.configure(RegionInhibitPolicy::kMask, std::move(most));
+  BOOST_CHECK_EQUAL(regions.size(), RegionInhibits::s_max_regions);
+  BOOST_CHECK_EQUAL(regions.regions_of(make_link(RegionInhibits::s_max_regions - 1)), uint64_t{ 1 } << 63);
+  regions.set_busy(RegionInhibits::s_max_regions - 1, true, 0);
+  BOOST_CHECK_EQUAL(regions.busy_regions(), uint64_t{ 1 } << 63);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+/**
+ * @file SPSCRing_test.cxx SPSCRing class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/SPSCRing.hpp"
+
+#define BOOST_TEST_MODULE SPSCRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(SPSCRing_test)
+
+BOOST_AUTO_TEST_CASE(CapacityIsAPowerOfTwo)
+{
+  BOOST_CHECK_EQUAL(SPSCRing<int>(1).capacity(), 1);
+  BOOST_CHECK_EQUAL(SPSCRing<int>(5).capacity(), 8);
+  BOOST_CHECK_EQUAL(SPSCRing<int>(64).capacity(), 64);
+  BOOST_CHECK_EQUAL(SPSCRing<int>(65).capacity(), 128);
+}
+
+BOOST_AUTO_TEST_CASE(FirstInFirstOut)
+{
+  SPSCRing<int> ring(4);
+  int item = 0;
+  BOOST_CHECK(!ring.try_pop(item));
+
+  // Round the ring several times
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      BOOST_REQUIRE(ring.try_push(round * 10 + i));
+    }
+    BOOST_CHECK(!ring.try_push(-1));
+    for (int i = 0; i < 4; ++i) {
+      BOOST_REQUIRE(ring.try_pop(item));
+      BOOST_CHECK_EQUAL(item, round * 10 + i);
+    }
+    BOOST_CHECK(!ring.try_pop(item));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FullRingTakesMoreOnceEmptied)
+{
+  SPSCRing<int> ring(2);
+  int item = 0;
+  BOOST_REQUIRE(ring.try_push(1));
+  BOOST_REQUIRE(ring.try_push(2));
+  BOOST_CHECK(!ring.try_push(3));
+  BOOST_REQUIRE(ring.try_pop(item));
+  BOOST_CHECK_EQUAL(item, 1);
+  BOOST_CHECK(ring.try_push(3));
+  BOOST_CHECK(!ring.try_push(4));
+}
+
+BOOST_AUTO_TEST_CASE(SlotsKeepTheirCapacity)
+{
+  // Pushing copies into the slot, and popping swaps the slot with the
+  // caller's item, so a slot's capacity is reused next time round
+  SPSCRing<std::vector<int>> ring(1);
+  std::vector<int> item(100, 1);
+  BOOST_REQUIRE(ring.try_push(item));
+  std::vector<int> popped;
+  BOOST_REQUIRE(ring.try_pop(popped));
+  BOOST_CHECK_EQUAL(popped.size(), 100);
+
+  popped.assign(3, 2);
+  BOOST_REQUIRE(ring.try_push(popped));
+  BOOST_REQUIRE(ring.try_pop(item));
+  BOOST_CHECK_EQUAL(item.size(), 3);
+  BOOST_CHECK_EQUAL(item[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(ProducerAndConsumerThreads)
+{
+  constexpr uint64_t count = 1'000'000; // NOLINT(build/unsigned)
+  SPSCRing<uint64_t> ring(256);         // NOLINT(build/unsigned)
+
+  std::thread producer([&]() {
+    for (uint64_t i = 0; i < count; ++i) { // NOLINT(build/unsigned)
+      while (!ring.try_push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint64_t expected = 0; // NOLINT(build/unsigned)
+  bool in_order = true;
+  while (expected < count) {
+    uint64_t item = 0; // NOLINT(build/unsigned)
+    if (ring.try_pop(item)) {
+      in_order = in_order && item == expected;
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  BOOST_CHECK(in_order);
+  uint64_t item = 0; // NOLINT(build/unsigned)
+  BOOST_CHECK(!ring.try_pop(item));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+/**
+ * @file SeqLock_test.cxx SeqLock class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/SeqLock.hpp"
+
+#define BOOST_TEST_MODULE SeqLock_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(SeqLock_test)
+
+namespace {
+
+// Every word holds the same number, so a torn copy shows
+struct Words
+{
+  uint64_t words[16]; // NOLINT(build/unsigned)
+};
+
+Words
+make_words(uint64_t value) // NOLINT(build/unsigned)
+{
+  Words words;
+  for (auto& word : words.words) {
+    word = value;
+  }
+  return words;
+}
+
+bool
+consistent(const Words& words)
+{
+  for (auto word : words.words) {
+    if (word != words.words[0]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(LoadsWhatWasStored)
+{
+  SeqLock<Words> lock;
+  BOOST_CHECK_EQUAL(lock.load().words[0], 0);
+
+  lock.store(make_words(5));
+  Words words{};
+  BOOST_REQUIRE(lock.try_load(words, 1));
+  BOOST_CHECK(consistent(words));
+  BOOST_CHECK_EQUAL(words.words[0], 5);
+
+  lock.store(make_words(6));
+  BOOST_CHECK_EQUAL(lock.load().words[15], 6);
+}
+
+BOOST_AUTO_TEST_CASE(ReadersNeverSeeATornValue)
+{
+  SeqLock<Words> lock;
+  std::atomic<bool> done{ false };
+  const uint64_t last = 200'000; // NOLINT(build/unsigned)
+
+  std::vector<std::thread> readers;
+  std::atomic<int> torn{ 0 };
+  std::atomic<int> went_back{ 0 };
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&]() {
+      uint64_t previous = 0; // NOLINT(build/unsigned)
+      while (!done.load()) {
+        Words words;
+        if (!lock.try_load(words, 100)) {
+          continue;
+        }
+        torn += consistent(words) ? 0 : 1;
+        // The writer only counts up
+        went_back += words.words[0] < previous ? 1 : 0;
+        previous = words.words[0];
+      }
+    });
+  }
+  for (uint64_t value = 1; value <= last; ++value) { // NOLINT(build/unsigned)
+    lock.store(make_words(value));
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  BOOST_CHECK_EQUAL(torn.load(), 0);
+  BOOST_CHECK_EQUAL(went_back.load(), 0);
+  BOOST_CHECK_EQUAL(lock.load().words[0], last);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,294 @@
+/**
+ * @file ShardedTimeline_test.cxx ShardedTimeline class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ShardedTimeline.hpp"
+
+#define BOOST_TEST_MODULE ShardedTimeline_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(ShardedTimeline_test)
+
+namespace {
+
+constexpr dfmessages::timestamp_t s_epoch_ticks = 1'000'000;
+const std::vector<dfmessages::timestamp_t> s_intervals{ 1000, 3000 };
+const std::vector<dfmessages::timestamp_t> s_resume_intervals{ 500, 1500 };
+constexpr int s_repeat_count = 3;
+
+// One emulator instance, as the sending thread drives its timeline
+struct Instance
+{
+  Instance(uint64_t shard_count, uint64_t shard_index, dfmessages::timestamp_t start) // NOLINT(build/unsigned)
+    : timeline(shard_count, shard_index, s_epoch_ticks, s_repeat_count)
+    , start_estimate(start)
+  {
+    const dfmessages::timestamp_t origin = timeline.origin(start);
+    const std::vector<std::string> models{ "poisson", "periodic" };
+    for (size_t i = 0; i < models.size(); ++i) {
+      ArrivalModelParams params;
+      params.model = models[i];
+      params.interval_ticks = s_intervals[i];
+      params.seed = 1000 + i;
+      timeline.add_stream(make_arrival_model(params), (origin / s_intervals[i] + 1) * s_intervals[i]);
+    }
+    // The slots that had passed before the start
+    while (timeline.is_sharded() && timeline.front_timestamp() <= start) {
+      timeline.advance();
+    }
+  }
+
+  // Pass every slot that is due by `estimate`, sending our own
+  void run_until(dfmessages::timestamp_t estimate)
+  {
+    while (timeline.front_timestamp() <= estimate) {
+      passed[timeline.slot()] = timeline.front_timestamp();
+      if (timeline.owns_slot()) {
+        sent[timeline.slot()] = timeline.front_timestamp();
+      }
+      timeline.advance();
+    }
+  }
+
+  ShardedTimeline timeline;
+  dfmessages::timestamp_t start_estimate;
+  std::map<uint64_t, dfmessages::timestamp_t> passed; // NOLINT(build/unsigned)
+  std::map<uint64_t, dfmessages::timestamp_t> sent;   // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Run shard_count instances, each started and resumed at its own
+ * time, on a common timestamp estimate, up to `end`
+ */
+std::vector<std::unique_ptr<Instance>>
+run_shards(const std::vector<dfmessages::timestamp_t>& starts,
+           const std::vector<dfmessages::timestamp_t>& resumes,
+           dfmessages::timestamp_t end,
+           bool resume_at_once = false)
+{
+  std::vector<std::unique_ptr<Instance>> instances(starts.size());
+  std::vector<bool> resumed(starts.size(), false);
+  for (dfmessages::timestamp_t estimate = 0; estimate <= end; estimate += 100) {
+    for (size_t i = 0; i < starts.size(); ++i) {
+      if (!instances[i] && estimate >= starts[i]) {
+        instances[i] = std::make_unique<Instance>(starts.size(), i, estimate);
+      }
+      if (!instances[i]) {
+        continue;
+      }
+      if (!resumed[i] && estimate >= resumes[i]) {
+        instances[i]->timeline.set_intervals(s_resume_intervals, resume_at_once);
+        resumed[i] = true;
+      }
+      instances[i]->run_until(estimate);
+    }
+  }
+  return instances;
+}
+
+// Whether the instances agree on every slot that more than one of them passed
+bool
+timelines_agree(const std::vector<std::unique_ptr<Instance>>& instances)
+{
+  std::map<uint64_t, dfmessages::timestamp_t> all; // NOLINT(build/unsigned)
+  for (auto const& instance : instances) {
+    for (auto const& [slot, timestamp] : instance->passed) {
+      auto [it, added] = all.emplace(slot, timestamp);
+      if (!added && it->second != timestamp) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Number the decisions an instance sent, as the plugin does:
+ * s_repeat_count for each of its triggers, except those in the slots
+ * that `skipped` says were inhibited, then a stop burst of burst_count
+ */
+std::vector<dfmessages::trigger_number_t>
+number_decisions(const Instance& instance,
+                 const std::function<bool(uint64_t)>& skipped, // NOLINT(build/unsigned)
+                 int burst_count)
+{
+  std::vector<dfmessages::trigger_number_t> numbers;
+  dfmessages::trigger_number_t last_sent = 0;
+  for (auto const& [slot, timestamp] : instance.sent) {
+    if (skipped(slot)) {
+      continue;
+    }
+    const dfmessages::trigger_number_t first = instance.timeline.trigger_number(slot, last_sent);
+    for (int i = 0; i < s_repeat_count; ++i) {
+      numbers.push_back(first + i);
+    }
+    last_sent = numbers.back();
+  }
+  for (int i = 0; i < burst_count; ++i) {
+    last_sent = instance.timeline.trigger_number(instance.timeline.stop_burst_slot(i), last_sent);
+    numbers.push_back(last_sent);
+  }
+  return numbers;
+}
+
+bool
+inhibited(uint64_t slot) // NOLINT(build/unsigned)
+{
+  return slot % 5 == 0 || slot % 7 == 3;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ShardsMergeIntoOneTimeline)
+{
+  // Started and resumed at different times within one epoch, with the resume picked up at different slots
+  const std::vector<dfmessages::timestamp_t> starts{ 10'200'000, 10'250'000, 10'400'000 };
+  const std::vector<dfmessages::timestamp_t> resumes{ 12'500'000, 12'503'000, 12'507'000 };
+  const dfmessages::timestamp_t end = 20'000'000;
+  auto instances = run_shards(starts, resumes, end);
+
+  BOOST_REQUIRE(timelines_agree(instances));
+
+  // Merge what they sent. From the last start on, every slot was sent by exactly one instance
+  std::map<uint64_t, dfmessages::timestamp_t> merged; // NOLINT(build/unsigned)
+  for (auto const& instance : instances) {
+    for (auto const& [slot, timestamp] : instance->sent) {
+      const bool first_time = merged.emplace(slot, timestamp).second;
+      BOOST_REQUIRE_MESSAGE(first_time, "Slot " << slot << " was sent twice");
+    }
+  }
+  const uint64_t first_slot = instances.back()->passed.begin()->first; // NOLINT(build/unsigned)
+  const uint64_t last_slot = merged.rbegin()->first; // NOLINT(build/unsigned)
+  for (uint64_t slot = first_slot; slot <= last_slot; ++slot) { // NOLINT(build/unsigned)
+    BOOST_REQUIRE_MESSAGE(merged.count(slot) == 1, "Slot " << slot << " wasn't sent");
+    if (slot > first_slot) {
+      BOOST_REQUIRE_GE(merged[slot], merged[slot - 1]);
+    }
+  }
+
+  // The new intervals took over at the epoch boundary: three times the rate after it
+  size_t before = 0;
+  size_t after = 0;
+  for (auto const& [slot, timestamp] : merged) {
+    if (timestamp >= 11'000'000 && timestamp < 13'000'000) {
+      ++before;
+    } else if (timestamp >= 13'000'000 && timestamp < 15'000'000) {
+      ++after;
+    }
+  }
+  BOOST_CHECK_GT(after, 1.8 * before);
+  BOOST_CHECK_LT(after, 2.2 * before);
+}
+
+BOOST_AUTO_TEST_CASE(ResumeTakenAtOnceWouldDiverge)
+{
+  // What the epoch boundary is for: picked up at different slots, the changes leave the timelines apart
+  const std::vector<dfmessages::timestamp_t> starts{ 10'200'000, 10'250'000, 10'400'000 };
+  const std::vector<dfmessages::timestamp_t> resumes{ 12'500'000, 12'503'000, 12'507'000 };
+  BOOST_CHECK(!timelines_agree(run_shards(starts, resumes, 14'000'000, true)));
+}
+
+BOOST_AUTO_TEST_CASE(RateStepTakenAtOnceAgrees)
+{
+  // A change every instance makes at the same estimate, as at a rate step, needn't wait
+  const std::vector<dfmessages::timestamp_t> starts{ 10'200'000, 10'250'000 };
+  const std::vector<dfmessages::timestamp_t> resumes{ 12'500'000, 12'500'000 };
+  auto instances = run_shards(starts, resumes, 14'000'000, true);
+  BOOST_CHECK(timelines_agree(instances));
+}
+
+BOOST_AUTO_TEST_CASE(ShardsNeverShareATriggerNumber)
+{
+  // Repeats, inhibited slots and stop bursts included
+  const std::vector<dfmessages::timestamp_t> starts{ 10'200'000, 10'250'000, 10'400'000 };
+  const std::vector<dfmessages::timestamp_t> resumes{ 12'500'000, 12'503'000, 12'507'000 };
+  auto instances = run_shards(starts, resumes, 14'000'000);
+
+  std::set<dfmessages::trigger_number_t> all;
+  size_t count = 0;
+  for (auto const& instance : instances) {
+    auto numbers = number_decisions(*instance, inhibited, 4);
+    BOOST_REQUIRE(std::is_sorted(numbers.begin(), numbers.end()));
+    for (auto number : numbers) {
+      const bool first_time = all.insert(number).second;
+      BOOST_REQUIRE_MESSAGE(first_time, "Trigger number " << number << " was sent twice");
+    }
+    count += numbers.size();
+  }
+  BOOST_CHECK_EQUAL(all.size(), count);
+  BOOST_CHECK_GT(count, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(UnshardedNumbersHaveNoGaps)
+{
+  auto instances = run_shards({ 10'200'000 }, { 12'500'000 }, 14'000'000);
+  auto numbers = number_decisions(*instances.front(), inhibited, 4);
+  BOOST_REQUIRE_GT(numbers.size(), 1000);
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(numbers[i], i + 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(UnshardedChangesAtOnce)
+{
+  ShardedTimeline timeline(1, 0, s_epoch_ticks, 2);
+  ArrivalModelParams params;
+  params.interval_ticks = 1000;
+  timeline.add_stream(make_arrival_model(params), 10'500'000);
+  BOOST_CHECK_EQUAL(timeline.origin(10'400'123), 10'400'123);
+  BOOST_CHECK_EQUAL(timeline.next_epoch(10'400'123), 10'400'123);
+  BOOST_CHECK(timeline.owns_slot());
+
+  timeline.set_intervals({ 10 }, false);
+  timeline.advance();
+  BOOST_CHECK_EQUAL(timeline.front_timestamp(), 10'500'010);
+  BOOST_CHECK_EQUAL(timeline.slot(), 1);
+  BOOST_CHECK_EQUAL(timeline.trigger_number(1, 41), 42);
+  BOOST_CHECK_EQUAL(timeline.stop_burst_slot(2), 3);
+}
+
+BOOST_AUTO_TEST_CASE(SlotsAreShared)
+{
+  ShardedTimeline timeline(3, 1, s_epoch_ticks, 2);
+  BOOST_CHECK_EQUAL(timeline.origin(10'400'123), 10'000'000);
+  BOOST_CHECK_EQUAL(timeline.next_epoch(10'400'123), 11'000'000);
+  BOOST_CHECK_EQUAL(timeline.next_epoch(11'000'000), 12'000'000);
+  BOOST_CHECK_EQUAL(timeline.next_owned_slot(0), 1);
+  BOOST_CHECK_EQUAL(timeline.next_owned_slot(1), 1);
+  BOOST_CHECK_EQUAL(timeline.next_owned_slot(2), 4);
+
+  ArrivalModelParams params;
+  params.interval_ticks = 1000;
+  timeline.add_stream(make_arrival_model(params), 10'001'000);
+  for (uint64_t slot = 0; slot < 10; ++slot) { // NOLINT(build/unsigned)
+    BOOST_CHECK_EQUAL(timeline.owns_slot(), slot % 3 == 1);
+    timeline.advance();
+  }
+  timeline.advance_slot();
+  BOOST_CHECK_EQUAL(timeline.slot(), 11);
+  BOOST_CHECK_EQUAL(timeline.front_timestamp(), 10'011'000);
+
+  // Each slot has two numbers, whatever was sent before
+  BOOST_CHECK_EQUAL(timeline.trigger_number(4, 0), 9);
+  BOOST_CHECK_EQUAL(timeline.trigger_number(7, 1000), 15);
+  BOOST_CHECK_EQUAL(timeline.stop_burst_slot(0), 13);
+  BOOST_CHECK_EQUAL(timeline.stop_burst_slot(1), 16);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+/**
+ * @file SharedTimestampEstimator_test.cxx acquire_shared_timestamp_estimator Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/SharedTimestampEstimator.hpp"
+
+#include "iomanager/Receiver.hpp"
+
+#include "dfmessages/TimeSync.hpp"
+#include "ers/Issue.hpp"
+
+#define BOOST_TEST_MODULE SharedTimestampEstimator_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(SharedTimestampEstimator_test)
+
+namespace {
+
+constexpr uint64_t s_clock_frequency_hz = 62'500'000; // NOLINT(build/unsigned)
+
+// A TimeSync queue that never has anything on it, and remembers which threads read it
+class FakeTimeSyncReceiver : public iomanager::ReceiverConcept<dfmessages::TimeSync>
+{
+public:
+  dfmessages::TimeSync receive(Receiver::timeout_t timeout) override
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_consumers.insert(std::this_thread::get_id());
+      ++m_receive_count;
+    }
+    std::this_thread::sleep_for(std::max(timeout, Receiver::timeout_t(1)));
+    throw iomanager::TimeoutExpired(ERS_HERE, "time_sync_q", "receive", timeout.count());
+  }
+  void add_callback(std::function<void(dfmessages::TimeSync&)> /*callback*/) override {}
+  void remove_callback() override {}
+
+  size_t consumer_count()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_consumers.size();
+  }
+  size_t receive_count()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_receive_count;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::set<std::thread::id> m_consumers;
+  size_t m_receive_count{ 0 };
+};
+
+// Wait for up to a second for someone to read from `receiver`
+bool
+wait_for_receive(FakeTimeSyncReceiver& receiver, size_t count = 1)
+{
+  for (int i = 0; i < 1000 && receiver.receive_count() < count; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return receiver.receive_count() >= count;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(TwoModulesShareOneConsumer)
+{
+  // Each module has its own receiver for the connection, and gets its clock from make_clock()
+  auto receiver1 = std::make_shared<FakeTimeSyncReceiver>();
+  auto receiver2 = std::make_shared<FakeTimeSyncReceiver>();
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> source1 = receiver1;
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> source2 = receiver2;
+
+  auto estimator1 =
+    acquire_shared_timestamp_estimator("time_sync_q", source1, s_clock_frequency_hz, 1, make_clock(false));
+  auto estimator2 =
+    acquire_shared_timestamp_estimator("time_sync_q", source2, s_clock_frequency_hz, 1, make_clock(false));
+
+  BOOST_REQUIRE_EQUAL(estimator1.get(), estimator2.get());
+  BOOST_CHECK_EQUAL(estimator1.use_count(), 2);
+
+  BOOST_REQUIRE(wait_for_receive(*receiver1, 10));
+  BOOST_CHECK_EQUAL(receiver1->consumer_count(), 1);
+  BOOST_CHECK_EQUAL(receiver2->receive_count(), 0);
+
+  // The estimator carries on for the module that still holds it
+  estimator1.reset();
+  BOOST_CHECK_EQUAL(estimator2.use_count(), 1);
+  auto before = receiver1->receive_count();
+  BOOST_CHECK(wait_for_receive(*receiver1, before + 1));
+
+  // and stops when the last one lets go
+  estimator2.reset();
+  before = receiver1->receive_count();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  BOOST_CHECK_EQUAL(receiver1->receive_count(), before);
+  BOOST_CHECK_EQUAL(receiver1->consumer_count(), 1);
+  BOOST_CHECK_EQUAL(receiver2->receive_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DifferentRunsAreNotShared)
+{
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> source = std::make_shared<FakeTimeSyncReceiver>();
+
+  auto estimator1 = acquire_shared_timestamp_estimator("time_sync_q", source, s_clock_frequency_hz, 1, make_clock(false));
+  auto estimator2 = acquire_shared_timestamp_estimator("time_sync_q", source, s_clock_frequency_hz, 2, make_clock(false));
+  BOOST_CHECK_NE(estimator1.get(), estimator2.get());
+
+  auto estimator3 =
+    acquire_shared_timestamp_estimator("other_time_sync_q", source, s_clock_frequency_hz, 1, make_clock(false));
+  BOOST_CHECK_NE(estimator1.get(), estimator3.get());
+
+  auto estimator4 = acquire_shared_timestamp_estimator("time_sync_q", source, s_clock_frequency_hz, 1, make_clock(true));
+  BOOST_CHECK_NE(estimator1.get(), estimator4.get());
+}
+
+BOOST_AUTO_TEST_CASE(ReleasedEstimatorIsReplaced)
+{
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> source = std::make_shared<FakeTimeSyncReceiver>();
+
+  auto estimator = acquire_shared_timestamp_estimator("time_sync_q", source, s_clock_frequency_hz, 3, make_clock(false));
+  std::weak_ptr<TimestampEstimator> released = estimator;
+  estimator.reset();
+  BOOST_CHECK(released.expired());
+
+  estimator = acquire_shared_timestamp_estimator("time_sync_q", source, s_clock_frequency_hz, 3, make_clock(false));
+  BOOST_CHECK(estimator != nullptr);
+  BOOST_CHECK_EQUAL(estimator.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
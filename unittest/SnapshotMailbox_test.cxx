@@ -0,0 +1,98 @@
+/**
+ * @file SnapshotMailbox_test.cxx SnapshotMailbox class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/SnapshotMailbox.hpp"
+
+#define BOOST_TEST_MODULE SnapshotMailbox_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(SnapshotMailbox_test)
+
+namespace {
+
+// Counts the live snapshots, so a leak or a double delete shows
+struct Snapshot
+{
+  explicit Snapshot(int snapshot_value)
+    : value(snapshot_value)
+  {
+    ++s_live;
+  }
+  ~Snapshot() { --s_live; }
+
+  int value;
+  static inline std::atomic<int> s_live{ 0 };
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(TakeEmptiesTheBox)
+{
+  SnapshotMailbox<Snapshot> mailbox;
+  BOOST_CHECK(mailbox.take() == nullptr);
+
+  mailbox.publish(std::make_unique<Snapshot>(1));
+  auto taken = mailbox.take();
+  BOOST_REQUIRE(taken != nullptr);
+  BOOST_CHECK_EQUAL(taken->value, 1);
+  BOOST_CHECK(mailbox.take() == nullptr);
+  taken.reset();
+  BOOST_CHECK_EQUAL(Snapshot::s_live.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LatestReplacesOneNotTaken)
+{
+  {
+    SnapshotMailbox<Snapshot> mailbox;
+    mailbox.publish(std::make_unique<Snapshot>(1));
+    mailbox.publish(std::make_unique<Snapshot>(2));
+    BOOST_CHECK_EQUAL(Snapshot::s_live.load(), 1);
+    auto taken = mailbox.take();
+    BOOST_REQUIRE(taken != nullptr);
+    BOOST_CHECK_EQUAL(taken->value, 2);
+
+    // Left in the box, and freed with it
+    mailbox.publish(std::make_unique<Snapshot>(3));
+  }
+  BOOST_CHECK_EQUAL(Snapshot::s_live.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(UserSeesSnapshotsInOrder)
+{
+  const int last = 100'000;
+  {
+    SnapshotMailbox<Snapshot> mailbox;
+    std::thread publisher([&]() {
+      for (int value = 1; value <= last; ++value) {
+        mailbox.publish(std::make_unique<Snapshot>(value));
+      }
+    });
+    // One publisher, so the user sees a rising sequence, and ends with the last one
+    int current = 0;
+    bool in_order = true;
+    while (current != last) {
+      if (auto taken = mailbox.take()) {
+        in_order = in_order && taken->value > current;
+        current = taken->value;
+      }
+    }
+    publisher.join();
+    BOOST_CHECK(in_order);
+    BOOST_CHECK(mailbox.take() == nullptr);
+  }
+  BOOST_CHECK_EQUAL(Snapshot::s_live.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
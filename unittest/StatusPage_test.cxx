@@ -0,0 +1,141 @@
+/**
+ * @file StatusPage_test.cxx StatusPageWriter, StatusPageReader and lateness histogram Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/StatusPage.hpp"
+
+#define BOOST_TEST_MODULE StatusPage_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(StatusPage_test)
+
+namespace {
+
+std::string
+page_name()
+{
+  static int count = 0;
+  return "/trigemu-status-test-" + std::to_string(::getpid()) + "-" + std::to_string(count++);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(LatenessBinsCoverEveryValue)
+{
+  // The first bins are one us wide
+  for (uint64_t us = 0; us < 4; ++us) { // NOLINT(build/unsigned)
+    BOOST_CHECK_EQUAL(statuspage::lateness_bin(us), us);
+  }
+  // Each bin ends where the next begins, and the values in it fall in it
+  for (size_t bin = 0; bin + 1 < statuspage::s_lateness_bins; ++bin) {
+    const uint64_t upper = statuspage::lateness_bin_upper_us(bin); // NOLINT(build/unsigned)
+    BOOST_REQUIRE_EQUAL(statuspage::lateness_bin(upper), bin);
+    BOOST_REQUIRE_EQUAL(statuspage::lateness_bin(upper + 1), bin + 1);
+  }
+  // Four bins per power of two, so no bin is wider than a quarter of its values
+  BOOST_CHECK_EQUAL(statuspage::lateness_bin(1000), statuspage::lateness_bin(1023));
+  BOOST_CHECK_NE(statuspage::lateness_bin(1023), statuspage::lateness_bin(1024));
+  // Anything huge goes in the last bin
+  BOOST_CHECK_EQUAL(statuspage::lateness_bin(~uint64_t{ 0 }), statuspage::s_lateness_bins - 1); // NOLINT
+}
+
+BOOST_AUTO_TEST_CASE(Percentiles)
+{
+  statuspage::Status status{};
+  // 90 decisions on time, 9 at 100 us and one at 5000 us
+  status.lateness_us_bins[statuspage::lateness_bin(0)] = 90;
+  status.lateness_us_bins[statuspage::lateness_bin(100)] = 9;
+  status.lateness_us_bins[statuspage::lateness_bin(5000)] = 1;
+  status.lateness_count = 100;
+  status.lateness_max_us = 5000;
+  BOOST_CHECK_EQUAL(statuspage::lateness_percentile_us(status, 0.5), 0);
+  const uint64_t p95 = statuspage::lateness_percentile_us(status, 0.95); // NOLINT(build/unsigned)
+  BOOST_CHECK_GE(p95, 100);
+  BOOST_CHECK_LT(p95, 128);
+  // Capped at the largest lateness seen
+  BOOST_CHECK_EQUAL(statuspage::lateness_percentile_us(status, 0.999), 5000);
+
+  statuspage::Status empty{};
+  BOOST_CHECK_EQUAL(statuspage::lateness_percentile_us(empty, 0.5), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReaderSeesWhatIsPublished)
+{
+  const std::string name = page_name();
+  BOOST_CHECK_THROW(StatusPageReader reader(name), StatusPageError);
+
+  StatusPageWriter writer(name);
+  statuspage::Status status{};
+  status.run_number = 42;
+  status.state = statuspage::State::kRunning;
+  status.triggers = 1234;
+  writer.publish(status);
+
+  StatusPageReader reader(name);
+  statuspage::Status read{};
+  BOOST_REQUIRE(reader.read(read));
+  BOOST_CHECK_EQUAL(read.run_number, 42);
+  BOOST_CHECK(read.state == statuspage::State::kRunning);
+  BOOST_CHECK_EQUAL(read.triggers, 1234);
+}
+
+BOOST_AUTO_TEST_CASE(NameInUseIsRefused)
+{
+  const std::string name = page_name();
+  auto first = std::make_unique<StatusPageWriter>(name);
+  statuspage::Status status{};
+  status.run_number = 7;
+  first->publish(status);
+
+  BOOST_CHECK_THROW(StatusPageWriter second(name), StatusPageError);
+
+  // The first writer's page is untouched
+  statuspage::Status read{};
+  BOOST_REQUIRE(StatusPageReader(name).read(read));
+  BOOST_CHECK_EQUAL(read.run_number, 7);
+
+  // And is gone with it
+  first.reset();
+  BOOST_CHECK_THROW(StatusPageReader reader(name), StatusPageError);
+}
+
+BOOST_AUTO_TEST_CASE(PageLeftBehindIsReplaced)
+{
+  const std::string name = page_name();
+  // A writer in a process that exits without destroying it
+  pid_t child = ::fork();
+  BOOST_REQUIRE_GE(child, 0);
+  if (child == 0) {
+    new StatusPageWriter(name); // NOLINT
+    ::_exit(0);
+  }
+  int child_status = 0;
+  ::waitpid(child, &child_status, 0);
+  BOOST_REQUIRE(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+  BOOST_REQUIRE_NO_THROW(StatusPageReader reader(name));
+
+  StatusPageWriter writer(name);
+  statuspage::Status status{};
+  status.run_number = 9;
+  writer.publish(status);
+  statuspage::Status read{};
+  BOOST_REQUIRE(StatusPageReader(name).read(read));
+  BOOST_CHECK_EQUAL(read.run_number, 9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
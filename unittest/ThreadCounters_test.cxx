@@ -0,0 +1,105 @@
+/**
+ * @file ThreadCounters_test.cxx ThreadCounters and StateTimer class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ThreadCounters.hpp"
+
+#define BOOST_TEST_MODULE ThreadCounters_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(ThreadCounters_test)
+
+namespace {
+
+enum class TestCounter
+{
+  kFirst,
+  kSecond,
+  kCount
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(CountsAndResets)
+{
+  ThreadCounters<TestCounter> counters;
+  counters.add(TestCounter::kFirst);
+  counters.add(TestCounter::kSecond, 5);
+  counters.add(TestCounter::kFirst);
+  BOOST_CHECK_EQUAL(counters.get(TestCounter::kFirst), 2);
+  BOOST_CHECK_EQUAL(counters.get(TestCounter::kSecond), 5);
+
+  // Burn a little CPU so there is something to sample
+  volatile uint64_t sink = 0; // NOLINT(build/unsigned)
+  for (int i = 0; i < 10'000'000; ++i) {
+    sink = sink + i;
+  }
+  counters.sample_cpu_time();
+  BOOST_CHECK_GT(counters.get_cpu_time_us(), 0);
+
+  counters.reset();
+  BOOST_CHECK_EQUAL(counters.get(TestCounter::kFirst), 0);
+  BOOST_CHECK_EQUAL(counters.get(TestCounter::kSecond), 0);
+  BOOST_CHECK_EQUAL(counters.get_cpu_time_us(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReadersDontDisturbTheOwner)
+{
+  ThreadCounters<TestCounter> counters;
+  std::atomic<bool> done{ false };
+  std::atomic<bool> went_back{ false };
+
+  // Several monitoring threads reading at once, as get_info() and the status page do
+  std::thread readers[2];
+  for (auto& reader : readers) {
+    reader = std::thread([&]() {
+      uint64_t last = 0; // NOLINT(build/unsigned)
+      while (!done.load()) {
+        uint64_t value = counters.get(TestCounter::kFirst); // NOLINT(build/unsigned)
+        went_back = went_back || value < last;
+        last = value;
+      }
+    });
+  }
+  for (int i = 0; i < 1'000'000; ++i) {
+    counters.add(TestCounter::kFirst);
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  BOOST_CHECK(!went_back.load());
+  BOOST_CHECK_EQUAL(counters.get(TestCounter::kFirst), 1'000'000);
+}
+
+BOOST_AUTO_TEST_CASE(StateTimerAddsUpSpells)
+{
+  StateTimer timer;
+  BOOST_CHECK_EQUAL(timer.total_us(1000), 0);
+  timer.set(true, 1000);
+  // Setting the state it's already in changes nothing
+  timer.set(true, 1500);
+  BOOST_CHECK_EQUAL(timer.total_us(1700), 700);
+  timer.set(false, 2000);
+  timer.set(false, 2500);
+  BOOST_CHECK_EQUAL(timer.total_us(5000), 1000);
+  timer.set(true, 6000);
+  BOOST_CHECK_EQUAL(timer.total_us(6250), 1250);
+  // A clock that reads earlier than the start of the spell doesn't make it negative
+  BOOST_CHECK_EQUAL(timer.total_us(5900), 1000);
+
+  timer.reset();
+  BOOST_CHECK_EQUAL(timer.total_us(10'000), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
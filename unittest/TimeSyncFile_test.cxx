@@ -0,0 +1,138 @@
+/**
+ * @file TimeSyncFile_test.cxx TimeSyncRecorder and read_time_sync_file Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Issues.hpp"
+#include "trigemu/TimeSyncFile.hpp"
+
+#define BOOST_TEST_MODULE TimeSyncFile_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(TimeSyncFile_test)
+
+namespace {
+
+// A directory of its own for each test, removed afterwards
+struct TimeSyncDirectory
+{
+  TimeSyncDirectory()
+    : path(std::filesystem::temp_directory_path() /
+           ("trigemu_timesync_test_" + std::to_string(::getpid()) + "_" + std::to_string(s_count++)))
+  {
+    std::filesystem::create_directories(path);
+  }
+  ~TimeSyncDirectory() { std::filesystem::remove_all(path); }
+
+  std::string prefix() const { return (path / "timesync").string(); }
+
+  std::filesystem::path path;
+  static inline int s_count = 0;
+};
+
+std::vector<dfmessages::TimeSync>
+make_time_syncs(size_t count)
+{
+  std::vector<dfmessages::TimeSync> time_syncs;
+  for (size_t i = 0; i < count; ++i) {
+    dfmessages::TimeSync time_sync(1'000'000 + i * 50'000, 20'000 + i * 1000);
+    time_sync.sequence_number = i + 1;
+    time_sync.run_number = 7;
+    time_sync.source_pid = 4242;
+    time_syncs.push_back(time_sync);
+  }
+  return time_syncs;
+}
+
+// Records them, each arriving 5 us after it was sent, and returns the file's path
+std::string
+write_time_syncs(const TimeSyncDirectory& directory, const std::vector<dfmessages::TimeSync>& time_syncs)
+{
+  TimeSyncRecorder recorder(directory.prefix(), 7, 50'000'000);
+  for (auto const& time_sync : time_syncs) {
+    recorder.record(time_sync, time_sync.system_time + 5);
+  }
+  recorder.close();
+  BOOST_REQUIRE_EQUAL(recorder.get_recorded_count(), time_syncs.size());
+  return recorder.get_path();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+  TimeSyncDirectory directory;
+  // More than one flush interval, and not a multiple of it, so close() writes the last few
+  auto time_syncs = make_time_syncs(37);
+  const std::string path = write_time_syncs(directory, time_syncs);
+  BOOST_CHECK_EQUAL(path, directory.prefix() + "_run000007.tdets");
+
+  auto trace = read_time_sync_file(path);
+  BOOST_CHECK_EQUAL(trace.header.clock_frequency_hz, 50'000'000);
+  BOOST_CHECK_EQUAL(trace.header.run_number, 7);
+  BOOST_REQUIRE_EQUAL(trace.records.size(), time_syncs.size());
+  for (size_t i = 0; i < time_syncs.size(); ++i) {
+    BOOST_CHECK_EQUAL(trace.records[i].daq_time, time_syncs[i].daq_time);
+    BOOST_CHECK_EQUAL(trace.records[i].system_time, time_syncs[i].system_time);
+    BOOST_CHECK_EQUAL(trace.records[i].arrival_us, time_syncs[i].system_time + 5);
+    BOOST_CHECK_EQUAL(trace.records[i].sequence_number, time_syncs[i].sequence_number);
+    BOOST_CHECK_EQUAL(trace.records[i].run_number, time_syncs[i].run_number);
+    BOOST_CHECK_EQUAL(trace.records[i].source_pid, time_syncs[i].source_pid);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(RecordCutShortEndsTheFile)
+{
+  TimeSyncDirectory directory;
+  auto time_syncs = make_time_syncs(10);
+  const std::string path = write_time_syncs(directory, time_syncs);
+
+  // As if the recorder were still in the middle of the last record
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - sizeof(timesyncfile::Record) / 2);
+  auto trace = read_time_sync_file(path);
+  BOOST_REQUIRE_EQUAL(trace.records.size(), time_syncs.size() - 1);
+  BOOST_CHECK_EQUAL(trace.records.back().sequence_number, time_syncs[time_syncs.size() - 2].sequence_number);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsOtherFiles)
+{
+  TimeSyncDirectory directory;
+  const std::string path = directory.prefix() + "_run000007.tdets";
+  BOOST_CHECK_THROW(read_time_sync_file(path), TimeSyncFileError);
+
+  std::ofstream(path) << "this is not a TimeSync file, though it is long enough to have a header";
+  BOOST_CHECK_THROW(read_time_sync_file(path), TimeSyncFileError);
+
+  // A header of another version
+  auto header = timesyncfile::make_file_header(50'000'000, 7);
+  header.version = timesyncfile::s_version + 1;
+  std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(&header), sizeof(header));
+  BOOST_CHECK_THROW(read_time_sync_file(path), TimeSyncFileError);
+
+  // A run with no TimeSyncs
+  write_time_syncs(directory, {});
+  BOOST_CHECK_THROW(read_time_sync_file(path), TimeSyncFileError);
+}
+
+BOOST_AUTO_TEST_CASE(UnwritablePathThrows)
+{
+  TimeSyncDirectory directory;
+  BOOST_CHECK_THROW(TimeSyncRecorder((directory.path / "missing" / "timesync").string(), 7, 50'000'000),
+                    TimeSyncFileError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
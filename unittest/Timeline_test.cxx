@@ -0,0 +1,97 @@
+/**
+ * @file Timeline_test.cxx Timeline and TimelineBuffer class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/Clock.hpp"
+#include "trigemu/Issues.hpp"
+#include "trigemu/Timeline.hpp"
+
+#define BOOST_TEST_MODULE Timeline_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(Timeline_test)
+
+namespace {
+
+const Clock::time_point s_start(std::chrono::hours(24 * 365 * 50));
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(TimedByTheModuleClock)
+{
+  // Nobody sleeps on it, so virtual time stays where it started
+  auto clock = std::make_shared<VirtualClock>(s_start);
+  Timeline timeline;
+  timeline.reset(16, clock);
+  TimelineBuffer* buffer = timeline.add_thread("sender");
+  buffer->record(TimelineEvent::kCreated, 1, 1000);
+  buffer->record(TimelineEvent::kSent, 1);
+
+  auto events = buffer->get_events();
+  BOOST_REQUIRE_EQUAL(events.size(), 2);
+  const int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(s_start.time_since_epoch()).count();
+  for (auto const& event : events) {
+    BOOST_CHECK_EQUAL(event.time_ns, start_ns);
+  }
+  BOOST_CHECK(events[0].type == TimelineEvent::kCreated);
+  BOOST_CHECK_EQUAL(events[0].id, 1);
+  BOOST_CHECK_EQUAL(events[0].arg, 1000);
+
+  // The same times in the file, in us
+  auto path = std::filesystem::temp_directory_path() / ("trigemu_timeline_test_" + std::to_string(::getpid()) + ".json");
+  timeline.write(path.string());
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::filesystem::remove(path);
+  const std::string ts = "\"ts\":" + std::to_string(start_ns / 1000) + ".000";
+  BOOST_CHECK_NE(contents.str().find("\"name\":\"decision\",\"cat\":\"trigemu\""), std::string::npos);
+  BOOST_CHECK_NE(contents.str().find(ts), std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(KeepsTheMostRecentEvents)
+{
+  Timeline timeline;
+  // Rounded up to 8
+  timeline.reset(5, std::make_shared<SystemClock>());
+  TimelineBuffer* buffer = timeline.add_thread("sender");
+  for (uint64_t i = 0; i < 20; ++i) { // NOLINT(build/unsigned)
+    buffer->record(TimelineEvent::kTokenSent, i);
+  }
+  auto events = buffer->get_events();
+  BOOST_REQUIRE_EQUAL(events.size(), 8);
+  BOOST_CHECK_EQUAL(buffer->get_overwritten_count(), 12);
+  for (size_t i = 0; i < events.size(); ++i) {
+    BOOST_CHECK_EQUAL(events[i].id, 12 + i);
+    if (i > 0) {
+      BOOST_CHECK_GE(events[i].time_ns, events[i - 1].time_ns);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(UnwritablePathThrows)
+{
+  Timeline timeline;
+  timeline.reset(4);
+  timeline.add_thread("sender")->record(TimelineEvent::kScheduled);
+  BOOST_CHECK_THROW(timeline.write("/nonexistent_directory/timeline.json"), RecordingError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
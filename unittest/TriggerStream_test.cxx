@@ -0,0 +1,126 @@
+/**
+ * @file TriggerStream_test.cxx TriggerStreamMerger class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/TriggerStream.hpp"
+
+#define BOOST_TEST_MODULE TriggerStream_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(TriggerStream_test)
+
+namespace {
+
+std::unique_ptr<ArrivalModel>
+make_model(const std::string& model, dfmessages::timestamp_t interval_ticks, uint64_t seed) // NOLINT(build/unsigned)
+{
+  ArrivalModelParams params;
+  params.model = model;
+  params.interval_ticks = interval_ticks;
+  params.seed = seed;
+  return make_arrival_model(params);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(MergesInTimestampOrder)
+{
+  TriggerStreamMerger merger;
+  merger.add_stream(make_model("poisson", 700, 1), 1000);
+  merger.add_stream(make_model("poisson", 1100, 2), 1500);
+  merger.add_stream(make_model("periodic", 2000, 3), 0);
+
+  // Each stream on its own, for comparison
+  std::vector<std::vector<dfmessages::timestamp_t>> expected(3);
+  std::vector<std::pair<std::unique_ptr<ArrivalModel>, dfmessages::timestamp_t>> models;
+  models.emplace_back(make_model("poisson", 700, 1), 1000);
+  models.emplace_back(make_model("poisson", 1100, 2), 1500);
+  models.emplace_back(make_model("periodic", 2000, 3), 0);
+  for (size_t stream = 0; stream < models.size(); ++stream) {
+    auto& [model, timestamp] = models[stream];
+    model->start(timestamp);
+    for (int i = 0; i < 1000; ++i) {
+      expected[stream].push_back(timestamp);
+      timestamp = model->next(timestamp);
+    }
+  }
+
+  std::vector<std::vector<dfmessages::timestamp_t>> merged(3);
+  dfmessages::timestamp_t previous = 0;
+  for (int i = 0; i < 1500; ++i) {
+    BOOST_REQUIRE(!merger.empty());
+    BOOST_REQUIRE_GE(merger.front_timestamp(), previous);
+    previous = merger.front_timestamp();
+    merged[merger.front_stream()].push_back(merger.front_timestamp());
+    merger.pop();
+  }
+  for (size_t stream = 0; stream < merged.size(); ++stream) {
+    BOOST_REQUIRE(!merged[stream].empty());
+    BOOST_REQUIRE_LE(merged[stream].size(), expected[stream].size());
+    BOOST_CHECK(std::equal(merged[stream].begin(), merged[stream].end(), expected[stream].begin()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TiesGoInStreamOrder)
+{
+  TriggerStreamMerger merger;
+  merger.add_stream(make_model("periodic", 1000, 0), 0);
+  merger.add_stream(make_model("periodic", 500, 0), 0);
+  merger.add_stream(make_model("periodic", 1000, 0), 0);
+
+  for (dfmessages::timestamp_t t = 0; t < 10'000; t += 1000) {
+    for (size_t stream : { 0, 1, 2 }) {
+      BOOST_REQUIRE_EQUAL(merger.front_timestamp(), t);
+      BOOST_REQUIRE_EQUAL(merger.front_stream(), stream);
+      merger.pop();
+    }
+    BOOST_REQUIRE_EQUAL(merger.front_timestamp(), t + 500);
+    BOOST_REQUIRE_EQUAL(merger.front_stream(), 1);
+    merger.pop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IntervalChangeAffectsOneStream)
+{
+  TriggerStreamMerger merger;
+  merger.add_stream(make_model("periodic", 1000, 0), 0);
+  merger.add_stream(make_model("periodic", 1000, 0), 1);
+  // 0 at 0, 1 at 1, then 0 at 1000
+  merger.pop();
+  merger.pop();
+  BOOST_REQUIRE_EQUAL(merger.front_stream(), 0);
+  BOOST_REQUIRE_EQUAL(merger.front_timestamp(), 1000);
+
+  merger.set_interval(1, 100);
+  std::vector<dfmessages::timestamp_t> stream1;
+  while (merger.front_timestamp() < 3000) {
+    if (merger.front_stream() == 1) {
+      stream1.push_back(merger.front_timestamp());
+    } else {
+      BOOST_CHECK_EQUAL(merger.front_timestamp() % 1000, 0);
+    }
+    merger.pop();
+  }
+  // The trigger already queued at 1001 keeps its place
+  BOOST_REQUIRE_GE(stream1.size(), 2);
+  BOOST_CHECK_EQUAL(stream1[0], 1001);
+  for (size_t i = 1; i < stream1.size(); ++i) {
+    BOOST_CHECK_EQUAL(stream1[i] - stream1[i - 1], 100);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,309 @@
+/**
+ * @file TriggerTraceReader_test.cxx TriggerTraceReader and TriggerTraceReplay class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/DecisionFile.hpp"
+#include "trigemu/DecisionRecorder.hpp"
+#include "trigemu/Issues.hpp"
+#include "trigemu/TriggerTraceReader.hpp"
+
+#define BOOST_TEST_MODULE TriggerTraceReader_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(TriggerTraceReader_test)
+
+namespace {
+
+// A directory of its own for each test, removed afterwards
+struct TraceDirectory
+{
+  TraceDirectory()
+    : path(std::filesystem::temp_directory_path() /
+           ("trigemu_trace_test_" + std::to_string(::getpid()) + "_" + std::to_string(s_count++)))
+  {
+    std::filesystem::create_directories(path);
+  }
+  ~TraceDirectory() { std::filesystem::remove_all(path); }
+
+  std::string prefix() const { return (path / "trace").string(); }
+  // The name DecisionRecorder gives the `sequence`th file of run 1
+  std::string file(int sequence) const
+  {
+    std::string number = std::to_string(sequence);
+    return prefix() + "_run000001_" + std::string(4 - number.size(), '0') + number + ".tdedec";
+  }
+
+  std::filesystem::path path;
+  static inline int s_count = 0;
+};
+
+// Every tenth one has no components
+std::vector<dfmessages::TriggerDecision>
+make_decisions(size_t count, dfmessages::timestamp_t first_timestamp, dfmessages::timestamp_t interval)
+{
+  std::vector<dfmessages::TriggerDecision> decisions;
+  for (size_t i = 0; i < count; ++i) {
+    dfmessages::TriggerDecision decision;
+    decision.trigger_number = i + 1;
+    decision.run_number = 1;
+    decision.trigger_timestamp = first_timestamp + i * interval;
+    decision.trigger_type = static_cast<dfmessages::trigger_type_t>(i % 3);
+    for (size_t c = 0; c < i % 10; ++c) {
+      dfmessages::ComponentRequest request;
+      request.component.system_type = daqdataformats::GeoID::SystemType::kTPC;
+      request.component.region_id = static_cast<uint16_t>(c % 2); // NOLINT(build/unsigned)
+      request.component.element_id = static_cast<uint32_t>(c);    // NOLINT(build/unsigned)
+      request.window_begin = decision.trigger_timestamp - 100 - c;
+      request.window_end = decision.trigger_timestamp + 200 + c;
+      decision.components.push_back(request);
+    }
+    decisions.push_back(decision);
+  }
+  return decisions;
+}
+
+void
+write_trace(const TraceDirectory& directory,
+            const std::vector<dfmessages::TriggerDecision>& decisions,
+            size_t max_file_bytes = 1 << 30,
+            size_t index_interval = 16)
+{
+  DecisionRecorder recorder(directory.prefix(), 1, max_file_bytes, index_interval, false);
+  for (auto const& decision : decisions) {
+    recorder.record(decision);
+  }
+  recorder.close();
+  BOOST_REQUIRE_EQUAL(recorder.get_dropped_count(), 0);
+  BOOST_REQUIRE_EQUAL(recorder.get_recorded_count(), decisions.size());
+}
+
+bool
+same_decision(const dfmessages::TriggerDecision& a, const dfmessages::TriggerDecision& b)
+{
+  if (std::tie(a.trigger_number, a.run_number, a.trigger_timestamp, a.trigger_type) !=
+        std::tie(b.trigger_number, b.run_number, b.trigger_timestamp, b.trigger_type) ||
+      a.components.size() != b.components.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.components.size(); ++i) {
+    if (!(a.components[i].component == b.components[i].component) ||
+        a.components[i].window_begin != b.components[i].window_begin ||
+        a.components[i].window_end != b.components[i].window_end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<dfmessages::TriggerDecision>
+read_trace(const std::string& path)
+{
+  std::vector<dfmessages::TriggerDecision> decisions;
+  TriggerTraceReader reader(path);
+  dfmessages::TriggerDecision decision;
+  while (reader.next(decision)) {
+    decisions.push_back(decision);
+  }
+  return decisions;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(1000, 1'000'000, 2500);
+  write_trace(directory, decisions);
+
+  auto read = read_trace(directory.file(0));
+  BOOST_REQUIRE_EQUAL(read.size(), decisions.size());
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    BOOST_REQUIRE(same_decision(read[i], decisions[i]));
+  }
+  BOOST_CHECK(!std::filesystem::exists(directory.file(1)));
+}
+
+BOOST_AUTO_TEST_CASE(RollsOverToNewFiles)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(1000, 1'000'000, 2500);
+  write_trace(directory, decisions, 16 * 1024);
+
+  std::vector<dfmessages::TriggerDecision> read;
+  int files = 0;
+  for (; std::filesystem::exists(directory.file(files)); ++files) {
+    BOOST_CHECK(std::filesystem::exists(directory.file(files) + decisionfile::s_index_suffix));
+    auto in_file = read_trace(directory.file(files));
+    BOOST_CHECK(!in_file.empty());
+    read.insert(read.end(), in_file.begin(), in_file.end());
+  }
+  BOOST_CHECK_GT(files, 1);
+  BOOST_REQUIRE_EQUAL(read.size(), decisions.size());
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    BOOST_REQUIRE(same_decision(read[i], decisions[i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SeeksToTimestamp)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(1000, 1'000'000, 2500);
+  write_trace(directory, decisions, 1 << 30, 16);
+
+  TriggerTraceReader reader(directory.file(0));
+  dfmessages::TriggerDecision decision;
+  for (size_t target : { 0, 1, 15, 16, 17, 500, 999 }) {
+    // Between two triggers, and exactly on one
+    reader.seek_to_timestamp(decisions[target].trigger_timestamp - 1);
+    BOOST_REQUIRE(reader.next(decision));
+    BOOST_CHECK_EQUAL(decision.trigger_number, decisions[target].trigger_number);
+    reader.seek_to_timestamp(decisions[target].trigger_timestamp);
+    BOOST_REQUIRE(reader.next(decision));
+    BOOST_CHECK_EQUAL(decision.trigger_number, decisions[target].trigger_number);
+  }
+  reader.seek_to_timestamp(decisions.back().trigger_timestamp + 1);
+  BOOST_CHECK(!reader.next(decision));
+
+  reader.rewind();
+  BOOST_REQUIRE(reader.next(decision));
+  BOOST_CHECK_EQUAL(decision.trigger_number, decisions.front().trigger_number);
+}
+
+BOOST_AUTO_TEST_CASE(RecordCutShortEndsTheFile)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(100, 1'000'000, 2500);
+  write_trace(directory, decisions);
+
+  // As if the writer were still in the middle of the last record
+  const auto size = std::filesystem::file_size(directory.file(0));
+  std::filesystem::resize_file(directory.file(0), size - sizeof(decisionfile::ComponentRecord));
+  auto read = read_trace(directory.file(0));
+  BOOST_REQUIRE_EQUAL(read.size(), decisions.size() - 1);
+  BOOST_CHECK(same_decision(read.back(), decisions[decisions.size() - 2]));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsOtherFiles)
+{
+  TraceDirectory directory;
+  BOOST_CHECK_THROW(TriggerTraceReader(directory.file(0)), TraceFileError);
+
+  std::ofstream(directory.file(0)) << "this is not a trigger decision file at all";
+  BOOST_CHECK_THROW(TriggerTraceReader(directory.file(0)), TraceFileError);
+}
+
+BOOST_AUTO_TEST_CASE(ReplayScalesAndLoops)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(10, 1'000'000, 1000);
+  write_trace(directory, decisions);
+
+  // Skip the first two, at half speed, and go round again
+  TriggerTraceReplay replay(directory.file(0), 2.0, 1500, true);
+  replay.set_start_timestamp(50'000'000);
+  dfmessages::TriggerDecision decision;
+  for (size_t i = 2; i < decisions.size(); ++i) {
+    BOOST_REQUIRE(replay.next(decision));
+    const dfmessages::timestamp_t expected = 50'000'000 + (i - 2) * 2000;
+    BOOST_CHECK_EQUAL(decision.trigger_timestamp, expected);
+    BOOST_CHECK_EQUAL(decision.trigger_type, decisions[i].trigger_type);
+    BOOST_REQUIRE_EQUAL(decision.components.size(), decisions[i].components.size());
+    for (size_t c = 0; c < decision.components.size(); ++c) {
+      // Windows keep their place relative to the trigger, and their length
+      BOOST_CHECK_EQUAL(decision.components[c].window_begin + (decisions[i].trigger_timestamp - expected),
+                        decisions[i].components[c].window_begin);
+      BOOST_CHECK_EQUAL(decision.components[c].window_end - decision.components[c].window_begin,
+                        decisions[i].components[c].window_end - decisions[i].components[c].window_begin);
+    }
+  }
+  // The second pass starts one mean interval after the last trigger of the first
+  const dfmessages::timestamp_t last = decision.trigger_timestamp;
+  BOOST_REQUIRE(replay.next(decision));
+  BOOST_CHECK_EQUAL(decision.trigger_timestamp, last + 2000);
+  BOOST_CHECK_EQUAL(decision.trigger_type, decisions[2].trigger_type);
+
+  TriggerTraceReplay once(directory.file(0), 1.0, 0, false);
+  once.set_start_timestamp(0);
+  size_t count = 0;
+  while (once.next(decision)) {
+    ++count;
+  }
+  BOOST_CHECK_EQUAL(count, decisions.size());
+}
+
+BOOST_AUTO_TEST_CASE(FlaggedRecordsAreSkipped)
+{
+  TraceDirectory directory;
+  auto decisions = make_decisions(200, 1'000'000, 1000);
+  // Each trigger is sent twice, and every fifth one is sent again later, after the next one
+  std::vector<dfmessages::TriggerDecision> first_sends;
+  {
+    DecisionRecorder recorder(directory.prefix(), 1, 1 << 30, 4, false);
+    dfmessages::trigger_number_t trigger_number = 1;
+    for (size_t i = 0; i < decisions.size(); ++i) {
+      auto decision = decisions[i];
+      decision.trigger_number = trigger_number++;
+      first_sends.push_back(decision);
+      recorder.record(decision);
+      decision.trigger_number = trigger_number++;
+      recorder.record(decision, true);
+      if (i % 5 == 1) {
+        recorder.record_resent(first_sends[i - 1]);
+      }
+    }
+    recorder.close();
+    BOOST_REQUIRE_EQUAL(recorder.get_dropped_count(), 0);
+    BOOST_REQUIRE_EQUAL(recorder.get_recorded_count(), 2 * decisions.size() + decisions.size() / 5);
+  }
+
+  // Every record is there, flagged
+  TriggerTraceReader reader(directory.file(0));
+  dfmessages::TriggerDecision decision;
+  uint32_t flags = 0; // NOLINT(build/unsigned)
+  size_t counts[4] = {};
+  while (reader.next(decision, flags)) {
+    BOOST_REQUIRE_LT(flags, 4);
+    ++counts[flags];
+  }
+  BOOST_CHECK_EQUAL(counts[0], decisions.size());
+  BOOST_CHECK_EQUAL(counts[decisionfile::s_flag_repeat], decisions.size());
+  BOOST_CHECK_EQUAL(counts[decisionfile::s_flag_resent], decisions.size() / 5);
+
+  // Seeking lands on the first send, never on a resent copy with an earlier timestamp
+  for (size_t target : { 0, 1, 2, 50, 101, 199 }) {
+    reader.seek_to_timestamp(decisions[target].trigger_timestamp);
+    BOOST_REQUIRE(reader.next(decision, flags));
+    BOOST_CHECK_EQUAL(flags, 0);
+    BOOST_CHECK_EQUAL(decision.trigger_number, first_sends[target].trigger_number);
+  }
+
+  // Each trigger is replayed once, in order, and the second pass follows on from the first
+  TriggerTraceReplay replay(directory.file(0), 1.0, 0, true);
+  replay.set_start_timestamp(50'000'000);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (size_t i = 0; i < decisions.size(); ++i) {
+      BOOST_REQUIRE(replay.next(decision));
+      const dfmessages::timestamp_t expected = 50'000'000 + (pass * decisions.size() + i) * 1000;
+      BOOST_REQUIRE_EQUAL(decision.trigger_timestamp, expected);
+      BOOST_CHECK_EQUAL(decision.components.size(), decisions[i].components.size());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,278 @@
+/**
+ * @file VirtualClock_test.cxx VirtualClock class Unit Tests
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigemu/ArrivalModel.hpp"
+#include "trigemu/Clock.hpp"
+#include "trigemu/CreditPool.hpp"
+#include "trigemu/InterruptibleSleeper.hpp"
+#include "trigemu/TimestampEstimator.hpp"
+#include "trigemu/TriggerStream.hpp"
+
+#include "iomanager/Receiver.hpp"
+
+#include "dfmessages/TimeSync.hpp"
+#include "ers/Issue.hpp"
+
+#define BOOST_TEST_MODULE VirtualClock_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::trigemu;
+
+BOOST_AUTO_TEST_SUITE(VirtualClock_test)
+
+namespace {
+
+constexpr uint64_t s_clock_frequency_hz = 50'000'000; // NOLINT(build/unsigned)
+
+// A TimeSync queue, read without waiting
+class FakeTimeSyncQueue : public iomanager::ReceiverConcept<dfmessages::TimeSync>
+{
+public:
+  void push(const dfmessages::TimeSync& time_sync)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_queue.push_back(time_sync);
+  }
+
+  dfmessages::TimeSync receive(Receiver::timeout_t timeout) override
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_queue.empty()) {
+      throw iomanager::TimeoutExpired(ERS_HERE, "time_sync_q", "receive", timeout.count());
+    }
+    auto time_sync = m_queue.front();
+    m_queue.pop_front();
+    return time_sync;
+  }
+  void add_callback(std::function<void(dfmessages::TimeSync&)> /*callback*/) override {}
+  void remove_callback() override {}
+
+private:
+  std::mutex m_mutex;
+  std::deque<dfmessages::TimeSync> m_queue;
+};
+
+struct SentDecision
+{
+  dfmessages::timestamp_t trigger_timestamp;
+  dfmessages::timestamp_t estimate; // When it was sent
+  uint64_t sent_us;                 // NOLINT(build/unsigned)
+  bool had_token;
+
+  bool operator==(const SentDecision& other) const
+  {
+    return std::tie(trigger_timestamp, estimate, sent_us, had_token) ==
+           std::tie(other.trigger_timestamp, other.estimate, other.sent_us, other.had_token);
+  }
+};
+
+/**
+ * @brief A small emulator on a fresh virtual clock: a TimeSync source
+ * with jittered intervals, a TimestampEstimator, a sender that takes a
+ * token for each of a Poisson stream of triggers, and a dataflow that
+ * gives each token back after a random delay. The threads interact
+ * through the queue, the estimate and the tokens, so the decisions
+ * depend on the order they run in
+ */
+std::vector<SentDecision>
+run_emulation(uint64_t seed, size_t decision_count) // NOLINT(build/unsigned)
+{
+  // The same start time every run
+  auto clock = std::make_shared<VirtualClock>(Clock::time_point(std::chrono::hours(24 * 365 * 50)));
+  Clock::Participant participants(clock, 3);
+  InterruptibleSleeper sleeper(clock);
+  CreditPool tokens(clock);
+  tokens.reset(2);
+
+  auto queue = std::make_shared<FakeTimeSyncQueue>();
+  std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> source = queue;
+  TimestampEstimator estimator(source, s_clock_frequency_hz, 1, clock, nullptr, nullptr, "ts-est");
+
+  std::atomic<bool> done{ false };
+  std::mutex open_mutex;
+  std::deque<Clock::time_point> token_returns;
+  std::vector<SentDecision> decisions;
+
+  std::thread time_sync_thread([&]() {
+    Clock::ThreadScope scope(participants, "time-sync");
+    std::mt19937 random_engine(seed);
+    std::uniform_int_distribution<int> interval_us(5000, 15000);
+    while (!done.load()) {
+      const uint64_t now_us = clock->now_us(); // NOLINT(build/unsigned)
+      dfmessages::TimeSync time_sync(now_us * (s_clock_frequency_hz / 1'000'000), now_us);
+      time_sync.run_number = 1;
+      queue->push(time_sync);
+      sleeper.sleep_for(std::chrono::microseconds(interval_us(random_engine)));
+    }
+  });
+
+  std::thread dataflow_thread([&]() {
+    Clock::ThreadScope scope(participants, "dataflow");
+    while (!done.load()) {
+      Clock::time_point next_return = clock->now() + std::chrono::milliseconds(1);
+      {
+        std::lock_guard<std::mutex> lk(open_mutex);
+        while (!token_returns.empty() && token_returns.front() <= clock->now()) {
+          token_returns.pop_front();
+          tokens.release();
+        }
+        if (!token_returns.empty()) {
+          next_return = std::min(next_return, token_returns.front());
+        }
+      }
+      clock->sleep_until(next_return, [&]() { return sleeper.interrupted(); });
+    }
+  });
+
+  std::thread sender_thread([&]() {
+    Clock::ThreadScope scope(participants, "sender");
+    std::mt19937 random_engine(seed + 1);
+    std::uniform_int_distribution<int> processing_us(1000, 8000);
+
+    while (estimator.get_timestamp_estimate() == dfmessages::TypeDefaults::s_invalid_timestamp) {
+      sleeper.sleep_for(std::chrono::milliseconds(1));
+    }
+    ArrivalModelParams params;
+    params.model = "poisson";
+    params.interval_ticks = s_clock_frequency_hz / 1000; // 1 kHz
+    params.seed = seed;
+    TriggerStreamMerger merger;
+    merger.add_stream(make_arrival_model(params), estimator.get_timestamp_estimate() + params.interval_ticks);
+
+    while (decisions.size() < decision_count) {
+      while (estimator.get_timestamp_estimate() < merger.front_timestamp()) {
+        sleeper.sleep_for(std::chrono::microseconds(100));
+      }
+      const bool had_token =
+        tokens.acquire_until(1, clock->now() + std::chrono::milliseconds(2), []() { return false; });
+      decisions.push_back(
+        SentDecision{ merger.front_timestamp(), estimator.get_timestamp_estimate(), clock->now_us(), had_token });
+      if (had_token) {
+        std::lock_guard<std::mutex> lk(open_mutex);
+        token_returns.push_back(clock->now() + std::chrono::microseconds(processing_us(random_engine)));
+      }
+      merger.pop();
+    }
+    done.store(true);
+    sleeper.interrupt();
+  });
+
+  sender_thread.join();
+  dataflow_thread.join();
+  time_sync_thread.join();
+  return decisions;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SleepersWakeInDeadlineOrder)
+{
+  auto clock = std::make_shared<VirtualClock>();
+  const auto start = clock->now();
+  Clock::Participant participants(clock, 3);
+  std::mutex order_mutex;
+  std::vector<int> order;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 3; ++i) {
+    threads.emplace_back([&, i]() {
+      Clock::ThreadScope scope(participants, "sleeper-" + std::to_string(i));
+      // Hours of virtual time, due in the reverse order of starting
+      BOOST_CHECK(clock->sleep_until(start + std::chrono::hours(2 * (3 - i)), []() { return false; }));
+      std::lock_guard<std::mutex> lk(order_mutex);
+      order.push_back(i);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_REQUIRE_EQUAL(order.size(), 3);
+  BOOST_CHECK_EQUAL(order[0], 2);
+  BOOST_CHECK_EQUAL(order[1], 1);
+  BOOST_CHECK_EQUAL(order[2], 0);
+  BOOST_CHECK(clock->now() == start + std::chrono::hours(6));
+}
+
+BOOST_AUTO_TEST_CASE(InterruptedSleeperDoesNotMoveTime)
+{
+  auto clock = std::make_shared<VirtualClock>();
+  const auto start = clock->now();
+  Clock::Participant participants(clock, 2);
+  InterruptibleSleeper sleeper(clock);
+
+  std::thread long_sleeper([&]() {
+    Clock::ThreadScope scope(participants, "long");
+    BOOST_CHECK(!sleeper.sleep_for(std::chrono::hours(1)));
+  });
+  std::thread interrupter([&]() {
+    Clock::ThreadScope scope(participants, "interrupter");
+    BOOST_CHECK(clock->sleep_until(start + std::chrono::seconds(1), []() { return false; }));
+    sleeper.interrupt();
+  });
+  interrupter.join();
+  long_sleeper.join();
+  BOOST_CHECK(clock->now() == start + std::chrono::seconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(WaiterIsWokenOnTheWay)
+{
+  auto clock = std::make_shared<VirtualClock>();
+  const auto start = clock->now();
+  Clock::Participant participants(clock, 1);
+
+  std::thread participant([&]() {
+    Clock::ThreadScope scope(participants, "participant");
+    for (int i = 1; i <= 10; ++i) {
+      clock->sleep_until(start + std::chrono::seconds(i), []() { return false; });
+    }
+  });
+  // Not a participant: it doesn't hold time up, and is woken at its deadline
+  BOOST_CHECK(clock->wait_until(start + std::chrono::milliseconds(4500), []() { return false; }));
+  BOOST_CHECK(clock->now() >= start + std::chrono::milliseconds(4500));
+  participant.join();
+  BOOST_CHECK(clock->now() == start + std::chrono::seconds(10));
+}
+
+BOOST_AUTO_TEST_CASE(SameSeedSameDecisions)
+{
+  const size_t decision_count = 500;
+  auto first = run_emulation(7, decision_count);
+  auto second = run_emulation(7, decision_count);
+  BOOST_REQUIRE_EQUAL(first.size(), decision_count);
+  BOOST_REQUIRE_EQUAL(second.size(), decision_count);
+  for (size_t i = 0; i < decision_count; ++i) {
+    BOOST_REQUIRE_MESSAGE(first[i] == second[i], "Decision " << i << " differs between the runs");
+  }
+
+  // The tokens ran out at times, so the dataflow's timing mattered
+  size_t without_token = 0;
+  for (auto const& decision : first) {
+    without_token += decision.had_token ? 0 : 1;
+  }
+  BOOST_CHECK_GT(without_token, 0);
+  BOOST_CHECK_LT(without_token, decision_count);
+
+  auto other = run_emulation(8, decision_count);
+  BOOST_CHECK(!(other[0] == first[0] && other[decision_count - 1] == first[decision_count - 1]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()